@@ -25,11 +25,33 @@
 #include <stdint.h>
 #include <avr/io.h>
 #include <util/delay.h>
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
 
 //#define USE_RS485_RTS 1
-#include "msg_processor.h"
+#include "avr_impl.h"
+#include "boot_defs.h"
+#include "output_store.h"
+#include "profile.h"
 
 
+// multi-drop bus address (REG_BUS_ADDRESS), erased eeprom reads as BUS_ADDRESS_BROADCAST
+static uint8_t EEMEM s_ee_busAddress;
+
+// REG_FW_CAPS, what this build does
+#ifdef USE_RS485_RTS
+#define FW_CAPS_RS485  FW_CAP_RS485
+#else
+#define FW_CAPS_RS485  0
+#endif
+#ifdef USE_PROFILING
+#define FW_CAPS_PROFILING  FW_CAP_PROFILING
+#else
+#define FW_CAPS_PROFILING  0
+#endif
+#define FW_CAPS  (FW_CAP_RELIABLE | FW_CAP_CREDIT | FW_CAP_BUS | FW_CAPS_RS485 | FW_CAPS_PROFILING)
+
 //  a140808       ATmega32
 //  Opti-In 1     PORTD.5
 //  Opti-In 2     PORTD.7
@@ -80,18 +102,9 @@
 //{
 //}
 
-struct Subscription
-{
-    Subscription(void) : m_isSubscribed(false), m_value(0) { }
-    bool m_isSubscribed;
-    uint8_t m_value;
-};
-static Subscription s_input;
-static Subscription s_output;
-
 
 ////////////////////////////////////////
-void avr_init(void)
+void A140808::init(void)
 {
     // configure A140808 inputs:
     //  Opti-In 1     PORTD.5
@@ -116,45 +129,80 @@ void avr_init(void)
     //  Relay 6       PORTA.5
     //  Relay 7       PORTA.6
     //  Relay 8       PORTA.7
-    PORTA = 0xff;  // set port a to logic 1 (relays off)
+    // restore the power-on state before enabling the outputs so the relays never glitch
+    const uint8_t outputs = OutputStore::init();
+    WRITE_DIGITAL_OUTPUTS(outputs);  // POWERON_ALL_OFF: port a to logic 1 (relays off)
     DDRA |= 0xff;  // set ddr  a to logic 1 (output)
+
+    // flow control, the daemon hears about the restart with the first MSG_CREDIT
+    m_creditSent = 0;
+    m_creditRestart = true;
+
+    // USE_PROFILING builds only
+    PROFILE_INIT();
 }
 
 ////////////////////////////////////////
-void on_poll(MsgProcessor& p_mp)
+uint8_t A140808::bus_address(void) const
+{
+    const uint8_t address = eeprom_read_byte(&s_ee_busAddress);
+    return((BUS_ADDRESS_BROADCAST == address) ? BUS_ADDRESS_NONE : address);
+}
+
+////////////////////////////////////////
+void A140808::on_poll(MsgProcessor& p_mp)
 {
     // our timeslice
-    if(s_input.m_isSubscribed)
+    if(m_input.m_isSubscribed)
     {
         const uint8_t inputs = READ_DIGITAL_INPUTS;
-        if(inputs != s_input.m_value)
+        if(inputs != m_input.m_value)
         {
             // value changed
-            s_input.m_value = inputs;
+            m_input.m_value = inputs;
             p_mp.dispatch_subscribe_register(REG_INPUT_1, inputs);
         }
     }
-    if(s_output.m_isSubscribed)
+    if(m_output.m_isSubscribed)
     {
         const uint8_t outputs = READ_DIGITAL_OUTPUTS;
-        if(outputs != s_output.m_value)
+        if(outputs != m_output.m_value)
         {
             // value changed
-            s_output.m_value = outputs;
+            m_output.m_value = outputs;
             p_mp.dispatch_subscribe_register(REG_OUTPUT_1, outputs);
         }
     }
+
+    // persist output changes for POWERON_RESTORE
+    OutputStore::poll(READ_DIGITAL_OUTPUTS);
+
+    // room freed in the rx ring, the bus master paces itself with MSG_POLL
+    if((BUS_ADDRESS_NONE == p_mp.address()) && (m_creditRestart || (m_creditSent != (p_mp.transport().rx_consumed() & CREDIT_COUNT_MASK))))
+    {
+        send_credit(p_mp, 0);
+    }
+}
+
+////////////////////////////////////////
+void A140808::send_credit(MsgProcessor& p_mp, const uint8_t p_flags)
+{
+    const uint16_t consumed = (p_mp.transport().rx_consumed() & CREDIT_COUNT_MASK);
+    const uint8_t flags = (p_flags | (m_creditRestart ? CREDIT_RESTART : 0));
+    p_mp.dispatch_message(MSG_CREDIT, (consumed & 0xff), ((consumed >> 8) | flags), p_mp.transport().rx_window());
+    m_creditSent = consumed;
+    m_creditRestart = false;
 }
 
 ////////////////////////////////////////
-void on_pong(MsgProcessor& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
+void A140808::on_pong(MsgProcessor& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
 {
     // we got our ping back but nothing to do
     // the AVR does not send pings anyway
 }
 
 ////////////////////////////////////////
-void on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress)
+void A140808::on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress)
 {
     switch(p_registerAddress)
     {
@@ -170,8 +218,42 @@ void on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress)
             p_mp.dispatch_write_register(REG_OUTPUT_1, outputs);
             break;
         }
+        case REG_POWERON_POLICY:
+        {
+            p_mp.dispatch_write_register(REG_POWERON_POLICY, OutputStore::get_policy());
+            break;
+        }
+        case REG_BUS_ADDRESS:
+        {
+            p_mp.dispatch_write_register(REG_BUS_ADDRESS, p_mp.address());
+            break;
+        }
+        case REG_LINK_CREDIT:
+        {
+            send_credit(p_mp, CREDIT_SYNC);
+            break;
+        }
+        case REG_FW_VERSION:
+        {
+            p_mp.dispatch_write_register(REG_FW_VERSION, FW_VERSION);
+            break;
+        }
+        case REG_FW_CAPS:
+        {
+            p_mp.dispatch_write_register(REG_FW_CAPS, FW_CAPS);
+            break;
+        }
         default:
         {
+            #ifdef USE_PROFILING
+            uint16_t value;
+            if(profile::read(p_registerAddress, value))
+            {
+                // 16-bit diagnostics reply: value is the low byte, mask the high byte
+                p_mp.dispatch_write_register(p_registerAddress, (value & 0xff), (value >> 8));
+                break;
+            }
+            #endif // USE_PROFILING
             p_mp.dispatch_write_register(REG_ERR_UNKNOWN);
             break;
         }
@@ -179,7 +261,7 @@ void on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress)
 }
 
 ////////////////////////////////////////
-void on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask)
+void A140808::on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask)
 {
     switch(p_registerAddress)
     {
@@ -188,6 +270,46 @@ void on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, cons
             WRITE_DIGITAL_OUTPUTS_MASKED(p_value, p_mask);
             break;
         }
+        case REG_POWERON_POLICY:
+        {
+            // POWERON_ALL_OFF, POWERON_RESTORE, POWERON_ALL_ON
+            OutputStore::set_policy((OutputStore::get_policy() & ~p_mask) | (p_value & p_mask));
+            break;
+        }
+        case REG_BUS_ADDRESS:
+        {
+            // a broadcast would give every board on the bus the same address
+            const uint8_t address = ((p_mp.address() & ~p_mask) | (p_value & p_mask));
+            if((BUS_ADDRESS_BROADCAST == p_mp.rx_address()) || (BUS_ADDRESS_BROADCAST == address))
+            {
+                break;
+            }
+            eeprom_update_byte(&s_ee_busAddress, address);
+            p_mp.set_address(address);
+            break;
+        }
+        case REG_BOOT_REQUEST:
+        {
+            // one bootloader at a time, they would all answer the uploader
+            if((BOOT_REQUEST_KEY != (p_value & p_mask)) || (BUS_ADDRESS_BROADCAST == p_mp.rx_address()))
+            {
+                break;
+            }
+            // the bootloader stays for BOOT_FLAG_REQUEST, reset into it
+            cli();
+            eeprom_busy_wait();  // a pending OutputStore write
+            eeprom_update_byte((uint8_t*)BOOT_EE_FLAG, BOOT_FLAG_REQUEST);
+            eeprom_busy_wait();
+            wdt_enable(WDTO_15MS);
+            for(;;) { }
+        }
+        #ifdef USE_PROFILING
+        case REG_DIAG_RESET:
+        {
+            profile::reset();
+            break;
+        }
+        #endif // USE_PROFILING
         default:
         {
             break;
@@ -196,7 +318,7 @@ void on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, cons
 }
 
 ////////////////////////////////////////
-void on_write_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state)
+void A140808::on_write_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state)
 {
     switch(p_registerAddress)
     {
@@ -220,7 +342,7 @@ void on_write_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress,
 }
 
 ////////////////////////////////////////
-void on_pulse_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs)
+void A140808::on_pulse_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs)
 {
     switch(p_registerAddress)
     {
@@ -240,23 +362,23 @@ void on_pulse_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress,
 }
 
 ////////////////////////////////////////
-void on_subscribe_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
+void A140808::on_subscribe_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
 {
     switch(p_registerAddress)
     {
         case REG_INPUT_1:
         {
             const uint8_t inputs = READ_DIGITAL_INPUTS;
-            s_input.m_isSubscribed = !p_cancel;
-            s_input.m_value = p_cancel ? 0 : inputs;
+            m_input.m_isSubscribed = !p_cancel;
+            m_input.m_value = p_cancel ? 0 : inputs;
             p_mp.dispatch_subscribe_register(REG_INPUT_1, inputs, p_cancel);
             break;
         }
         case REG_OUTPUT_1:
         {
             const uint8_t outputs = READ_DIGITAL_OUTPUTS;
-            s_output.m_isSubscribed = !p_cancel;
-            s_output.m_value = p_cancel ? 0 : outputs;
+            m_output.m_isSubscribed = !p_cancel;
+            m_output.m_value = p_cancel ? 0 : outputs;
             p_mp.dispatch_subscribe_register(REG_OUTPUT_1, outputs, p_cancel);
             break;
         }
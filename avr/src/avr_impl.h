@@ -0,0 +1,63 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __avr_impl_h__
+#define __avr_impl_h__
+
+#include <stdint.h>
+
+#include "msg_processor.h"
+#include "serial.h"
+
+
+class A140808;
+typedef MsgProcessorT<SerialPort, A140808> MsgProcessor;
+
+////////////////////////////////////////////////////////////
+// the a140808 board: relays, opto inputs and the registers behind them,
+// the MsgProcessor event handler (see msg_processor.h)
+class A140808
+{
+public:
+    void init(void);
+    uint8_t bus_address(void) const;
+
+    void on_poll(MsgProcessor& p_mp);
+    void on_pong(MsgProcessor& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3);
+    void on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress);
+    void on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask);
+    void on_write_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state);
+    void on_pulse_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs);
+    void on_subscribe_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel);
+
+private:
+    void send_credit(MsgProcessor& p_mp, const uint8_t p_flags);
+
+    struct Subscription
+    {
+        Subscription(void) : m_isSubscribed(false), m_value(0) { }
+        bool m_isSubscribed;
+        uint8_t m_value;
+    };
+    Subscription m_input;
+    Subscription m_output;
+    uint16_t m_creditSent;   // the last count sent with MSG_CREDIT
+    bool m_creditRestart;    // none sent yet
+};
+
+#endif // __avr_impl_h__
@@ -24,15 +24,14 @@
 #include <util/delay.h>
 #include <avr/io.h>
 
-#include "msg_processor.h"
-
-void avr_init(void);  // from avr_impl.cpp
+#include "avr_impl.h"
 
 ////////////////////////////////////////
 FUSES =
 {
     (FUSE_BODEN & FUSE_BODLEVEL),  // low fuses: 0x3f
-    (FUSE_BOOTSZ0 & FUSE_BOOTSZ1 & FUSE_CKOPT & FUSE_SPIEN), // high fuses: 0xc9
+    // 4KB boot section at 0x7000 with the reset vector in it, see boot_defs.h
+    (FUSE_BOOTRST & FUSE_BOOTSZ0 & FUSE_BOOTSZ1 & FUSE_CKOPT & FUSE_SPIEN), // high fuses: 0xc8
 };
 
 // --------------------------------------------------------
@@ -64,14 +63,17 @@ LOCKBITS = LOCKBITS_DEFAULT; // lock: 0xff
 ////////////////////////////////////////
 int main(void)
 {
-    avr_init();
+    A140808 board;
+    board.init();
 
     // create the message pump
-    MsgProcessor mp;
-    if(!mp.init(0, 0xE100, true))  // 57,600
+    SerialPort serialPort;
+    if(!serialPort.init(0, 0xE100, true))  // 57,600
     {
         return(1);
     }
+    MsgProcessor mp(serialPort, board);
+    mp.set_address(board.bus_address());
 
     // enable global interrupts
     // http://winavr.scienceprog.com/avr-gcc-tutorial/interrupt-driven-avr-usart-communication.html
@@ -82,7 +84,15 @@ int main(void)
     {
         // check for new messages
         mp.poll();
-        _delay_ms(100);
+        if(BUS_ADDRESS_NONE == mp.address())
+        {
+            _delay_ms(100);
+        }
+        else
+        {
+            // the master waits for our answer before it talks to the next board
+            _delay_ms(1);
+        }
     }
 
     return(0);
@@ -0,0 +1,554 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// serial bootloader, linked at BOOT_START (make boot), protocol in boot_defs.h
+//
+// everything is polled from one loop so the usart keeps receiving while a
+// page is being programmed: the application section is read-while-write,
+// the cpu keeps running from the boot section during a page erase or
+// write. received pages queue up in BOOT_SLOTS buffers and are programmed
+// in order, each acknowledged once it is written, so the uploader can keep
+// BOOT_SLOTS pages in flight and the link never waits on the flash.
+//
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/boot.h>
+#include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "../boot_defs.h"
+
+// jump to the application reset vector, the host build's <avr/boot.h> has its own
+#ifndef BOOT_START_APPLICATION
+#define BOOT_START_APPLICATION()  asm volatile("jmp 0")
+#endif
+
+// U2X is always set
+#define BOOT_UBRR(baud)          (((F_CPU / 4 / (baud)) - 1) / 2)
+// timer1 runs at clk/1024
+#define TIMER_HZ                 (F_CPU / 1024)
+#define BAUD_CONFIRM_TICKS       (uint16_t)((BOOT_BAUD_CONFIRM_MS * TIMER_HZ) / 1000)
+#define IDLE_OVERFLOWS           (uint8_t)((BOOT_IDLE_SEC * TIMER_HZ) >> 16)
+
+#define TX_BUF_SIZE              64  // power of 2
+#define SCRATCH_SIZE             6   // largest payload other than a page
+
+enum RxState { RX_SYNC, RX_CMD, RX_LEN, RX_PAYLOAD, RX_CRC_LO, RX_CRC_HI };
+enum SpmState { SPM_IDLE, SPM_ERASE, SPM_WRITE };
+
+struct Page
+{
+    uint16_t m_addr;
+    uint8_t m_data[BOOT_PAGE_SIZE];
+};
+
+// received pages, programmed in order from s_pageHead
+static Page s_pages[BOOT_SLOTS];
+static uint8_t s_pageHead = 0;
+static uint8_t s_pageCount = 0;
+static uint8_t s_spmState = SPM_IDLE;
+
+// frame being received
+static uint8_t s_rxState = RX_SYNC;
+static uint8_t s_rxCmd = 0;
+static uint8_t s_rxLen = 0;
+static uint8_t s_rxPos = 0;
+static uint8_t s_rxStatus = BOOT_OK;  // BOOT_E_LEN, BOOT_E_BUSY found before the payload
+static uint16_t s_rxCrc = 0;
+static uint8_t* s_rxDst = 0;
+static uint8_t s_scratch[SCRATCH_SIZE];
+
+// replies waiting for the transmitter
+static uint8_t s_txBuf[TX_BUF_SIZE];
+static uint8_t s_txHead = 0;
+static uint8_t s_txTail = 0;
+
+static uint16_t s_newUbrr = 0;        // BOOT_CMD_BAUD, applied once the reply is out
+static bool s_baudChange = false;
+static bool s_baudPending = false;    // new rate not yet confirmed by a frame
+static uint16_t s_baudStart = 0;
+static bool s_verifyPending = false;  // BOOT_CMD_VERIFY, once the queued pages are written
+static bool s_runPending = false;     // BOOT_CMD_RUN, once the reply is out
+static bool s_requested = false;      // started for BOOT_FLAG_REQUEST
+static bool s_updating = false;       // BOOT_FLAG_UPDATE written
+static uint8_t s_idleOverflows = 0;
+
+
+////////////////////////////////////////
+static uint16_t update_crc16(uint16_t p_crc, const uint8_t p_ch)
+{
+    p_crc ^= p_ch;
+    for(uint8_t i=0; i<8; ++i)
+    {
+        p_crc = ((p_crc & 0x0001) ? ((p_crc >> 1) ^ 0xa001) : (p_crc >> 1));
+    }
+    return(p_crc);
+}
+
+////////////////////////////////////////
+// crc32 (ieee 802.3, reflected) of application flash 0 to p_len
+static uint32_t flash_crc32(const uint16_t p_len)
+{
+    uint32_t crc = 0xffffffff;
+    for(uint16_t addr=0; addr<p_len; ++addr)
+    {
+        crc ^= pgm_read_byte(addr);
+        for(uint8_t i=0; i<8; ++i)
+        {
+            crc = ((crc & 1) ? ((crc >> 1) ^ 0xedb88320) : (crc >> 1));
+        }
+    }
+    return(~crc);
+}
+
+////////////////////////////////////////
+static void tx_push(const uint8_t p_val)
+{
+    const uint8_t next = ((s_txTail + 1) & (TX_BUF_SIZE - 1));
+    if(next != s_txHead)
+    {
+        s_txBuf[s_txTail] = p_val;
+        s_txTail = next;
+    }
+}
+
+////////////////////////////////////////
+static void reply(const uint8_t p_cmd, const uint8_t* p_payload, const uint8_t p_len)
+{
+    uint16_t crc = 0xffff;
+    tx_push(BOOT_SYNC);
+    tx_push(p_cmd | BOOT_REPLY);
+    crc = update_crc16(crc, (p_cmd | BOOT_REPLY));
+    tx_push(p_len);
+    crc = update_crc16(crc, p_len);
+    for(uint8_t i=0; i<p_len; ++i)
+    {
+        tx_push(p_payload[i]);
+        crc = update_crc16(crc, p_payload[i]);
+    }
+    tx_push(crc & 0xff);
+    tx_push(crc >> 8);
+}
+
+////////////////////////////////////////
+static void reply_status(const uint8_t p_cmd, const uint8_t p_status)
+{
+    reply(p_cmd, &p_status, 1);
+}
+
+////////////////////////////////////////
+static void reply_page(const uint8_t p_status, const uint16_t p_addr)
+{
+    const uint8_t payload[3] = { p_status, (uint8_t)(p_addr & 0xff), (uint8_t)(p_addr >> 8) };
+    reply(BOOT_CMD_PAGE, payload, sizeof(payload));
+}
+
+////////////////////////////////////////
+static void set_baud(const uint16_t p_ubrr)
+{
+    UBRRH = (p_ubrr >> 8);
+    UBRRL = p_ubrr;
+}
+
+////////////////////////////////////////
+static void set_flag(const uint8_t p_flag)
+{
+    // eeprom writes run alongside the usart, spm waits for them (see program_poll)
+    eeprom_update_byte((uint8_t*)BOOT_EE_FLAG, p_flag);
+}
+
+////////////////////////////////////////
+static void start_application(void)
+{
+    eeprom_busy_wait();
+    boot_spm_busy_wait();
+    boot_rww_enable();
+
+    // leave the usart and timer1 in their reset state
+    UCSRB = 0;
+    UCSRA = 0;
+    set_baud(0);
+    TCCR1B = 0;
+    TCNT1 = 0;
+    TIFR = _BV(TOV1);
+
+    BOOT_START_APPLICATION();
+}
+
+////////////////////////////////////////
+static void handle_frame(void)
+{
+    // a good frame: the host is alive and the current rate works
+    s_idleOverflows = 0;
+    s_baudPending = false;
+
+    switch(s_rxCmd)
+    {
+        case BOOT_CMD_HELLO:
+        {
+            const uint8_t payload[7] =
+            {
+                BOOT_OK, BOOT_VERSION,
+                (uint8_t)(BOOT_PAGE_SIZE & 0xff), (uint8_t)(BOOT_PAGE_SIZE >> 8),
+                (uint8_t)(BOOT_START & 0xff), (uint8_t)(BOOT_START >> 8),
+                BOOT_SLOTS
+            };
+            reply(BOOT_CMD_HELLO, payload, sizeof(payload));
+            break;
+        }
+
+        case BOOT_CMD_BAUD:
+        {
+            if(4 != s_rxLen)
+            {
+                reply_status(BOOT_CMD_BAUD, BOOT_E_LEN);
+                break;
+            }
+            const uint32_t baud = (s_scratch[0] | ((uint32_t)s_scratch[1] << 8) | ((uint32_t)s_scratch[2] << 16) | ((uint32_t)s_scratch[3] << 24));
+            if((baud < 2400) || (baud > (F_CPU / 8)))
+            {
+                reply_status(BOOT_CMD_BAUD, BOOT_E_BAUD);
+                break;
+            }
+            // nearest divisor, refused beyond 2.5% error
+            const uint16_t ubrr = (uint16_t)(((F_CPU / 4 / baud) + 1) / 2) - 1;
+            const uint32_t actual = (F_CPU / 8 / (ubrr + 1));
+            const uint32_t error = ((actual > baud) ? (actual - baud) : (baud - actual));
+            if((error * 40) > baud)
+            {
+                reply_status(BOOT_CMD_BAUD, BOOT_E_BAUD);
+                break;
+            }
+            s_newUbrr = ubrr;
+            s_baudChange = true;
+            reply_status(BOOT_CMD_BAUD, BOOT_OK);
+            break;
+        }
+
+        case BOOT_CMD_PAGE:
+        {
+            Page& page = s_pages[(s_pageHead + s_pageCount) % BOOT_SLOTS];
+            if(BOOT_OK != s_rxStatus)
+            {
+                // BOOT_E_BUSY: the payload went nowhere, report what we can
+                reply_page(s_rxStatus, 0);
+                break;
+            }
+            if((0 != (page.m_addr & (BOOT_PAGE_SIZE - 1))) || (page.m_addr >= BOOT_START))
+            {
+                reply_page(BOOT_E_ADDR, page.m_addr);
+                break;
+            }
+            if(!s_updating)
+            {
+                // the application is about to be overwritten
+                s_updating = true;
+                set_flag(BOOT_FLAG_UPDATE);
+            }
+            ++s_pageCount;  // program_poll() takes it from here
+            break;
+        }
+
+        case BOOT_CMD_VERIFY:
+        {
+            if(6 != s_rxLen)
+            {
+                reply_status(BOOT_CMD_VERIFY, BOOT_E_LEN);
+                break;
+            }
+            s_verifyPending = true;
+            break;
+        }
+
+        case BOOT_CMD_RUN:
+        {
+            reply_status(BOOT_CMD_RUN, BOOT_OK);
+            s_runPending = true;
+            break;
+        }
+
+        default:
+        {
+            reply_status(s_rxCmd, BOOT_E_CMD);
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////
+static void rx_byte(const uint8_t p_val)
+{
+    switch(s_rxState)
+    {
+        case RX_SYNC:
+        {
+            if(BOOT_SYNC == p_val)
+            {
+                s_rxCrc = 0xffff;
+                s_rxState = RX_CMD;
+            }
+            break;
+        }
+
+        case RX_CMD:
+        {
+            s_rxCmd = p_val;
+            s_rxCrc = update_crc16(s_rxCrc, p_val);
+            s_rxState = RX_LEN;
+            break;
+        }
+
+        case RX_LEN:
+        {
+            s_rxLen = p_val;
+            s_rxCrc = update_crc16(s_rxCrc, p_val);
+            s_rxPos = 0;
+            s_rxStatus = BOOT_OK;
+            s_rxDst = s_scratch;
+            if(BOOT_CMD_PAGE == s_rxCmd)
+            {
+                // straight into the next free slot, no copy
+                if(BOOT_PAYLOAD_MAX != s_rxLen)
+                {
+                    s_rxStatus = BOOT_E_LEN;
+                    s_rxDst = 0;
+                }
+                else if(s_pageCount >= BOOT_SLOTS)
+                {
+                    s_rxStatus = BOOT_E_BUSY;
+                    s_rxDst = 0;
+                }
+                else
+                {
+                    s_rxDst = (uint8_t*)&s_pages[(s_pageHead + s_pageCount) % BOOT_SLOTS];
+                }
+            }
+            else if(s_rxLen > SCRATCH_SIZE)
+            {
+                s_rxStatus = BOOT_E_LEN;
+                s_rxDst = 0;
+            }
+            s_rxState = ((0 == s_rxLen) ? RX_CRC_LO : RX_PAYLOAD);
+            break;
+        }
+
+        case RX_PAYLOAD:
+        {
+            if(0 != s_rxDst)
+            {
+                s_rxDst[s_rxPos] = p_val;
+            }
+            s_rxCrc = update_crc16(s_rxCrc, p_val);
+            if(++s_rxPos >= s_rxLen)
+            {
+                s_rxState = RX_CRC_LO;
+            }
+            break;
+        }
+
+        case RX_CRC_LO:
+        {
+            s_rxCrc ^= p_val;  // zero low byte when it matches
+            s_rxState = RX_CRC_HI;
+            break;
+        }
+
+        case RX_CRC_HI:
+        {
+            s_rxState = RX_SYNC;
+            if((0 != (s_rxCrc & 0xff)) || ((s_rxCrc >> 8) != p_val))
+            {
+                reply_status(BOOT_CMD_NAK, BOOT_E_CRC);
+            }
+            else if(BOOT_E_LEN == s_rxStatus)
+            {
+                reply_status(BOOT_CMD_NAK, BOOT_E_LEN);
+            }
+            else
+            {
+                handle_frame();
+            }
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////
+// one step of programming the oldest queued page, never waits
+static void program_poll(void)
+{
+    // spm must not start while the eeprom is being written
+    if(boot_spm_busy() || !eeprom_is_ready())
+    {
+        return;
+    }
+
+    Page& page = s_pages[s_pageHead];
+    switch(s_spmState)
+    {
+        case SPM_IDLE:
+        {
+            if(0 == s_pageCount)
+            {
+                break;
+            }
+            // fill the temporary buffer first, it survives the erase
+            for(uint8_t i=0; i<BOOT_PAGE_SIZE; i+=2)
+            {
+                boot_page_fill(page.m_addr + i, (page.m_data[i] | (page.m_data[i + 1] << 8)));
+            }
+            boot_page_erase(page.m_addr);
+            s_spmState = SPM_ERASE;
+            break;
+        }
+
+        case SPM_ERASE:
+        {
+            boot_page_write(page.m_addr);
+            s_spmState = SPM_WRITE;
+            break;
+        }
+
+        case SPM_WRITE:
+        {
+            boot_rww_enable();
+            reply_page(BOOT_OK, page.m_addr);
+            s_pageHead = ((s_pageHead + 1) % BOOT_SLOTS);
+            --s_pageCount;
+            s_spmState = SPM_IDLE;
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////
+static void verify(void)
+{
+    const uint16_t len = (s_scratch[0] | (s_scratch[1] << 8));
+    const uint32_t expected = (s_scratch[2] | ((uint32_t)s_scratch[3] << 8) | ((uint32_t)s_scratch[4] << 16) | ((uint32_t)s_scratch[5] << 24));
+    uint8_t payload[5] = { BOOT_E_ADDR, 0, 0, 0, 0 };
+    if((0 != len) && (len <= BOOT_START))
+    {
+        const uint32_t crc = flash_crc32(len);
+        payload[0] = ((crc == expected) ? BOOT_OK : BOOT_E_VERIFY);
+        payload[1] = (crc & 0xff);
+        payload[2] = ((crc >> 8) & 0xff);
+        payload[3] = ((crc >> 16) & 0xff);
+        payload[4] = (crc >> 24);
+        if(BOOT_OK == payload[0])
+        {
+            // the image is good, start it from now on
+            set_flag(BOOT_FLAG_APP_VALID);
+            s_updating = false;
+        }
+    }
+    reply(BOOT_CMD_VERIFY, payload, sizeof(payload));
+}
+
+////////////////////////////////////////
+int main(void)
+{
+    cli();
+
+    // start the application unless an update was asked for or left unfinished,
+    // or there is no application at all (erased reset vector)
+    const uint8_t flag = eeprom_read_byte((const uint8_t*)BOOT_EE_FLAG);
+    if((BOOT_FLAG_REQUEST != flag) && (BOOT_FLAG_UPDATE != flag) && (0xffff != pgm_read_word(0)))
+    {
+        start_application();
+    }
+    s_requested = (BOOT_FLAG_REQUEST == flag);
+    s_updating = (BOOT_FLAG_UPDATE == flag);
+
+    // usart: BOOT_BAUD 8N1, polled
+    set_baud(BOOT_UBRR(BOOT_BAUD));
+    UCSRA = _BV(U2X);
+    UCSRB = (_BV(RXEN) | _BV(TXEN));
+    UCSRC = (_BV(URSEL) | _BV(UCSZ1) | _BV(UCSZ0));
+
+    // timer1: free running time base for the timeouts
+    TCCR1B = (_BV(CS12) | _BV(CS10));
+
+    for(;;)
+    {
+        if(bit_is_set(UCSRA, RXC))
+        {
+            rx_byte(UDR);
+        }
+
+        program_poll();
+
+        if(s_verifyPending && (0 == s_pageCount))
+        {
+            s_verifyPending = false;
+            verify();
+        }
+
+        if(s_txHead != s_txTail)
+        {
+            if(bit_is_set(UCSRA, UDRE))
+            {
+                UCSRA = (_BV(TXC) | _BV(U2X));  // clear TXC, it marks the end of the reply
+                UDR = s_txBuf[s_txHead];
+                s_txHead = ((s_txHead + 1) & (TX_BUF_SIZE - 1));
+            }
+        }
+        else if(bit_is_set(UCSRA, TXC))
+        {
+            // the last reply is out
+            if(s_baudChange)
+            {
+                s_baudChange = false;
+                set_baud(s_newUbrr);
+                s_baudPending = true;
+                s_baudStart = TCNT1;
+            }
+            if(s_runPending && (0 == s_pageCount))
+            {
+                start_application();
+            }
+        }
+
+        if(s_baudPending && ((uint16_t)(TCNT1 - s_baudStart) > BAUD_CONFIRM_TICKS))
+        {
+            // nothing heard at the new rate
+            s_baudPending = false;
+            set_baud(BOOT_UBRR(BOOT_BAUD));
+        }
+
+        if(bit_is_set(TIFR, TOV1))
+        {
+            TIFR = _BV(TOV1);
+            if(++s_idleOverflows >= IDLE_OVERFLOWS)
+            {
+                s_idleOverflows = 0;
+                // nobody came for the update and nothing was written, go back to the application
+                if(s_requested && !s_updating && (0 == s_pageCount))
+                {
+                    set_flag(BOOT_FLAG_APP_VALID);
+                    start_application();
+                }
+            }
+        }
+    }
+
+    return(0);
+}
@@ -0,0 +1,96 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __boot_defs_h__
+#define __boot_defs_h__
+
+//
+// serial bootloader (boot/boot_main.cpp), shared by the firmware and the
+// daemon's uploader (a140808-fwup), plain defines like msg_defs.h
+//
+// the bootloader sits in the 4KB boot section (BOOTSZ1:0 = 00) and BOOTRST
+// makes it the reset vector. it starts the application unless the eeprom
+// flag below asks it to stay. the application sets the flag and resets
+// through the watchdog when REG_BOOT_REQUEST (msg_defs.h) is written with
+// BOOT_REQUEST_KEY, and an unfinished update leaves it set.
+//
+
+#define BOOT_START               0x7000  // byte address, application flash is 0x0000-0x6fff
+#define BOOT_PAGE_SIZE           128     // SPM_PAGESIZE
+#define BOOT_SLOTS               4       // pages the bootloader buffers, the uploader's window
+#define BOOT_BAUD                57600   // 8N1 until BOOT_CMD_BAUD
+#define BOOT_VERSION             0x01
+
+// eeprom, the last byte is kept out of EEMEM's way
+#define BOOT_EE_FLAG             0x3FF   // one of:
+#define BOOT_FLAG_ERASED         0xFF    //   isp programmed, start the application
+#define BOOT_FLAG_APP_VALID      0xA5    //   verified by the bootloader, start the application
+#define BOOT_FLAG_REQUEST        0xB7    //   asked for by the application, stay in the bootloader
+#define BOOT_FLAG_UPDATE         0x5A    //   pages written but not verified, stay in the bootloader
+#define BOOT_REQUEST_KEY         0xB7    // value for REG_BOOT_REQUEST
+
+// with BOOT_FLAG_REQUEST set and no host for BOOT_IDLE_SEC, the bootloader
+// goes back to the untouched application
+#define BOOT_IDLE_SEC            30
+// after BOOT_CMD_BAUD the bootloader returns to BOOT_BAUD unless a valid
+// frame arrives at the new rate within BOOT_BAUD_CONFIRM_MS
+#define BOOT_BAUD_CONFIRM_MS     1000
+
+//
+// frames, both directions:
+//
+//   | sync | cmd | len | payload (len bytes) | crc lo | crc hi |
+//
+//   sync: BOOT_SYNC
+//   cmd:  BOOT_CMD_*, replies have BOOT_REPLY set
+//   crc:  crc16 (poly 0xa001, init 0xffff) of cmd, len and payload
+//   multi-byte values are little endian
+//
+#define BOOT_SYNC                0x7E
+#define BOOT_REPLY               0x80
+#define BOOT_PAYLOAD_MAX         (2 + BOOT_PAGE_SIZE)
+
+// -> (none)
+// <- status, version, page size (16), application size (16), slots
+#define BOOT_CMD_HELLO           0x01
+// -> baud (32)
+// <- status, sent at the old rate, the new rate applies after it
+#define BOOT_CMD_BAUD            0x02
+// -> address (16, page aligned), page data (BOOT_PAGE_SIZE)
+// <- status, address (16), sent once the page is programmed, in order
+#define BOOT_CMD_PAGE            0x03
+// -> image length (16), crc32 (32) of flash 0 to length
+// <- status, crc32 (32) computed by the bootloader
+#define BOOT_CMD_VERIFY          0x04
+// -> (none)
+// <- status, then the application starts
+#define BOOT_CMD_RUN             0x05
+// <- status, for a frame with a bad crc or length
+#define BOOT_CMD_NAK             0x0F
+
+// status
+#define BOOT_OK                  0x00
+#define BOOT_E_CRC               0x01  // frame crc mismatch
+#define BOOT_E_LEN               0x02  // bad payload length
+#define BOOT_E_ADDR              0x03  // page not aligned or outside the application
+#define BOOT_E_BUSY              0x04  // all slots are full
+#define BOOT_E_VERIFY            0x05  // image crc mismatch
+#define BOOT_E_CMD               0x06  // unknown command
+#define BOOT_E_BAUD              0x07  // rate too far off at this clock
+
+#endif // __boot_defs_h__
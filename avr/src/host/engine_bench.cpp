@@ -0,0 +1,404 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// engine-bench: codec and dispatch cost of MsgProcessorT without any i/o
+//
+//   engine-bench [frames]
+//
+// two engines are cross-connected through in-memory byte queues, the
+// client pings and the server's engine answers with pongs. the same
+// template is used by the firmware, the test console and the daemon.
+//
+// before the benchmark a burst of pings checks that frames received while
+// others are answered survive, numbered commands check the in order
+// delivery of the reliable mode, and a master and BENCH_BOARDS boards
+// share one wire to check the multi-drop bus addressing and MSG_POLL.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../msg_processor.h"
+
+
+////////////////////////////////////////////////////////////
+// one direction of the link
+class ByteQueue
+{
+public:
+    ByteQueue(void) : m_head(0), m_tail(0) { }
+
+    void push(const uint8_t p_val)  { m_buf[m_tail++ & 0xfff] = p_val; }
+    bool empty(void) const          { return(m_head == m_tail); }
+    uint8_t pop(void)               { return(m_buf[m_head++ & 0xfff]); }
+
+private:
+    uint8_t m_buf[0x1000];
+    uint32_t m_head;
+    uint32_t m_tail;
+};
+
+////////////////////////////////////////////////////////////
+// transport over a pair of queues, same contract as SerialPort
+class MemTransport
+{
+public:
+    MemTransport(ByteQueue& p_rx, ByteQueue& p_tx) : m_rx(p_rx), m_tx(p_tx) { }
+
+    ////////////////////////////////////////
+    bool read(MsgBuf& p_msgBuf)
+    {
+        while(!m_rx.empty())
+        {
+            p_msgBuf.push_back(m_rx.pop());
+            if(S_OK == p_msgBuf.validate())
+            {
+                return(true);
+            }
+        }
+        return(false);
+    }
+
+    ////////////////////////////////////////
+    bool write(MsgBuf& p_msgBuf)
+    {
+        for(uint8_t i=0, imax=p_msgBuf.size(); i<imax; ++i)
+        {
+            m_tx.push(p_msgBuf[i]);
+        }
+        return(true);
+    }
+
+private:
+    ByteQueue& m_rx;
+    ByteQueue& m_tx;
+};
+
+////////////////////////////////////////////////////////////
+// a multi-drop bus, every station hears what the others send
+#define BENCH_BOARDS 8
+class Wire
+{
+public:
+    ByteQueue m_rx[BENCH_BOARDS + 1];  // 0 is the master
+};
+
+////////////////////////////////////////////////////////////
+class WireTransport
+{
+public:
+    WireTransport(void) : m_wire(0), m_station(0) { }
+
+    void attach(Wire& p_wire, const uint8_t p_station)  { m_wire = &p_wire; m_station = p_station; }
+
+    ////////////////////////////////////////
+    bool read(MsgBuf& p_msgBuf)
+    {
+        ByteQueue& rx = m_wire->m_rx[m_station];
+        while(!rx.empty())
+        {
+            p_msgBuf.push_back(rx.pop());
+            if(S_OK == p_msgBuf.validate())
+            {
+                return(true);
+            }
+        }
+        return(false);
+    }
+
+    ////////////////////////////////////////
+    bool write(MsgBuf& p_msgBuf)
+    {
+        for(uint8_t station=0; station<=BENCH_BOARDS; ++station)
+        {
+            if(station == m_station)
+            {
+                continue;
+            }
+            for(uint8_t i=0, imax=p_msgBuf.size(); i<imax; ++i)
+            {
+                m_wire->m_rx[station].push(p_msgBuf[i]);
+            }
+        }
+        return(true);
+    }
+
+private:
+    Wire* m_wire;
+    uint8_t m_station;
+};
+
+////////////////////////////////////////////////////////////
+// counts pongs, register writes and subscription events, ignores everything else
+class Counter
+{
+public:
+    Counter(void) : m_pongs(0), m_events(0), m_writes(0), m_from(0) { }
+    uint32_t m_pongs;
+    uint32_t m_events;
+    uint32_t m_writes;
+    uint32_t m_from;  // rx_address() of the last one
+
+    template<class MP> void on_poll(MP& p_mp) { }
+    template<class MP> void on_pong(MP& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3) { ++m_pongs; m_from = p_mp.rx_address(); }
+    template<class MP> void on_read_register(MP& p_mp, const uint8_t p_registerAddress) { }
+    template<class MP> void on_write_register(MP& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask) { ++m_writes; }
+    template<class MP> void on_write_register_bit(MP& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state) { }
+    template<class MP> void on_pulse_register_bit(MP& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs) { }
+    template<class MP> void on_subscribe_register(MP& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel) { ++m_events; m_from = p_mp.rx_address(); }
+};
+
+typedef MsgProcessorT<MemTransport, Counter> Engine;
+typedef MsgProcessorT<WireTransport, Counter> BusEngine;
+
+
+////////////////////////////////////////
+static double now_sec(void)
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return(ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
+////////////////////////////////////////
+// MP_RX_QUEUE pings in one go are all answered in one poll
+static bool pipeline_check(void)
+{
+    ByteQueue toServer;
+    ByteQueue toClient;
+    MemTransport clientTransport(toClient, toServer);
+    MemTransport serverTransport(toServer, toClient);
+    Counter clientEvents;
+    Counter serverEvents;
+    Engine client(clientTransport, clientEvents);
+    Engine server(serverTransport, serverEvents);
+
+    for(uint8_t i=0; i<MP_RX_QUEUE; ++i)
+    {
+        client.dispatch_ping(i, 0, 0);
+    }
+    server.poll();
+    for(uint8_t i=0; i<MP_RX_QUEUE; ++i)
+    {
+        client.poll();
+    }
+    if(MP_RX_QUEUE != clientEvents.m_pongs)
+    {
+        ::printf("FAIL: %u pongs for a burst of %u pings\n", clientEvents.m_pongs, MP_RX_QUEUE);
+        return(false);
+    }
+    ::printf("pipeline: %u pings answered in one poll\n", MP_RX_QUEUE);
+    return(true);
+}
+
+////////////////////////////////////////
+// send numbered frame p_seq and return the numbered answer's type and
+// ACK_* status, 0 if none came back
+static uint8_t seq_request(Engine& p_server, ByteQueue& p_toServer, ByteQueue& p_toClient, const uint8_t p_seq, const uint8_t p_type, uint8_t& p_status)
+{
+    MsgBuf msgBuf;
+    msgBuf.set_seq_bytes(p_seq, p_type, REG_OUTPUT_1, 0x01, 0xff);
+    for(uint8_t i=0, imax=msgBuf.size(); i<imax; ++i)
+    {
+        p_toServer.push(msgBuf[i]);
+    }
+    p_server.poll();
+
+    MsgBuf reply;
+    uint8_t seq = 0;
+    uint8_t type = 0;
+    uint8_t param1 = 0;
+    uint8_t param2 = 0;
+    while(!p_toClient.empty())
+    {
+        reply.push_back(p_toClient.pop());
+        if(reply.get_seq(seq) && (seq == (p_seq | SEQ_REPLY)))
+        {
+            reply.get_bytes(type, param1, param2, p_status);
+            return(type);
+        }
+    }
+    return(0);
+}
+
+////////////////////////////////////////
+// numbered commands run once and in order
+static bool seq_check(void)
+{
+    ByteQueue toServer;
+    ByteQueue toClient;
+    MemTransport serverTransport(toServer, toClient);
+    Counter serverEvents;
+    Engine server(serverTransport, serverEvents);
+    bool ok = true;
+    uint8_t status = 0;
+
+    ok &= (MSG_PONG == seq_request(server, toServer, toClient, 0, MSG_PING, status));
+    ok &= (MSG_ACK == seq_request(server, toServer, toClient, 1, MSG_WRITE_REGISTER, status)) && (ACK_OK == status) && (1 == serverEvents.m_writes);
+    // a retry is acked but does not run again
+    ok &= (MSG_ACK == seq_request(server, toServer, toClient, 1, MSG_WRITE_REGISTER, status)) && (ACK_DUPLICATE == status) && (1 == serverEvents.m_writes);
+    // 2 got lost, 3 is dropped until 2 is in
+    ok &= (0 == seq_request(server, toServer, toClient, 3, MSG_WRITE_REGISTER, status)) && (1 == serverEvents.m_writes);
+    ok &= (MSG_ACK == seq_request(server, toServer, toClient, 2, MSG_WRITE_REGISTER, status)) && (ACK_OK == status) && (2 == serverEvents.m_writes);
+    ok &= (MSG_ACK == seq_request(server, toServer, toClient, 3, MSG_WRITE_REGISTER, status)) && (ACK_OK == status) && (3 == serverEvents.m_writes);
+    // numbering wraps past SEQ_MAX
+    for(uint8_t seq=4; seq<=SEQ_MAX; ++seq)
+    {
+        seq_request(server, toServer, toClient, seq, MSG_WRITE_REGISTER, status);
+    }
+    ok &= (MSG_ACK == seq_request(server, toServer, toClient, 1, MSG_WRITE_REGISTER, status)) && (ACK_OK == status) && ((SEQ_MAX + 1u) == serverEvents.m_writes);
+
+    if(!ok)
+    {
+        ::printf("FAIL: numbered commands, %u writes ran\n", serverEvents.m_writes);
+        return(false);
+    }
+    ::printf("seq: numbered commands acked once, in order, retries not run again\n");
+    return(true);
+}
+
+////////////////////////////////////////
+// one request from the master and a turn for every board
+static void bus_cycle(BusEngine* p_stations[])
+{
+    for(uint8_t i=1; i<=BENCH_BOARDS; ++i)
+    {
+        p_stations[i]->poll();
+    }
+    p_stations[0]->poll();
+}
+
+////////////////////////////////////////
+static bool bus_check(void)
+{
+    Wire wire;
+    WireTransport transports[BENCH_BOARDS + 1];
+    Counter counters[BENCH_BOARDS + 1];
+    BusEngine* stations[BENCH_BOARDS + 1];
+    for(uint8_t i=0; i<=BENCH_BOARDS; ++i)
+    {
+        transports[i].attach(wire, i);
+        stations[i] = new BusEngine(transports[i], counters[i]);
+        if(i > 0)
+        {
+            stations[i]->set_address(0x10 + i);
+        }
+    }
+    BusEngine& master = *stations[0];
+    const Counter& heard = counters[0];
+    bool ok = true;
+
+    // only the addressed board answers
+    for(uint8_t i=1; i<=BENCH_BOARDS; ++i)
+    {
+        master.select(0x10 + i);
+        master.dispatch_ping(i, 0, 0);
+        bus_cycle(stations);
+        if((heard.m_pongs != i) || (heard.m_from != (0x10u + i)))
+        {
+            ::printf("FAIL: bus ping to board 0x%02x, %u pongs, last from 0x%02x\n", (0x10 + i), heard.m_pongs, heard.m_from);
+            ok = false;
+        }
+    }
+
+    // nobody answers a broadcast
+    master.select(BUS_ADDRESS_BROADCAST);
+    master.dispatch_ping(0, 0, 0);
+    bus_cycle(stations);
+    if(BENCH_BOARDS != heard.m_pongs)
+    {
+        ::printf("FAIL: bus broadcast ping was answered\n");
+        ok = false;
+    }
+
+    // events wait for MSG_POLL, one per poll, then the idle answer
+    for(uint8_t i=1; i<=BENCH_BOARDS; ++i)
+    {
+        stations[i]->dispatch_subscribe_register(REG_INPUT_1, i);
+        stations[i]->dispatch_subscribe_register(REG_INPUT_1, i);
+    }
+    bus_cycle(stations);
+    if(0 != heard.m_events)
+    {
+        ::printf("FAIL: bus board talked without a poll\n");
+        ok = false;
+    }
+    for(uint8_t i=1; i<=BENCH_BOARDS; ++i)
+    {
+        master.select(0x10 + i);
+        for(uint8_t poll=0; poll<3; ++poll)
+        {
+            master.dispatch_message(MSG_POLL, 0, 0, 0);
+            bus_cycle(stations);
+        }
+        if((heard.m_events != (i * 2u)) || (heard.m_from != (0x10u + i)))
+        {
+            ::printf("FAIL: bus poll of board 0x%02x, %u events, last from 0x%02x\n", (0x10 + i), heard.m_events, heard.m_from);
+            ok = false;
+        }
+    }
+
+    for(uint8_t i=0; i<=BENCH_BOARDS; ++i)
+    {
+        delete stations[i];
+    }
+    if(ok)
+    {
+        ::printf("bus: %u boards addressed, broadcast quiet, events polled\n", BENCH_BOARDS);
+    }
+    return(ok);
+}
+
+////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    const uint32_t frames = ((argc > 1) ? ::strtoul(argv[1], 0, 0) : 1000000);
+    if(!pipeline_check() || !seq_check() || !bus_check())
+    {
+        return(1);
+    }
+
+    ByteQueue toServer;
+    ByteQueue toClient;
+    MemTransport clientTransport(toClient, toServer);
+    MemTransport serverTransport(toServer, toClient);
+    Counter clientEvents;
+    Counter serverEvents;
+    Engine client(clientTransport, clientEvents);
+    Engine server(serverTransport, serverEvents);
+
+    const double start = now_sec();
+    for(uint32_t i=0; i<frames; ++i)
+    {
+        client.dispatch_ping((i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        server.poll();  // decode ping, encode pong
+        client.poll();  // decode pong
+    }
+    const double elapsed = (now_sec() - start);
+
+    if(clientEvents.m_pongs != frames)
+    {
+        ::printf("FAIL: %u pongs for %u pings\n", clientEvents.m_pongs, frames);
+        return(1);
+    }
+    ::printf("%u round trips in %.3f s: %.0f frames/s, %.1f ns per frame (encode + decode + dispatch)\n",
+             frames, elapsed, ((frames * 2) / elapsed), ((elapsed * 1e9) / (frames * 2)));
+    return(0);
+}
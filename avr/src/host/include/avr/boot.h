@@ -0,0 +1,57 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+#ifndef __host_avr_boot_h__
+#define __host_avr_boot_h__
+
+//
+// host build stand-in for <avr/boot.h>
+//
+// self-programming of sim::flash[] (see <avr/pgmspace.h>). the temporary
+// page buffer, page erase and page write behave like the part's, but they
+// complete at once: spm is never busy and the rww section is always
+// readable. jumping to the application ends the simulator, there is no
+// application code to run.
+//
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define SPM_PAGESIZE            128
+
+
+////////////////////////////////////////////////////////////
+namespace sim
+{
+    void spm_page_fill(const uint16_t p_addr, const uint16_t p_word);
+    void spm_page_erase(const uint16_t p_addr);
+    void spm_page_write(const uint16_t p_addr);
+    void start_application(void);
+} // namespace sim
+
+#define boot_page_fill(addr, data)  sim::spm_page_fill((addr), (data))
+#define boot_page_erase(addr)       sim::spm_page_erase(addr)
+#define boot_page_write(addr)       sim::spm_page_write(addr)
+#define boot_rww_enable()           do { } while(0)
+#define boot_spm_busy()             0
+#define boot_spm_busy_wait()        do { } while(0)
+#define boot_rww_busy()             0
+
+// see boot/boot_main.cpp
+#define BOOT_START_APPLICATION()    sim::start_application()
+
+#endif // __host_avr_boot_h__
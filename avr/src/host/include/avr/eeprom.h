@@ -0,0 +1,87 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __host_avr_eeprom_h__
+#define __host_avr_eeprom_h__
+
+//
+// host build stand-in for <avr/eeprom.h>
+//
+// the eeprom is sim::eeprom[]. EEMEM variables are gathered in the
+// sim_eeprom section and, like the avr linker does, laid out from address
+// 0 in the order of that section, so their host addresses are only used to
+// compute the eeprom address. small integers are eeprom addresses already
+// (ex: BOOT_EE_FLAG). the simulator erases the eeprom to 0xff at start-up,
+// or loads it from the image given with -e, and writes the image back on
+// every update so a restart of the simulator behaves like a power cycle.
+//
+
+#include <stdint.h>
+
+#define EEMEM       __attribute__((section("sim_eeprom")))
+#define E2END       0x3FF
+
+extern "C" uint8_t __start_sim_eeprom[] __attribute__((weak));
+
+
+////////////////////////////////////////////////////////////
+namespace sim
+{
+    extern uint8_t eeprom[E2END + 1];
+    void eeprom_written(const uint16_t p_addr);
+
+    ////////////////////////////////////////
+    inline uint16_t eeprom_addr(const void* p_addr)
+    {
+        const uintptr_t addr = (uintptr_t)p_addr;
+        if(addr <= E2END)
+        {
+            return(addr);
+        }
+        return((addr - (uintptr_t)__start_sim_eeprom) & E2END);
+    }
+} // namespace sim
+
+////////////////////////////////////////
+inline uint8_t eeprom_read_byte(const uint8_t* p_addr)
+{
+    return(sim::eeprom[sim::eeprom_addr(p_addr)]);
+}
+
+////////////////////////////////////////
+inline void eeprom_write_byte(uint8_t* p_addr, const uint8_t p_value)
+{
+    const uint16_t addr = sim::eeprom_addr(p_addr);
+    sim::eeprom[addr] = p_value;
+    sim::eeprom_written(addr);
+}
+
+////////////////////////////////////////
+inline void eeprom_update_byte(uint8_t* p_addr, const uint8_t p_value)
+{
+    if(eeprom_read_byte(p_addr) != p_value)
+    {
+        eeprom_write_byte(p_addr, p_value);
+    }
+}
+
+// writes complete immediately
+#define eeprom_is_ready()       1
+#define eeprom_busy_wait()      do { } while(0)
+
+#endif // __host_avr_eeprom_h__
@@ -0,0 +1,38 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __host_avr_interrupt_h__
+#define __host_avr_interrupt_h__
+
+//
+// host build stand-in for <avr/interrupt.h>
+//
+// an isr becomes a plain extern "C" function named after its vector (see
+// the *_vect names in <avr/io.h>). the simulator calls it from _delay_ms()
+// when the interrupt is enabled and the I bit in SREG is set.
+//
+
+#include <avr/io.h>
+
+#define ISR(vector)     extern "C" void vector(void)
+#define SIGNAL(vector)  ISR(vector)
+
+#define sei()           (SREG |= 0x80)
+#define cli()           (SREG &= (uint8_t)~0x80)
+
+#endif // __host_avr_interrupt_h__
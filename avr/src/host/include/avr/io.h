@@ -0,0 +1,209 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __host_avr_io_h__
+#define __host_avr_io_h__
+
+//
+// host build stand-in for <avr/io.h>, atmega32 only
+//
+// the i/o registers live in sim::io[] at their atmega32 i/o addresses.
+// UDR and UCSRA are objects so the simulator sees transmitted bytes and
+// the usart always reports an empty transmit buffer. see ../../sim.h
+//
+
+#include <stdint.h>
+
+#define _BV(bit)                        (1 << (bit))
+#define bit_is_set(sfr, bit)            ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit)          (!((sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit)   do { } while(bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit) do { } while(bit_is_set(sfr, bit))
+
+
+////////////////////////////////////////////////////////////
+namespace sim
+{
+    // UDR: reads return the received byte, writes go out the pty
+    class DataRegister
+    {
+    public:
+        operator uint8_t(void) const;
+        DataRegister& operator=(const uint8_t p_value);
+    };
+
+    // UCSRA: UDRE always reads as set, the transmitter never backs up
+    class StatusRegister
+    {
+    public:
+        operator uint8_t(void) const;
+        StatusRegister& operator=(const uint8_t p_value);
+    };
+
+    extern volatile uint8_t io[0x40];
+    extern volatile uint16_t tcnt1;
+    extern volatile uint16_t ocr1a;
+    extern volatile uint8_t ucsrc;
+    extern DataRegister udr;
+    extern StatusRegister ucsra;
+} // namespace sim
+
+
+// port a-d
+#define PINA        sim::io[0x19]
+#define DDRA        sim::io[0x1A]
+#define PORTA       sim::io[0x1B]
+#define PINB        sim::io[0x16]
+#define DDRB        sim::io[0x17]
+#define PORTB       sim::io[0x18]
+#define PINC        sim::io[0x13]
+#define DDRC        sim::io[0x14]
+#define PORTC       sim::io[0x15]
+#define PIND        sim::io[0x10]
+#define DDRD        sim::io[0x11]
+#define PORTD       sim::io[0x12]
+
+// usart
+#define UBRRL       sim::io[0x09]
+#define UCSRB       sim::io[0x0A]
+#define UCSRA       sim::ucsra
+#define UDR         sim::udr
+#define UBRRH       sim::io[0x20]
+#define UCSRC       sim::ucsrc      // shares 0x20 with UBRRH on the part, see URSEL
+
+// eeprom
+#define EECR        sim::io[0x1C]
+#define EEDR        sim::io[0x1D]
+#define EEARL       sim::io[0x1E]
+#define EEARH       sim::io[0x1F]
+
+// timers
+#define TCNT0       sim::io[0x32]
+#define TCCR0       sim::io[0x33]
+#define OCR0        sim::io[0x3C]
+#define TCNT1       sim::tcnt1
+#define OCR1A       sim::ocr1a
+#define TCCR1B      sim::io[0x2E]
+#define TCCR1A      sim::io[0x2F]
+#define TIFR        sim::io[0x38]
+#define TIMSK       sim::io[0x39]
+
+// cpu
+#define WDTCR       sim::io[0x21]
+#define MCUCSR      sim::io[0x34]
+#define MCUCR       sim::io[0x35]
+#define SPMCR       sim::io[0x37]
+#define GICR        sim::io[0x3B]
+#define SREG        sim::io[0x3F]
+
+// UCSRA
+#define RXC         7
+#define TXC         6
+#define UDRE        5
+#define FE          4
+#define DOR         3
+#define PE          2
+#define U2X         1
+#define MPCM        0
+
+// UCSRB
+#define RXCIE       7
+#define TXCIE       6
+#define UDRIE       5
+#define RXEN        4
+#define TXEN        3
+#define UCSZ2       2
+#define RXB8        1
+#define TXB8        0
+
+// UCSRC
+#define URSEL       7
+#define UMSEL       6
+#define UPM1        5
+#define UPM0        4
+#define USBS        3
+#define UCSZ1       2
+#define UCSZ0       1
+#define UCPOL       0
+
+// EECR
+#define EERIE       3
+#define EEMWE       2
+#define EEWE        1
+#define EERE        0
+
+// TCCR1A / TCCR1B
+#define COM1A1      7
+#define COM1A0      6
+#define WGM11       1
+#define WGM10       0
+#define WGM13       4
+#define WGM12       3
+#define CS12        2
+#define CS11        1
+#define CS10        0
+
+// TIMSK / TIFR
+#define OCIE2       7
+#define TOIE2       6
+#define TICIE1      5
+#define OCIE1A      4
+#define OCIE1B      3
+#define TOIE1       2
+#define OCIE0       1
+#define TOIE0       0
+#define OCF2        7
+#define TOV2        6
+#define ICF1        5
+#define OCF1A       4
+#define OCF1B       3
+#define TOV1        2
+#define OCF0        1
+#define TOV0        0
+
+// MCUCSR
+#define JTD         7
+#define ISC2        6
+#define JTRF        4
+#define WDRF        3
+#define BORF        2
+#define EXTRF       1
+#define PORF        0
+
+// interrupt vectors, see <avr/interrupt.h>
+#define USART_RXC_vect          sim_usart_rxc_vect
+#define USART_UDRE_vect         sim_usart_udre_vect
+#define USART_TXC_vect          sim_usart_txc_vect
+#define TIMER1_OVF_vect         sim_timer1_ovf_vect
+#define TIMER1_COMPA_vect       sim_timer1_compa_vect
+#define SIG_OUTPUT_COMPARE1A    sim_timer1_compa_vect
+
+// fuses and lock bits, kept in the host image but never programmed
+#define FUSE_BODEN              (unsigned char)~_BV(6)
+#define FUSE_BODLEVEL           (unsigned char)~_BV(7)
+#define FUSE_BOOTRST            (unsigned char)~_BV(0)
+#define FUSE_BOOTSZ0            (unsigned char)~_BV(1)
+#define FUSE_BOOTSZ1            (unsigned char)~_BV(2)
+#define FUSE_EESAVE             (unsigned char)~_BV(3)
+#define FUSE_CKOPT              (unsigned char)~_BV(4)
+#define FUSE_SPIEN              (unsigned char)~_BV(5)
+#define LOCKBITS_DEFAULT        0xff
+#define FUSES                   static const uint8_t sim_fuses[2] __attribute__((unused))
+#define LOCKBITS                static const uint8_t sim_lockbits __attribute__((unused))
+
+#endif // __host_avr_io_h__
@@ -0,0 +1,42 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+#ifndef __host_avr_pgmspace_h__
+#define __host_avr_pgmspace_h__
+
+//
+// host build stand-in for <avr/pgmspace.h>
+//
+// program memory is sim::flash[], erased or loaded from the image given
+// with -F. reads take flash byte addresses, PROGMEM data is not supported.
+//
+
+#include <stdint.h>
+
+#define FLASHEND    0x7FFF
+
+
+////////////////////////////////////////////////////////////
+namespace sim
+{
+    extern uint8_t flash[FLASHEND + 1];
+} // namespace sim
+
+#define pgm_read_byte(addr)     (sim::flash[(uint16_t)(addr) & FLASHEND])
+#define pgm_read_word(addr)     (pgm_read_byte(addr) | (pgm_read_byte((uint16_t)(addr) + 1) << 8))
+
+#endif // __host_avr_pgmspace_h__
@@ -0,0 +1,49 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+#ifndef __host_avr_wdt_h__
+#define __host_avr_wdt_h__
+
+//
+// host build stand-in for <avr/wdt.h>
+//
+// the firmware only enables the watchdog to reset the part, so enabling
+// it ends the simulator. restart it with the same -e and -F images to
+// continue like the part would after the reset.
+//
+
+#define WDTO_15MS   0
+#define WDTO_30MS   1
+#define WDTO_60MS   2
+#define WDTO_120MS  3
+#define WDTO_250MS  4
+#define WDTO_500MS  5
+#define WDTO_1S     6
+#define WDTO_2S     7
+
+
+////////////////////////////////////////////////////////////
+namespace sim
+{
+    void watchdog_reset(void);
+} // namespace sim
+
+#define wdt_enable(timeout)     sim::watchdog_reset()
+#define wdt_disable()           do { } while(0)
+#define wdt_reset()             do { } while(0)
+
+#endif // __host_avr_wdt_h__
@@ -0,0 +1,38 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __host_util_delay_h__
+#define __host_util_delay_h__
+
+//
+// host build stand-in for <util/delay.h>
+//
+// the firmware only ever waits in _delay_ms(), so that is where the
+// simulator services the pty and runs the pending interrupts
+//
+
+////////////////////////////////////////////////////////////
+namespace sim
+{
+    void delay_ms(const double p_ms);
+} // namespace sim
+
+#define _delay_ms(ms)   sim::delay_ms(ms)
+#define _delay_us(us)   sim::delay_ms((us) / 1000.0)
+
+#endif // __host_util_delay_h__
@@ -0,0 +1,383 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// pump-bench: checks and benchmarks the firmware message pump over a serial
+// device, normally the a140808-sim pty
+//
+//   pump-bench [-n frames] [-w window] [-c] device
+//
+//   -n  ping frames to send in the benchmark (default 10000)
+//   -w  frames in flight (default 8, 8 x 14 bytes fits the 128 byte rx ring)
+//   -c  run the relay/input checks only
+//
+// the checks drive the output register through every message type and
+// read the result back, then the flow control count (MSG_CREDIT). the
+// benchmark keeps a window of pings in flight and reports frames per
+// second and the round trip time.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include "../msg_buf.h"
+#include "../msg_processor.h"  // MSG_*, REG_*
+
+#define REPLY_TIMEOUT_MS    1000
+#define WINDOW_MAX          64
+
+static int s_fd = -1;
+static MsgBuf s_rxBuf;
+
+
+////////////////////////////////////////
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((((uint64_t)ts.tv_sec) * 1000000) + (ts.tv_nsec / 1000));
+}
+
+////////////////////////////////////////
+static bool open_device(const char* p_device)
+{
+    s_fd = ::open(p_device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(s_fd < 0)
+    {
+        ::perror(p_device);
+        return(false);
+    }
+    struct termios tio;
+    ::tcgetattr(s_fd, &tio);
+    ::cfmakeraw(&tio);
+    ::cfsetspeed(&tio, B57600);
+    ::tcsetattr(s_fd, TCSANOW, &tio);
+    ::tcflush(s_fd, TCIOFLUSH);
+    return(true);
+}
+
+////////////////////////////////////////
+static bool send(const uint8_t p_type, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
+{
+    MsgBuf msg;
+    msg.set_bytes(p_type, p_param1, p_param2, p_param3);
+
+    uint8_t buf[RING_BUF_COUNT];
+    for(uint8_t i=0; i<RING_BUF_COUNT; ++i)
+    {
+        buf[i] = msg[i];
+    }
+    uint8_t off = 0;
+    while(off < RING_BUF_COUNT)
+    {
+        const ssize_t written = ::write(s_fd, &buf[off], (RING_BUF_COUNT - off));
+        if(written < 0)
+        {
+            struct pollfd pfd = { s_fd, POLLOUT, 0 };
+            if(::poll(&pfd, 1, REPLY_TIMEOUT_MS) <= 0)
+            {
+                ::perror("write");
+                return(false);
+            }
+            continue;
+        }
+        off += written;
+    }
+    return(true);
+}
+
+////////////////////////////////////////
+// wait for the next valid frame, false on timeout
+static bool receive(uint8_t& p_type, uint8_t& p_param1, uint8_t& p_param2, uint8_t& p_param3, const int p_timeoutMs=REPLY_TIMEOUT_MS)
+{
+    static uint8_t s_in[256];
+    static ssize_t s_inLen = 0;
+    static ssize_t s_inPos = 0;
+
+    const uint64_t end = (now_us() + (p_timeoutMs * 1000));
+    for(;;)
+    {
+        while(s_inPos < s_inLen)
+        {
+            s_rxBuf.push_back(s_in[s_inPos++]);
+            if(S_OK == s_rxBuf.validate())
+            {
+                s_rxBuf.get_bytes(p_type, p_param1, p_param2, p_param3);
+                s_rxBuf.clear();
+                return(true);
+            }
+        }
+
+        s_inPos = 0;
+        s_inLen = ::read(s_fd, s_in, sizeof(s_in));
+        if(s_inLen > 0)
+        {
+            continue;
+        }
+        s_inLen = 0;
+
+        const uint64_t now = now_us();
+        if(now >= end)
+        {
+            return(false);
+        }
+        struct pollfd pfd = { s_fd, POLLIN, 0 };
+        ::poll(&pfd, 1, (int)((end - now + 999) / 1000));
+    }
+}
+
+////////////////////////////////////////
+// send a message and wait for a reply of the given type and register
+static bool request(const uint8_t p_type, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3,
+                    const uint8_t p_replyType, const uint8_t p_replyRegister, uint8_t& p_value)
+{
+    if(!send(p_type, p_param1, p_param2, p_param3))
+    {
+        return(false);
+    }
+    uint8_t type, param1, param2, param3;
+    while(receive(type, param1, param2, param3))
+    {
+        if((type == p_replyType) && (param1 == p_replyRegister))
+        {
+            p_value = param2;
+            return(true);
+        }
+    }
+    return(false);
+}
+
+////////////////////////////////////////
+static bool read_register(const uint8_t p_register, uint8_t& p_value)
+{
+    return(request(MSG_READ_REGISTER, p_register, 0x00, 0x00, MSG_WRITE_REGISTER, p_register, p_value));
+}
+
+////////////////////////////////////////
+// read REG_LINK_CREDIT, the consumed count and window of the MSG_CREDIT answer
+static bool read_credit(uint16_t& p_consumed, uint8_t& p_window)
+{
+    if(!send(MSG_READ_REGISTER, REG_LINK_CREDIT, 0x00, 0x00))
+    {
+        return(false);
+    }
+    uint8_t type, param1, param2, param3;
+    while(receive(type, param1, param2, param3))
+    {
+        if((MSG_CREDIT == type) && (CREDIT_SYNC & param2))
+        {
+            p_consumed = ((param1 | (param2 << 8)) & CREDIT_COUNT_MASK);
+            p_window = param3;
+            return(true);
+        }
+    }
+    return(false);
+}
+
+////////////////////////////////////////
+static int s_failed = 0;
+static void check(const char* p_name, const bool p_ok, const uint8_t p_value, const uint8_t p_expected)
+{
+    if(p_ok && (p_value == p_expected))
+    {
+        ::printf("  ok    %s\n", p_name);
+        return;
+    }
+    ++s_failed;
+    if(p_ok)
+    {
+        ::printf("  FAIL  %s: 0x%02x, expected 0x%02x\n", p_name, p_value, p_expected);
+    }
+    else
+    {
+        ::printf("  FAIL  %s: no reply\n", p_name);
+    }
+}
+
+////////////////////////////////////////
+static int run_checks(void)
+{
+    ::printf("checks:\n");
+    uint8_t value = 0;
+    bool ok;
+
+    ok = request(MSG_PING, 0x12, 0x34, 0x56, MSG_PONG, 0x12, value);
+    check("ping", ok, value, 0x34);
+
+    send(MSG_WRITE_REGISTER, REG_OUTPUT_1, 0x00, 0xff);
+    ok = read_register(REG_OUTPUT_1, value);
+    check("write outputs 0x00", ok, value, 0x00);
+
+    send(MSG_WRITE_REGISTER, REG_OUTPUT_1, 0xa5, 0xff);
+    ok = read_register(REG_OUTPUT_1, value);
+    check("write outputs 0xa5", ok, value, 0xa5);
+
+    send(MSG_WRITE_REGISTER, REG_OUTPUT_1, 0xff, 0x0f);
+    ok = read_register(REG_OUTPUT_1, value);
+    check("masked write 0xff/0x0f", ok, value, 0xaf);
+
+    send(MSG_WRITE_REGISTER, REG_OUTPUT_1, 0x00, 0xff);
+    send(MSG_WRITE_REGISTER_BIT, REG_OUTPUT_1, 1, 0xff);  // relay 1
+    ok = read_register(REG_OUTPUT_1, value);
+    check("set relay 1", ok, value, 0x01);
+
+    send(MSG_WRITE_REGISTER_BIT, REG_OUTPUT_1, 1, 0x00);
+    ok = read_register(REG_OUTPUT_1, value);
+    check("clear relay 1", ok, value, 0x00);
+
+    send(MSG_PULSE_REGISTER_BIT, REG_OUTPUT_1, 3, 20);  // relay 3, 20ms
+    ok = read_register(REG_OUTPUT_1, value);
+    check("pulse relay 3 restores", ok, value, 0x00);
+
+    ok = request(MSG_SUBSCRIBE_REGISTER, REG_OUTPUT_1, 0x00, 0x00, MSG_SUBSCRIBE_REGISTER, REG_OUTPUT_1, value);
+    check("subscribe outputs", ok, value, 0x00);
+
+    ok = request(MSG_WRITE_REGISTER, REG_OUTPUT_1, 0x81, 0xff, MSG_SUBSCRIBE_REGISTER, REG_OUTPUT_1, value);
+    check("output change event", ok, value, 0x81);
+
+    ok = request(MSG_SUBSCRIBE_REGISTER, REG_OUTPUT_1, 0x00, 0x01, MSG_SUBSCRIBE_REGISTER, REG_OUTPUT_1, value);
+    check("cancel subscription", ok, value, 0x81);
+
+    send(MSG_WRITE_REGISTER, REG_OUTPUT_1, 0x00, 0xff);
+    ok = read_register(REG_OUTPUT_1, value);
+    check("outputs off", ok, value, 0x00);
+
+    ok = read_register(REG_INPUT_1, value);
+    check("inputs idle", ok, value, 0x00);
+
+    ok = request(MSG_READ_REGISTER, 0x42, 0x00, 0x00, MSG_WRITE_REGISTER, REG_ERR_UNKNOWN, value);
+    check("unknown register", ok, value, 0x00);
+
+    ok = read_register(REG_FW_VERSION, value);
+    check("firmware version", ok, value, FW_VERSION);
+
+    ok = read_register(REG_FW_CAPS, value);
+    check("firmware caps", ok, (value & (FW_CAP_RELIABLE | FW_CAP_CREDIT | FW_CAP_BUS)), (FW_CAP_RELIABLE | FW_CAP_CREDIT | FW_CAP_BUS));
+
+    // the count moves by exactly the bytes sent, the window is the rx ring
+    uint16_t first = 0;
+    uint16_t second = 0;
+    uint8_t window = 0;
+    ok = read_credit(first, window) && read_credit(second, window);
+    check("credit count", ok, (uint8_t)(second - first), RING_BUF_COUNT);
+    check("credit window", ok, window, 128);
+
+    ::printf("%d failed\n", s_failed);
+    return(s_failed);
+}
+
+////////////////////////////////////////
+static int run_bench(const uint32_t p_frames, const uint32_t p_window)
+{
+    uint64_t sent[WINDOW_MAX];
+    uint32_t tx = 0;
+    uint32_t rx = 0;
+    uint64_t rttSum = 0;
+    uint64_t rttMax = 0;
+
+    ::printf("benchmark: %u pings, %u in flight\n", p_frames, p_window);
+    const uint64_t start = now_us();
+    while(rx < p_frames)
+    {
+        while((tx < p_frames) && ((tx - rx) < p_window))
+        {
+            // the sequence number rides in the ping params and comes back in the pong
+            sent[tx % WINDOW_MAX] = now_us();
+            if(!send(MSG_PING, (tx >> 16) & 0xff, (tx >> 8) & 0xff, tx & 0xff))
+            {
+                return(1);
+            }
+            ++tx;
+        }
+
+        uint8_t type, param1, param2, param3;
+        if(!receive(type, param1, param2, param3))
+        {
+            ::printf("timeout: %u of %u pongs received, %u lost\n", rx, p_frames, (tx - rx));
+            return(1);
+        }
+        if(MSG_PONG != type)
+        {
+            continue;
+        }
+
+        const uint32_t seq = ((param1 << 16) | (param2 << 8) | param3);
+        if(seq != (rx & 0xffffff))
+        {
+            ::printf("out of sequence: pong %u, expected %u\n", seq, rx);
+            return(1);
+        }
+        const uint64_t rtt = (now_us() - sent[rx % WINDOW_MAX]);
+        rttSum += rtt;
+        if(rtt > rttMax)
+        {
+            rttMax = rtt;
+        }
+        ++rx;
+    }
+    const uint64_t elapsed = (now_us() - start);
+
+    ::printf("  %u frames in %.3f s: %.0f frames/s, %.0f bytes/s each way\n", rx, (elapsed / 1e6),
+             ((rx * 1e6) / elapsed), ((rx * RING_BUF_COUNT * 1e6) / elapsed));
+    ::printf("  round trip: avg %.1f us, max %llu us\n", ((double)rttSum / rx), (unsigned long long)rttMax);
+    return(0);
+}
+
+////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    uint32_t frames = 10000;
+    uint32_t window = 8;
+    bool checkOnly = false;
+    int opt;
+    while(-1 != (opt = ::getopt(argc, argv, "n:w:ch")))
+    {
+        switch(opt)
+        {
+            case 'n': frames = ::strtoul(optarg, 0, 0); break;
+            case 'w': window = ::strtoul(optarg, 0, 0); break;
+            case 'c': checkOnly = true; break;
+            default:  optind = argc + 1; break;
+        }
+    }
+    if((optind != (argc - 1)) || (0 == frames) || (0 == window) || (window > WINDOW_MAX))
+    {
+        ::fprintf(stderr, "usage: %s [-n frames] [-w window (1-%d)] [-c] device\n", argv[0], WINDOW_MAX);
+        return(1);
+    }
+
+    if(!open_device(argv[optind]))
+    {
+        return(1);
+    }
+
+    int ret = run_checks();
+    if((0 == ret) && !checkOnly)
+    {
+        ret = run_bench(frames, window);
+    }
+
+    ::close(s_fd);
+    return(ret ? 1 : 0);
+}
@@ -0,0 +1,603 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/boot.h>
+#include <avr/wdt.h>
+#include <util/delay.h>
+
+#include "sim.h"
+
+
+// isrs, only linked in when the firmware defines them
+extern "C" void sim_usart_rxc_vect(void) __attribute__((weak));
+extern "C" void sim_usart_txc_vect(void) __attribute__((weak));
+
+// EEMEM variables, see <avr/eeprom.h>
+extern "C" uint8_t __stop_sim_eeprom[] __attribute__((weak));
+
+#define EEPROM_SIZE     (E2END + 1)
+#define FLASH_SIZE      (FLASHEND + 1)
+#define TX_BUF_MAX      256
+#define RX_QUEUE_SIZE   4096  // power of 2
+
+// A140808 opto inputs 1-8 (active low), see avr_impl.cpp
+static volatile uint8_t* const s_inputPin[8] = { &PIND, &PIND, &PINC, &PINC, &PINC, &PINC, &PINC, &PINC };
+static const uint8_t s_inputBit[8] = { 5, 7, 3, 2, 4, 5, 6, 7 };
+// A140808 relays 1-8 (active low)
+static const uint8_t s_relayBit[8] = { 3, 2, 1, 0, 4, 5, 6, 7 };
+
+static sim::Options s_options;
+static int s_master = -1;
+static int s_slave = -1;
+static int s_eeprom = -1;
+static int s_flash = -1;
+static char s_ptyName[64] = { 0 };
+static volatile sig_atomic_t s_stop = 0;
+
+static uint8_t s_rxByte = 0;
+static uint8_t s_rxQueue[RX_QUEUE_SIZE];  // received, not yet read from UDR
+static uint32_t s_rxHead = 0;
+static uint32_t s_rxTail = 0;
+static uint8_t s_spmBuf[SPM_PAGESIZE];
+static uint8_t s_txBuf[TX_BUF_MAX];
+static uint16_t s_txLen = 0;
+static uint8_t s_lastOutputs = 0;
+static char s_stdinBuf[128];
+static uint8_t s_stdinLen = 0;
+static bool s_stdinOpen = true;
+
+// counters
+static uint64_t s_rxBytes = 0;
+static uint64_t s_rxDropped = 0;
+static uint64_t s_txBytes = 0;
+
+
+volatile uint8_t sim::io[0x40];
+volatile uint16_t sim::tcnt1 = 0;
+volatile uint16_t sim::ocr1a = 0;
+volatile uint8_t sim::ucsrc = 0;
+sim::DataRegister sim::udr;
+sim::StatusRegister sim::ucsra;
+static uint8_t s_ucsra = 0;
+uint8_t sim::eeprom[E2END + 1];
+uint8_t sim::flash[FLASHEND + 1];
+
+
+////////////////////////////////////////
+static void flush_tx(void)
+{
+    uint16_t off = 0;
+    while(off < s_txLen)
+    {
+        const ssize_t written = ::write(s_master, &s_txBuf[off], (s_txLen - off));
+        if(written < 0)
+        {
+            if(EAGAIN == errno)
+            {
+                // nobody is reading the slave and its queue is full
+                struct pollfd pfd = { s_master, POLLOUT, 0 };
+                ::poll(&pfd, 1, 100);
+                continue;
+            }
+            ::perror("sim: pty write");
+            break;
+        }
+        off += written;
+    }
+    s_txLen = 0;
+}
+
+////////////////////////////////////////
+sim::DataRegister::operator uint8_t(void) const
+{
+    s_ucsra &= ~_BV(RXC);
+    return(s_rxByte);
+}
+
+////////////////////////////////////////
+sim::DataRegister& sim::DataRegister::operator=(const uint8_t p_value)
+{
+    if(bit_is_set(UCSRB, TXEN))
+    {
+        s_txBuf[s_txLen++] = p_value;
+        ++s_txBytes;
+        if(s_txLen >= TX_BUF_MAX)
+        {
+            flush_tx();
+        }
+    }
+    return(*this);
+}
+
+////////////////////////////////////////
+// a polling receiver (RXCIE clear) sees the queued bytes one at a time,
+// each read of an empty receiver services the pty like _delay_ms() does
+sim::StatusRegister::operator uint8_t(void) const
+{
+    if(bit_is_clear(s_ucsra, RXC) && bit_is_set(UCSRB, RXEN) && bit_is_clear(UCSRB, RXCIE))
+    {
+        if(s_rxHead == s_rxTail)
+        {
+            service(0);
+        }
+        if(s_rxHead != s_rxTail)
+        {
+            s_rxByte = s_rxQueue[s_rxHead++ & (RX_QUEUE_SIZE - 1)];
+            s_ucsra |= _BV(RXC);
+        }
+    }
+    return(s_ucsra | _BV(UDRE) | _BV(TXC));
+}
+
+////////////////////////////////////////
+sim::StatusRegister& sim::StatusRegister::operator=(const uint8_t p_value)
+{
+    // U2X and MPCM are writable, the flags are not
+    s_ucsra = ((s_ucsra & ~(_BV(U2X) | _BV(MPCM))) | (p_value & (_BV(U2X) | _BV(MPCM))));
+    return(*this);
+}
+
+////////////////////////////////////////
+void sim::eeprom_written(const uint16_t p_addr)
+{
+    if(s_eeprom < 0)
+    {
+        return;
+    }
+    if(1 != ::pwrite(s_eeprom, &eeprom[p_addr], 1, p_addr))
+    {
+        ::perror("sim: eeprom write");
+    }
+}
+
+////////////////////////////////////////
+static void flash_written(const uint16_t p_addr)
+{
+    if(s_flash < 0)
+    {
+        return;
+    }
+    if(SPM_PAGESIZE != ::pwrite(s_flash, &sim::flash[p_addr], SPM_PAGESIZE, p_addr))
+    {
+        ::perror("sim: flash write");
+    }
+}
+
+////////////////////////////////////////
+void sim::spm_page_fill(const uint16_t p_addr, const uint16_t p_word)
+{
+    const uint8_t off = (p_addr & (SPM_PAGESIZE - 2));
+    s_spmBuf[off] = (p_word & 0xff);
+    s_spmBuf[off + 1] = (p_word >> 8);
+}
+
+////////////////////////////////////////
+void sim::spm_page_erase(const uint16_t p_addr)
+{
+    const uint16_t page = (p_addr & (FLASHEND & ~(SPM_PAGESIZE - 1)));
+    ::memset(&flash[page], 0xff, SPM_PAGESIZE);
+    flash_written(page);
+}
+
+////////////////////////////////////////
+void sim::spm_page_write(const uint16_t p_addr)
+{
+    // like the part: only clears bits, and the temporary buffer is erased after
+    const uint16_t page = (p_addr & (FLASHEND & ~(SPM_PAGESIZE - 1)));
+    for(uint8_t i=0; i<SPM_PAGESIZE; ++i)
+    {
+        flash[page + i] &= s_spmBuf[i];
+    }
+    ::memset(s_spmBuf, 0xff, sizeof(s_spmBuf));
+    flash_written(page);
+}
+
+////////////////////////////////////////
+void sim::start_application(void)
+{
+    flush_tx();
+    ::printf("jump to the application\n");
+    ::exit(0);  // uninit() runs from atexit
+}
+
+////////////////////////////////////////
+void sim::watchdog_reset(void)
+{
+    flush_tx();
+    ::printf("watchdog reset\n");
+    ::exit(0);
+}
+
+////////////////////////////////////////
+// load an eeprom or flash image, a new or short file is filled out as erased
+static int open_image(const char* p_path, uint8_t* p_mem, const size_t p_size)
+{
+    ::memset(p_mem, 0xff, p_size);
+    const int fd = ::open(p_path, O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+    {
+        ::perror(p_path);
+        return(-1);
+    }
+    const ssize_t len = ::pread(fd, p_mem, p_size, 0);
+    const size_t off = ((len < 0) ? 0 : len);
+    if((off < p_size) && ((ssize_t)(p_size - off) != ::pwrite(fd, (p_mem + off), (p_size - off), off)))
+    {
+        ::perror(p_path);
+    }
+    return(fd);
+}
+
+////////////////////////////////////////
+static uint64_t now_us(void)
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return((((uint64_t)ts.tv_sec) * 1000000) + (ts.tv_nsec / 1000));
+}
+
+////////////////////////////////////////
+// logical output register, bit set = relay on
+static uint8_t read_outputs(void)
+{
+    uint8_t outputs = 0;
+    for(uint8_t i=0; i<8; ++i)
+    {
+        if(bit_is_set(DDRA, s_relayBit[i]) && bit_is_clear(PORTA, s_relayBit[i]))
+        {
+            outputs |= _BV(i);
+        }
+    }
+    return(outputs);
+}
+
+////////////////////////////////////////
+static void print_outputs(void)
+{
+    const uint8_t outputs = read_outputs();
+    ::printf("relays:");
+    for(uint8_t i=0; i<8; ++i)
+    {
+        ::printf(" %c", (bit_is_set(outputs, i) ? ('1' + i) : '-'));
+    }
+    ::printf("  (PORTA: 0x%02x)\n", PORTA);
+    ::fflush(stdout);
+}
+
+////////////////////////////////////////
+static void print_status(void)
+{
+    print_outputs();
+    ::printf("inputs:");
+    for(uint8_t i=0; i<8; ++i)
+    {
+        ::printf(" %c", (bit_is_clear(*s_inputPin[i], s_inputBit[i]) ? ('1' + i) : '-'));
+    }
+    ::printf("  (PINC: 0x%02x  PIND: 0x%02x)\n", PINC, PIND);
+    ::printf("usart: rx %llu bytes (%llu dropped), tx %llu bytes\n",
+             (unsigned long long)s_rxBytes, (unsigned long long)s_rxDropped, (unsigned long long)s_txBytes);
+    ::fflush(stdout);
+}
+
+////////////////////////////////////////
+// stdin commands:
+//   in <1-8> <0|1>   drive an opto input
+//   pinc <hex>       set PINC
+//   pind <hex>       set PIND
+//   status           print outputs, inputs and usart counters
+//   quit
+static void process_command(const char* p_cmd)
+{
+    unsigned int num = 0;
+    unsigned int val = 0;
+    if(2 == ::sscanf(p_cmd, "in %u %u", &num, &val))
+    {
+        if((num < 1) || (num > 8))
+        {
+            ::printf("input out of range (1-8): %u\n", num);
+            return;
+        }
+        if(val)
+        {
+            *s_inputPin[num - 1] &= ~_BV(s_inputBit[num - 1]);  // active low
+        }
+        else
+        {
+            *s_inputPin[num - 1] |= _BV(s_inputBit[num - 1]);
+        }
+    }
+    else if(1 == ::sscanf(p_cmd, "pinc %x", &val))
+    {
+        PINC = val;
+    }
+    else if(1 == ::sscanf(p_cmd, "pind %x", &val))
+    {
+        PIND = val;
+    }
+    else if(0 == ::strncmp(p_cmd, "status", 6))
+    {
+        print_status();
+    }
+    else if(0 == ::strncmp(p_cmd, "quit", 4))
+    {
+        s_stop = 1;
+    }
+    else if('\0' != p_cmd[0])
+    {
+        ::printf("commands: in <1-8> <0|1>, pinc <hex>, pind <hex>, status, quit\n");
+    }
+    ::fflush(stdout);
+}
+
+////////////////////////////////////////
+static void read_stdin(void)
+{
+    char buf[64];
+    const ssize_t len = ::read(STDIN_FILENO, buf, sizeof(buf));
+    if(len <= 0)
+    {
+        s_stdinOpen = false;  // eof, keep running
+        return;
+    }
+    for(ssize_t i=0; i<len; ++i)
+    {
+        if('\n' == buf[i])
+        {
+            s_stdinBuf[s_stdinLen] = '\0';
+            process_command(s_stdinBuf);
+            s_stdinLen = 0;
+        }
+        else if(s_stdinLen < (sizeof(s_stdinBuf) - 1))
+        {
+            s_stdinBuf[s_stdinLen++] = buf[i];
+        }
+    }
+}
+
+////////////////////////////////////////
+// hand each received byte to the rx complete isr, or queue it for a
+// receiver that polls RXC
+static void read_pty(void)
+{
+    uint8_t buf[256];
+    const ssize_t len = ::read(s_master, buf, sizeof(buf));
+    if(len <= 0)
+    {
+        return;
+    }
+    s_rxBytes += len;
+
+    if(bit_is_clear(UCSRB, RXEN))
+    {
+        s_rxDropped += len;
+        return;
+    }
+
+    if(bit_is_clear(UCSRB, RXCIE))
+    {
+        for(ssize_t i=0; i<len; ++i)
+        {
+            if((s_rxTail - s_rxHead) >= RX_QUEUE_SIZE)
+            {
+                ++s_rxDropped;
+                continue;
+            }
+            s_rxQueue[s_rxTail++ & (RX_QUEUE_SIZE - 1)] = buf[i];
+        }
+        return;
+    }
+
+    if(bit_is_clear(SREG, 7) || !sim_usart_rxc_vect)
+    {
+        s_rxDropped += len;
+        return;
+    }
+
+    for(ssize_t i=0; i<len; ++i)
+    {
+        s_rxByte = buf[i];
+        s_ucsra |= _BV(RXC);
+        cli();  // the part clears I on isr entry and reti sets it again
+        sim_usart_rxc_vect();
+        sei();
+        s_ucsra &= ~_BV(RXC);
+    }
+}
+
+////////////////////////////////////////
+static void on_signal(int p_sig)
+{
+    s_stop = 1;
+}
+
+
+////////////////////////////////////////
+bool sim::init(const Options& p_options)
+{
+    s_options = p_options;
+
+    // reset state of the part, inputs float high through the pull-ups
+    ::memset((void*)io, 0, sizeof(io));
+    PINA = 0xff;
+    PINB = 0xff;
+    PINC = 0xff;
+    PIND = 0xff;
+    MCUCSR = _BV(PORF);
+
+    // eeprom and flash: erased, or the saved images
+    const size_t eeSize = (__stop_sim_eeprom - __start_sim_eeprom);
+    if(eeSize > EEPROM_SIZE)
+    {
+        ::fprintf(stderr, "sim: EEMEM uses %zu bytes, the atmega32 has %d\n", eeSize, EEPROM_SIZE);
+        return(false);
+    }
+    ::memset(eeprom, 0xff, sizeof(eeprom));
+    if(s_options.m_eeprom && ((s_eeprom = open_image(s_options.m_eeprom, eeprom, sizeof(eeprom))) < 0))
+    {
+        return(false);
+    }
+    ::memset(flash, 0xff, sizeof(flash));
+    ::memset(s_spmBuf, 0xff, sizeof(s_spmBuf));
+    if(s_options.m_flash && ((s_flash = open_image(s_options.m_flash, flash, sizeof(flash))) < 0))
+    {
+        return(false);
+    }
+
+    // usart pty, the simulator keeps the slave open so clients can come and go
+    s_master = ::posix_openpt(O_RDWR | O_NOCTTY);
+    if((s_master < 0) || (0 != ::grantpt(s_master)) || (0 != ::unlockpt(s_master)))
+    {
+        ::perror("sim: posix_openpt");
+        return(false);
+    }
+    ::snprintf(s_ptyName, sizeof(s_ptyName), "%s", ::ptsname(s_master));
+    s_slave = ::open(s_ptyName, O_RDWR | O_NOCTTY);
+    if(s_slave < 0)
+    {
+        ::perror(s_ptyName);
+        return(false);
+    }
+    struct termios tio;
+    ::tcgetattr(s_slave, &tio);
+    ::cfmakeraw(&tio);
+    ::tcsetattr(s_slave, TCSANOW, &tio);
+    ::fcntl(s_master, F_SETFL, ::fcntl(s_master, F_GETFL) | O_NONBLOCK);
+
+    if(s_options.m_link)
+    {
+        ::unlink(s_options.m_link);
+        if(0 != ::symlink(s_ptyName, s_options.m_link))
+        {
+            ::perror(s_options.m_link);
+            return(false);
+        }
+    }
+
+    ::signal(SIGINT, on_signal);
+    ::signal(SIGTERM, on_signal);
+    ::signal(SIGPIPE, SIG_IGN);
+    return(true);
+}
+
+////////////////////////////////////////
+void sim::uninit(void)
+{
+    if(s_master > -1)
+    {
+        flush_tx();
+        ::close(s_master);
+        s_master = -1;
+    }
+    if(s_slave > -1)
+    {
+        ::close(s_slave);
+        s_slave = -1;
+    }
+    if(s_eeprom > -1)
+    {
+        ::close(s_eeprom);
+        s_eeprom = -1;
+    }
+    if(s_flash > -1)
+    {
+        ::close(s_flash);
+        s_flash = -1;
+    }
+    if(s_options.m_link)
+    {
+        ::unlink(s_options.m_link);
+    }
+}
+
+////////////////////////////////////////
+const char* sim::pty_name(void)
+{
+    return(s_ptyName);
+}
+
+////////////////////////////////////////
+void sim::service(const int p_timeoutMs)
+{
+    flush_tx();
+
+    struct pollfd pfd[2];
+    pfd[0].fd = s_master;
+    pfd[0].events = POLLIN;
+    pfd[0].revents = 0;
+    pfd[1].fd = (s_stdinOpen ? STDIN_FILENO : -1);
+    pfd[1].events = POLLIN;
+    pfd[1].revents = 0;
+    if(::poll(pfd, 2, p_timeoutMs) > 0)
+    {
+        if(pfd[0].revents & POLLIN)
+        {
+            read_pty();
+        }
+        if(pfd[1].revents & (POLLIN | POLLHUP))
+        {
+            read_stdin();
+        }
+    }
+
+    if(!s_options.m_quiet)
+    {
+        const uint8_t outputs = read_outputs();
+        if(outputs != s_lastOutputs)
+        {
+            s_lastOutputs = outputs;
+            print_outputs();
+        }
+    }
+
+    if(s_stop)
+    {
+        print_status();
+        ::exit(0);  // uninit() runs from atexit
+    }
+}
+
+////////////////////////////////////////
+void sim::delay_ms(const double p_ms)
+{
+    if(s_options.m_fast)
+    {
+        service(0);
+        return;
+    }
+
+    const uint64_t end = (now_us() + (uint64_t)(p_ms * 1000));
+    do
+    {
+        const uint64_t now = now_us();
+        service((now < end) ? (int)((end - now + 999) / 1000) : 0);
+    } while(now_us() < end);
+}
@@ -0,0 +1,67 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __sim_h__
+#define __sim_h__
+
+#include <stdint.h>
+
+
+//
+// host build of the firmware, make host
+//
+// avr_main.cpp, avr_impl.cpp, serial.cpp and profile.cpp are compiled
+// unchanged with g++ against the headers in host/include, which map the
+// atmega32 i/o registers onto sim::io[]. the usart is wired to a pty:
+// bytes read from the pty are handed to the rx complete isr one at a time
+// and bytes written to UDR go straight back out. the bootloader
+// (boot/boot_main.cpp) runs the same way as a140808-boot-sim, it polls
+// RXC and programs sim::flash[].
+//
+// nothing runs concurrently with the firmware. the pty, stdin and the
+// interrupts are serviced whenever the firmware calls _delay_ms(), which
+// the main loop does once per iteration. with -f the delays return at
+// once and the main loop spins as fast as the host allows.
+//
+// not simulated: baud rate and parity (the pty is 8 bit clean and
+// instantaneous), the timers (TCNT1 does not count, so profiling builds
+// report zero cycles and the bootloader never times out), eeprom write
+// and spm time, and code in flash: the watchdog reset and the jump to the
+// application end the simulator.
+//
+
+////////////////////////////////////////////////////////////
+namespace sim
+{
+    struct Options
+    {
+        Options(void) : m_link(0), m_eeprom(0), m_flash(0), m_fast(false), m_quiet(false) { }
+        const char* m_link;     // symlink to create for the pty slave
+        const char* m_eeprom;   // eeprom image file, erased eeprom if not set
+        const char* m_flash;    // flash image file, erased flash if not set
+        bool m_fast;            // _delay_ms() does not sleep
+        bool m_quiet;           // do not report output changes
+    };
+
+    bool init(const Options& p_options);
+    void uninit(void);
+    void service(const int p_timeoutMs);
+    const char* pty_name(void);
+} // namespace sim
+
+#endif // __sim_h__
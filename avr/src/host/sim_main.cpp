@@ -0,0 +1,87 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// a140808-sim, a140808-boot-sim: the firmware or the bootloader on the host, see sim.h
+//
+//   a140808-sim [-f] [-q] [-l link] [-e eeprom.bin] [-F flash.bin]
+//
+//   -f  fast, _delay_ms() returns at once
+//   -q  quiet, do not report relay changes
+//   -l  create a symlink to the pty slave (ex: /tmp/ttyA140808)
+//   -e  eeprom image, restarting with the same image acts as a power cycle
+//   -F  flash image, written by the bootloader
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sim.h"
+
+int avr_main(void);  // avr_main.cpp or boot_main.cpp built with -Dmain=avr_main
+
+
+////////////////////////////////////////
+static void usage(const char* p_name)
+{
+    ::fprintf(stderr, "usage: %s [-f] [-q] [-l link] [-e eeprom.bin] [-F flash.bin]\n", p_name);
+}
+
+////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    sim::Options options;
+    int opt;
+    while(-1 != (opt = ::getopt(argc, argv, "fql:e:F:h")))
+    {
+        switch(opt)
+        {
+            case 'f': options.m_fast = true;     break;
+            case 'q': options.m_quiet = true;    break;
+            case 'l': options.m_link = optarg;   break;
+            case 'e': options.m_eeprom = optarg; break;
+            case 'F': options.m_flash = optarg;  break;
+            default:
+            {
+                usage(argv[0]);
+                return(1);
+            }
+        }
+    }
+
+    if(!sim::init(options))
+    {
+        sim::uninit();
+        return(1);
+    }
+    ::atexit(sim::uninit);
+
+    if(options.m_link)
+    {
+        ::printf("usart on %s -> %s\n", options.m_link, sim::pty_name());
+    }
+    else
+    {
+        ::printf("usart on %s\n", sim::pty_name());
+    }
+    ::fflush(stdout);
+
+    // does not return
+    return(avr_main());
+}
@@ -20,6 +20,7 @@
 #define __msg_buf_h__
 
 #include "ring_buffer.h"
+#include "msg_defs.h"  // BUS_ADDRESS_*
 
 
 //
@@ -35,7 +36,27 @@
 //   cccc     = crc of bytes 1-8 (hex 0-9, a-f)
 //   ]        = end message
 //
+// on a multi-drop bus the frame carries the board's address, 16 chars
+//
+// | { | a | a | x | x | x | x | x | x | x | x | c | c | c | c | } |
+// +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---|---+
+// | 0 | 1 | 2 | 3 | 4 | 5 | 6 | 7 | 8 | 9 | a | b | c | d | e | f |
+//
+//   aa       = bus address, the board the request is for or the reply is from
+//   cccc     = crc of bytes 1-10
+//
+// a reliable command on a point to point link carries a sequence number
+// in the same place, 16 chars (SEQ_* in msg_defs.h)
+//
+// | < | s | s | x | x | x | x | x | x | x | x | c | c | c | c | > |
+//
+//   ss       = sequence number, SEQ_REPLY set on the answer
+//
+// the buffer slides over the incoming chars and a frame is matched by the
+// end marker of the last char, so all kinds can share one link
+//
 #define RING_BUF_COUNT 14
+#define BUS_BUF_COUNT  16
 
 
 // error codes
@@ -46,6 +67,10 @@
 
 #define MSG_BEGIN_CHAR '['
 #define MSG_END_CHAR   ']'
+#define BUS_BEGIN_CHAR '{'
+#define BUS_END_CHAR   '}'
+#define SEQ_BEGIN_CHAR '<'
+#define SEQ_END_CHAR   '>'
 
 #define DEC2HEX(dc)  ((uint8_t)(((dc)>=0 && (dc)<=9) ? (dc)+'0' : (((dc)>=10 && (dc)<=15) ? (dc)-10+'a': 'z')))
 #define HEX2DEC(hx)  ((uint8_t)(((hx)>='0' && (hx)<='9') ? (hx)-'0' : (((hx)>='A' && (hx)<='F') ? (hx)-'A'+10 : (((hx)>='a' && (hx)<='f') ? (hx)-'a'+10 : 0))))
@@ -58,7 +83,7 @@ class MsgBuf : public RingBuffer
 {
 public:
     ////////////////////////////////////////
-    MsgBuf(void) : RingBuffer(RING_BUF_COUNT)
+    MsgBuf(void) : RingBuffer(BUS_BUF_COUNT)
     {
     }
 
@@ -80,56 +105,88 @@ public:
             return(false);
         }
 
-        p_val0 = ((HEX2DEC(at(1)) << 4) | HEX2DEC(at(2)));
-        p_val1 = ((HEX2DEC(at(3)) << 4) | HEX2DEC(at(4)));
-        p_val2 = ((HEX2DEC(at(5)) << 4) | HEX2DEC(at(6)));
-        p_val3 = ((HEX2DEC(at(7)) << 4) | HEX2DEC(at(8)));
+        // payload follows the begin marker and the address or sequence number, if any
+        const uint8_t pos = ((size() - frame_size()) + ((RING_BUF_COUNT == frame_size()) ? 1 : 3));
+        p_val0 = get_hex(pos);
+        p_val1 = get_hex(pos + 2);
+        p_val2 = get_hex(pos + 4);
+        p_val3 = get_hex(pos + 6);
 
         return(true);
     }
 
     ////////////////////////////////////////
-    void set_bytes(const uint8_t p_val0, const uint8_t p_val1, const uint8_t p_val2, const uint8_t p_val3)
+    // the bus address of a valid frame, BUS_ADDRESS_NONE for a point to point frame
+    uint8_t get_address(void) const
     {
-        clear();
-        push_back(MSG_BEGIN_CHAR);                  // byte  0
+        if((BUS_END_CHAR != at(size() - 1)) || (S_OK != validate()))
+        {
+            return(BUS_ADDRESS_NONE);
+        }
+        return(get_hex((size() - BUS_BUF_COUNT) + 1));
+    }
 
-        push_back(DEC2HEX((p_val0>>4) & 0x0f));     // byte  1
-        push_back(DEC2HEX( p_val0     & 0x0f));     // byte  2
-        push_back(DEC2HEX((p_val1>>4) & 0x0f));     // byte  3
-        push_back(DEC2HEX( p_val1     & 0x0f));     // byte  4
-        push_back(DEC2HEX((p_val2>>4) & 0x0f));     // byte  5
-        push_back(DEC2HEX( p_val2     & 0x0f));     // byte  6
-        push_back(DEC2HEX((p_val3>>4) & 0x0f));     // byte  7
-        push_back(DEC2HEX( p_val3     & 0x0f));     // byte  8
+    ////////////////////////////////////////
+    // true and the sequence number of a valid sequenced frame
+    bool get_seq(uint8_t& p_seq) const
+    {
+        p_seq = 0;
+        if((SEQ_END_CHAR != at(size() - 1)) || (S_OK != validate()))
+        {
+            return(false);
+        }
+        p_seq = get_hex((size() - BUS_BUF_COUNT) + 1);
+        return(true);
+    }
 
-        const uint16_t crc = compute_crc();
-        push_back(DEC2HEX((crc  >>12) & 0x0f));     // byte  9
-        push_back(DEC2HEX((crc  >> 8) & 0x0f));     // byte 10
-        push_back(DEC2HEX((crc  >> 4) & 0x0f));     // byte 11
-        push_back(DEC2HEX( crc        & 0x0f));     // byte 12
+    ////////////////////////////////////////
+    void set_bytes(const uint8_t p_val0, const uint8_t p_val1, const uint8_t p_val2, const uint8_t p_val3)
+    {
+        set_bytes(BUS_ADDRESS_NONE, p_val0, p_val1, p_val2, p_val3);
+    }
 
-        push_back(MSG_END_CHAR);                    // byte 13
+    ////////////////////////////////////////
+    // a sequenced frame
+    void set_seq_bytes(const uint8_t p_seq, const uint8_t p_val0, const uint8_t p_val1, const uint8_t p_val2, const uint8_t p_val3)
+    {
+        set_frame(SEQ_BEGIN_CHAR, true, p_seq, p_val0, p_val1, p_val2, p_val3);
+    }
+
+    ////////////////////////////////////////
+    // p_address
+    //   BUS_ADDRESS_NONE: point to point frame
+    //   otherwise:        bus frame
+    void set_bytes(const uint8_t p_address, const uint8_t p_val0, const uint8_t p_val1, const uint8_t p_val2, const uint8_t p_val3)
+    {
+        const bool bus = (BUS_ADDRESS_NONE != p_address);
+        set_frame((bus ? BUS_BEGIN_CHAR : MSG_BEGIN_CHAR), bus, p_address, p_val0, p_val1, p_val2, p_val3);
     }
 
     ////////////////////////////////////////
     uint8_t validate(void) const
     {
         // to be valid, we need 14 chars
-        if(size() < 14)
+        if(size() < RING_BUF_COUNT)
         {
             // not a big deal as the message may still be coming in
             return(S_INCOMPLETE_BUFFER);
         }
 
         // check begin and end markers
-        if((MSG_BEGIN_CHAR != at(0)) || (MSG_END_CHAR != at(13)))
+        const uint8_t len = frame_size();
+        if((0 == len) || (size() < len))
+        {
+            return(E_BAD_FRAME);
+        }
+        const uint8_t base = (size() - len);
+        if(begin_char(at(size() - 1)) != at(base))
         {
             return(E_BAD_FRAME);
         }
 
-        // check crc
-        if(get_crc() != compute_crc())
+        // check crc, stored in the 4 chars before the end marker
+        const uint8_t crcPos = (base + len - 5);
+        if(((((uint16_t)get_hex(crcPos)) << 8) | get_hex(crcPos + 2)) != compute_crc(base, (len - 6)))
         {
             return(E_BAD_CRC);
         }
@@ -138,6 +195,59 @@ public:
     }
 
 private:
+    ////////////////////////////////////////
+    // chars in the frame the last char would end, 0 if it is not an end marker
+    uint8_t frame_size(void) const
+    {
+        const uint8_t last = at(size() - 1);
+        if(MSG_END_CHAR == last)
+        {
+            return(RING_BUF_COUNT);
+        }
+        if((BUS_END_CHAR == last) || (SEQ_END_CHAR == last))
+        {
+            return(BUS_BUF_COUNT);
+        }
+        return(0);
+    }
+    ////////////////////////////////////////
+    static uint8_t begin_char(const uint8_t p_end)
+    {
+        return((MSG_END_CHAR == p_end) ? MSG_BEGIN_CHAR : ((BUS_END_CHAR == p_end) ? BUS_BEGIN_CHAR : SEQ_BEGIN_CHAR));
+    }
+    ////////////////////////////////////////
+    // p_prefixed: the address or sequence number in p_prefix goes first
+    void set_frame(const uint8_t p_begin, const bool p_prefixed, const uint8_t p_prefix, const uint8_t p_val0, const uint8_t p_val1, const uint8_t p_val2, const uint8_t p_val3)
+    {
+        clear();
+        push_back(p_begin);
+        if(p_prefixed)
+        {
+            push_hex(p_prefix);
+        }
+
+        push_hex(p_val0);
+        push_hex(p_val1);
+        push_hex(p_val2);
+        push_hex(p_val3);
+
+        const uint16_t crc = compute_crc(0, size() - 1);
+        push_hex(crc >> 8);
+        push_hex(crc & 0xff);
+
+        push_back((MSG_BEGIN_CHAR == p_begin) ? MSG_END_CHAR : ((BUS_BEGIN_CHAR == p_begin) ? BUS_END_CHAR : SEQ_END_CHAR));
+    }
+    ////////////////////////////////////////
+    uint8_t get_hex(const uint8_t p_pos) const
+    {
+        return((HEX2DEC(at(p_pos)) << 4) | HEX2DEC(at(p_pos + 1)));
+    }
+    ////////////////////////////////////////
+    void push_hex(const uint8_t p_val)
+    {
+        push_back(DEC2HEX((p_val >> 4) & 0x0f));
+        push_back(DEC2HEX( p_val       & 0x0f));
+    }
     ////////////////////////////////////////
     uint16_t update_crc16(const uint16_t p_crc, const uint8_t p_ch) const
     {
@@ -153,27 +263,14 @@ private:
         return(crc);
     }
     ////////////////////////////////////////
-    uint16_t get_crc(void) const
+    // crc of the p_count chars after the begin marker at p_base
+    uint16_t compute_crc(const uint8_t p_base, const uint8_t p_count) const
     {
-        // stored in bytes 9-12
-        return( (((uint16_t)HEX2DEC(at( 9))) << 12) |
-                (((uint16_t)HEX2DEC(at(10))) <<  8) |
-                (((uint16_t)HEX2DEC(at(11))) <<  4) |
-                 ((uint16_t)HEX2DEC(at(12)))        );
-    }
-    ////////////////////////////////////////
-    uint16_t compute_crc(void) const
-    {
-        // crc of bytes 1-8
         uint16_t crc = 0xffff;
-        crc = update_crc16(crc, at(1));
-        crc = update_crc16(crc, at(2));
-        crc = update_crc16(crc, at(3));
-        crc = update_crc16(crc, at(4));
-        crc = update_crc16(crc, at(5));
-        crc = update_crc16(crc, at(6));
-        crc = update_crc16(crc, at(7));
-        crc = update_crc16(crc, at(8));
+        for(uint8_t i=1; i<=p_count; ++i)
+        {
+            crc = update_crc16(crc, at(p_base + i));
+        }
         return(crc);
     }
 };
@@ -0,0 +1,99 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __msg_defs_h__
+#define __msg_defs_h__
+
+//
+// message and register numbers shared by the firmware and the daemon,
+// plain defines so the daemon's c code can include this too
+//
+
+// top level messages
+#define MSG_PING                 0x01
+#define MSG_PONG                 0x02
+#define MSG_READ_REGISTER        0x11
+#define MSG_WRITE_REGISTER       0x21
+#define MSG_WRITE_REGISTER_BIT   0x31
+#define MSG_PULSE_REGISTER_BIT   0x41
+#define MSG_SUBSCRIBE_REGISTER   0x51
+#define MSG_POLL                 0x61  // multi-drop bus, see msg_processor.h
+#define MSG_CREDIT               0x71  // point to point flow control, below
+#define MSG_ACK                  0x81  // reliable commands, below
+// register defs
+#define REG_ERR_UNKNOWN          0x9F
+#define REG_INPUT_1              0xA1
+#define REG_OUTPUT_1             0xD1
+#define REG_POWERON_POLICY       0xE1  // 0: all off, 1: restore last, 2: all on
+#define REG_BUS_ADDRESS          0xE2  // multi-drop bus address, BUS_ADDRESS_NONE for a point to point link
+#define REG_BOOT_REQUEST         0xE3  // write BOOT_REQUEST_KEY to reset into the bootloader (boot_defs.h)
+#define REG_LINK_CREDIT          0xE4  // read: MSG_CREDIT back with CREDIT_SYNC set
+#define REG_FW_VERSION           0xE5  // read only: FW_VERSION, below
+#define REG_FW_CAPS              0xE6  // read only: the FW_CAP_* the firmware was built with
+// diagnostics registers, firmware built with USE_PROFILING only (see profile.h)
+// 16-bit replies come back in value (low byte) and mask (high byte)
+#define REG_DIAG_LOOP_RATE       0xE8  // main loop iterations per second
+#define REG_DIAG_RX_PEAK         0xE9  // peak rx ring depth (bytes)
+#define REG_DIAG_RX_OVERFLOW     0xEA  // rx ring overflows (oldest byte lost)
+#define REG_DIAG_RX_PARITY       0xEB  // rx bytes dropped with parity errors
+#define REG_DIAG_RX_OVERRUN      0xEC  // usart hardware data overruns
+#define REG_DIAG_RESET           0xEF  // write any value to clear all stats
+#define REG_DIAG_SLOT            0xF0  // 0xF0 + (PROF_* slot * 4) + DIAG_STAT_*
+#define DIAG_STAT_MIN            0     // min cycles
+#define DIAG_STAT_AVG            1     // average cycles
+#define DIAG_STAT_MAX            2     // max cycles
+#define DIAG_STAT_COUNT          3     // samples in the average
+// multi-drop bus addresses (msg_buf.h), boards are 0x01-0xFE
+#define BUS_ADDRESS_NONE         0x00  // point to point, unaddressed frames
+#define BUS_ADDRESS_BROADCAST    0xFF  // every board acts on it, none answers
+// flow control on a point to point link, the board tells the daemon how
+// far it got through the bytes sent to it so the daemon never has more in
+// flight than the board's rx ring holds. sent by the board whenever the
+// count moves:
+//   param1: rx bytes consumed, bits 0-7
+//   param2: rx bytes consumed, bits 8-13 (CREDIT_COUNT_MASK) | CREDIT_*
+//   param3: rx ring size in bytes, the window
+// the count covers bytes lost to parity errors and overflows as well
+#define CREDIT_COUNT_MASK        0x3FFF  // the count wraps
+#define CREDIT_SYNC              0x40    // the answer to a read of REG_LINK_CREDIT
+#define CREDIT_RESTART           0x80    // the first one since the board started
+// reliable commands on a point to point link, in sequenced frames (msg_buf.h).
+// the board runs them strictly in order and answers each with its number
+// | SEQ_REPLY, with MSG_ACK if the command has no answer of its own:
+//   param1: type of the command
+//   param2: its param1, the register
+//   param3: ACK_*
+// a command that ran already is answered again without running twice,
+// idempotent ones (MSG_PING, MSG_READ_REGISTER) by running them and the
+// rest with ACK_DUPLICATE. one after a gap is dropped and the daemon sends
+// everything from the gap again (go-back-n). sequence number 0 starts
+// over, the daemon begins with a MSG_PING numbered 0
+#define SEQ_MAX                  0x7F    // 1 to SEQ_MAX, then 1 again
+#define SEQ_REPLY                0x80
+#define ACK_OK                   0x00
+#define ACK_DUPLICATE            0x01    // ran before, not again
+// what the firmware is, so the daemon can tell what a board does without
+// trying it. firmware from before these registers answers REG_ERR_UNKNOWN
+#define FW_VERSION               0x02
+#define FW_CAP_RELIABLE          0x01    // sequenced frames and MSG_ACK
+#define FW_CAP_CREDIT            0x02    // MSG_CREDIT flow control
+#define FW_CAP_BUS               0x04    // multi-drop bus addressing and MSG_POLL
+#define FW_CAP_RS485             0x08    // built with USE_RS485_RTS
+#define FW_CAP_PROFILING         0x10    // built with USE_PROFILING, the REG_DIAG_* registers
+
+#endif // __msg_defs_h__
@@ -19,57 +19,119 @@
 #ifndef __msg_processor_h__
 #define __msg_processor_h__
 
+#include "msg_defs.h"
 #include "msg_buf.h"
-#include "serial.h"
+#include "profile.h"
 
 
-// top level messages
-#define MSG_PING                 0x01
-#define MSG_PONG                 0x02
-#define MSG_READ_REGISTER        0x11
-#define MSG_WRITE_REGISTER       0x21
-#define MSG_WRITE_REGISTER_BIT   0x31
-#define MSG_PULSE_REGISTER_BIT   0x41
-#define MSG_SUBSCRIBE_REGISTER   0x51
-// register defs
-#define REG_ERR_UNKNOWN          0x9F
-#define REG_INPUT_1              0xA1
-#define REG_OUTPUT_1             0xD1
-
-
-// event callbacks, impl by avr_impl.cpp right now
-class MsgProcessor;
-void on_poll(MsgProcessor& p_mp);
-void on_pong(MsgProcessor& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3);
-void on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress);
-void on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask);
-void on_write_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state);
-void on_pulse_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs);
-void on_subscribe_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel);
-
+//
+// the protocol engine, shared by the firmware, the host test console and
+// the daemon (msg_proc.cpp)
+//
+// Transport moves frames, ex: SerialPort
+//   bool read(Codec& p_msg);    collect bytes into p_msg, true once it holds a valid frame
+//   bool write(Codec& p_msg);   send the frame in p_msg
+//
+// Handler receives the events, called directly so they can be inlined
+//   void on_poll(MsgProcessorT& p_mp);
+//   void on_pong(MsgProcessorT& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3);
+//   void on_read_register(MsgProcessorT& p_mp, const uint8_t p_registerAddress);
+//   void on_write_register(MsgProcessorT& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask);
+//   void on_write_register_bit(MsgProcessorT& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state);
+//   void on_pulse_register_bit(MsgProcessorT& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs);
+//   void on_subscribe_register(MsgProcessorT& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel);
+//
+// Codec encodes and decodes frames, MsgBuf by default
+//   void set_bytes(const uint8_t p_val0, const uint8_t p_val1, const uint8_t p_val2, const uint8_t p_val3);
+//   bool get_bytes(uint8_t& p_val0, uint8_t& p_val1, uint8_t& p_val2, uint8_t& p_val3) const;
+//   void set_bytes(const uint8_t p_address, const uint8_t p_val0, const uint8_t p_val1, const uint8_t p_val2, const uint8_t p_val3);
+//   uint8_t get_address(void) const;
+//   void set_seq_bytes(const uint8_t p_seq, const uint8_t p_val0, const uint8_t p_val1, const uint8_t p_val2, const uint8_t p_val3);
+//   bool get_seq(uint8_t& p_seq) const;
+//   void clear(void);
+//
+// an engine only holds references to its transport and handler, so any
+// number of them can run in one process
+//
+// incoming frames are assembled in their own buffer and decoded into a
+// queue of up to MP_RX_QUEUE messages before any is handled, replies are
+// encoded in a second buffer. answering a message can't clobber the bytes
+// of the next one and a burst of frames is handled in a single poll()
+//
+// multi-drop bus (BUS_ADDRESS_*, the frame is in msg_buf.h)
+//   board:  set_address() gives the engine its own address. it only takes
+//           frames for that address or BUS_ADDRESS_BROADCAST and answers the
+//           former, everything the handler sends outside of an answer (ex:
+//           from on_poll) is queued until the master asks with MSG_POLL. a
+//           poll takes one queued frame, or MSG_POLL back if none is left
+//   master: address stays BUS_ADDRESS_NONE, select() picks the board the
+//           following dispatch_* calls go to and rx_address() tells which
+//           board the frame being handled came from
+//
+// reliable commands (SEQ_* in msg_defs.h), point to point only: a numbered
+// request runs if it is the next one, its answers go back numbered and
+// MSG_ACK stands in if the handler has none. the daemon's transport does
+// the numbering and the retries, numbered answers are handled as usual
+//
+#define BUS_EVENT_QUEUE  4  // frames a board holds for MSG_POLL, the oldest is dropped
+#define MP_RX_QUEUE      4  // decoded messages per poll()
+#define MP_SEQ_WINDOW    8  // numbers behind the last one taken for a retry, more than the daemon has in flight
+#define MP_SEQ_NONE      0xFF
 
 
 ////////////////////////////////////////////////////////////
-class MsgProcessor
+template<class Transport, class Handler, class Codec = MsgBuf>
+class MsgProcessorT
 {
 public:
     ////////////////////////////////////////
-    MsgProcessor(void)
+    MsgProcessorT(Transport& p_transport, Handler& p_handler)
+      : m_transport(p_transport), m_handler(p_handler),
+        m_address(BUS_ADDRESS_NONE), m_txAddress(BUS_ADDRESS_NONE), m_rxAddress(BUS_ADDRESS_NONE),
+        m_answering(false), m_rxHead(0), m_rxCount(0), m_eventHead(0), m_eventCount(0),
+        m_txSeq(MP_SEQ_NONE), m_seqAnswered(false), m_seqLast(MP_SEQ_NONE)
+    {
+    }
+
+    ////////////////////////////////////////
+    Transport& transport(void)
+    {
+        return(m_transport);
+    }
+
+    ////////////////////////////////////////
+    Handler& handler(void)
+    {
+        return(m_handler);
+    }
+
+    ////////////////////////////////////////
+    // board: our bus address, BUS_ADDRESS_NONE for a point to point link
+    void set_address(const uint8_t p_address)
     {
+        m_address = p_address;
+        m_txAddress = p_address;
+        m_eventCount = 0;
     }
 
     ////////////////////////////////////////
-//    ~MsgProcessor(void)
-//    {
-//    }
+    uint8_t address(void) const
+    {
+        return(m_address);
+    }
 
     ////////////////////////////////////////
-    // p_parity
-    //   false: N81 (none, 8 data, 1 stop)
-    //   true:  E71 (even, 7 data, 1 stop)
-    bool init(const char* p_device, const uint16_t p_baud, const bool p_parity)
+    // master: the board for the following dispatch_* calls
+    void select(const uint8_t p_address)
     {
-        return(m_serialPort.init(p_device, p_baud, p_parity));
+        m_txAddress = p_address;
+    }
+
+    ////////////////////////////////////////
+    // the bus address of the frame being handled
+    uint8_t rx_address(void) const
+    {
+        return(m_rxAddress);
     }
 
     ////////////////////////////////////////
@@ -119,37 +181,170 @@ public:
     ////////////////////////////////////////
     bool dispatch_message(const uint8_t p_type, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
     {
-        m_msgBuf.set_bytes(p_type, p_param1, p_param2, p_param3);
-        return(m_serialPort.write(m_msgBuf));
+        if(BUS_ADDRESS_NONE != m_address)
+        {
+            // a board on a bus only talks when asked
+            if(!m_answering)
+            {
+                queue_event(p_type, p_param1, p_param2, p_param3);
+                return(true);
+            }
+            if(BUS_ADDRESS_BROADCAST == m_rxAddress)
+            {
+                return(true);
+            }
+        }
+        if(MP_SEQ_NONE != m_txSeq)
+        {
+            m_txBuf.set_seq_bytes(m_txSeq, p_type, p_param1, p_param2, p_param3);
+            m_seqAnswered = true;
+        }
+        else
+        {
+            m_txBuf.set_bytes(m_txAddress, p_type, p_param1, p_param2, p_param3);
+        }
+        return(m_transport.write(m_txBuf));
     }
 
     ////////////////////////////////////////
     void poll(void)
     {
-        if(m_serialPort.read(m_msgBuf))
+        PROFILE_LOOP();
+        PROFILE_BEGIN(PROF_POLL);
+        receive();
+        while(m_rxCount > 0)
         {
-            uint8_t type;
-            uint8_t param1;
-            uint8_t param2;
-            uint8_t param3;
-            if(!m_msgBuf.get_bytes(type, param1, param2, param3))
+            const Message& msg = m_rxQueue[m_rxHead];
+            m_rxAddress = msg.m_address;
+            m_answering = true;
+            if((MP_SEQ_NONE != msg.m_seq) && (0 == (SEQ_REPLY & msg.m_seq)))
             {
-                return;
+                process_sequenced(msg);
             }
-
-            process_message(type, param1, param2, param3);
+            else
+            {
+                process_message(msg.m_type, msg.m_param1, msg.m_param2, msg.m_param3);
+            }
+            m_answering = false;
+            m_rxHead = ((m_rxHead + 1) % MP_RX_QUEUE);
+            --m_rxCount;
         }
 
-        on_poll(*this);
+        m_handler.on_poll(*this);
+        PROFILE_END(PROF_POLL);
     }
 
 private:
-    MsgBuf m_msgBuf;
-    SerialPort m_serialPort;
+    Transport& m_transport;
+    Handler& m_handler;
+    struct Message
+    {
+        uint8_t m_address;
+        uint8_t m_seq;        // MP_SEQ_NONE if not numbered
+        uint8_t m_type;
+        uint8_t m_param1;
+        uint8_t m_param2;
+        uint8_t m_param3;
+    };
+
+    Codec m_rxBuf;        // frame being assembled
+    Codec m_txBuf;        // frame being sent
+    uint8_t m_address;    // ours, board on a bus only
+    uint8_t m_txAddress;  // stamped on outgoing frames
+    uint8_t m_rxAddress;  // of the frame being handled
+    bool m_answering;     // handling a received frame, a board may answer it
+    Message m_rxQueue[MP_RX_QUEUE];
+    uint8_t m_rxHead;
+    uint8_t m_rxCount;
+    uint8_t m_events[BUS_EVENT_QUEUE][4];
+    uint8_t m_eventHead;
+    uint8_t m_eventCount;
+    uint8_t m_txSeq;      // stamped on the answers to a numbered request
+    bool m_seqAnswered;   // the handler answered it
+    uint8_t m_seqLast;    // of the last numbered request that ran
+
+    ////////////////////////////////////////
+    // decode the waiting frames into m_rxQueue
+    void receive(void)
+    {
+        while((m_rxCount < MP_RX_QUEUE) && m_transport.read(m_rxBuf))
+        {
+            Message& msg = m_rxQueue[(m_rxHead + m_rxCount) % MP_RX_QUEUE];
+            const bool valid = m_rxBuf.get_bytes(msg.m_type, msg.m_param1, msg.m_param2, msg.m_param3);
+            msg.m_address = m_rxBuf.get_address();
+            if(!m_rxBuf.get_seq(msg.m_seq))
+            {
+                msg.m_seq = MP_SEQ_NONE;
+            }
+            m_rxBuf.clear();
+            if(!valid)
+            {
+                continue;
+            }
+            if((BUS_ADDRESS_NONE != m_address) && (m_address != msg.m_address) && (BUS_ADDRESS_BROADCAST != msg.m_address))
+            {
+                // traffic of another board
+                continue;
+            }
+            ++m_rxCount;
+        }
+    }
+
+    ////////////////////////////////////////
+    // go-back-n, runs p_msg only if it is the next one so nothing runs out of
+    // order or twice
+    void process_sequenced(const Message& p_msg)
+    {
+        const uint8_t seq = p_msg.m_seq;
+        m_txSeq = (seq | SEQ_REPLY);
+        m_seqAnswered = false;
+        if((0 == seq) || (MP_SEQ_NONE == m_seqLast) || (seq == ((m_seqLast % SEQ_MAX) + 1)))
+        {
+            // the next one, or the daemon or the board started over
+            m_seqLast = seq;
+            process_message(p_msg.m_type, p_msg.m_param1, p_msg.m_param2, p_msg.m_param3);
+            if(!m_seqAnswered)
+            {
+                dispatch_message(MSG_ACK, p_msg.m_type, p_msg.m_param1, ACK_OK);
+            }
+        }
+        else if((0 != m_seqLast) && (((m_seqLast + SEQ_MAX - seq) % SEQ_MAX) < MP_SEQ_WINDOW))
+        {
+            // a retry, its answer got lost
+            if((MSG_PING == p_msg.m_type) || (MSG_READ_REGISTER == p_msg.m_type))
+            {
+                process_message(p_msg.m_type, p_msg.m_param1, p_msg.m_param2, p_msg.m_param3);
+            }
+            else
+            {
+                dispatch_message(MSG_ACK, p_msg.m_type, p_msg.m_param1, ACK_DUPLICATE);
+            }
+        }
+        // else after a gap, the daemon sends the missing ones first
+        m_txSeq = MP_SEQ_NONE;
+    }
+
+    ////////////////////////////////////////
+    void queue_event(const uint8_t p_type, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
+    {
+        if(BUS_EVENT_QUEUE == m_eventCount)
+        {
+            // full, the newer state wins
+            m_eventHead = ((m_eventHead + 1) % BUS_EVENT_QUEUE);
+            --m_eventCount;
+        }
+        uint8_t* event = m_events[(m_eventHead + m_eventCount) % BUS_EVENT_QUEUE];
+        event[0] = p_type;
+        event[1] = p_param1;
+        event[2] = p_param2;
+        event[3] = p_param3;
+        ++m_eventCount;
+    }
 
     ////////////////////////////////////////
     void process_message(const uint8_t p_type, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
     {
+        PROFILE_BEGIN(PROF_MESSAGE);
         switch(p_type)
         {
             case MSG_PING:
@@ -160,15 +355,17 @@ private:
 
             case MSG_PONG:
             {
-                on_pong(*this, p_param1, p_param2, p_param3);
+                // param1: ping value1 (0-255)
+                // param2: ping value2 (0-255)
+                // param3: ping value3 (0-255)
+                m_handler.on_pong(*this, p_param1, p_param2, p_param3);
                 break;
             }
 
             case MSG_READ_REGISTER:
             {
                 // param1: register address (0-255)
-                // void on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress);
-                on_read_register(*this, p_param1);
+                m_handler.on_read_register(*this, p_param1);
                 break;
             }
 
@@ -177,8 +374,7 @@ private:
                 // param1: register address (0-255)
                 // param2: value (0-255)
                 // param3: mask (0-255)
-                // void on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask);
-                on_write_register(*this, p_param1, p_param2, p_param3);
+                m_handler.on_write_register(*this, p_param1, p_param2, p_param3);
                 break;
             }
 
@@ -187,10 +383,9 @@ private:
                 // param1: register address (0-255)
                 // param2: bit num (0-7)
                 // param3: value (false, true)
-                // void on_write_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state);
                 if(p_param2 < 0x08)
                 {
-                    on_write_register_bit(*this, p_param1, p_param2, (0x00 != p_param3));
+                    m_handler.on_write_register_bit(*this, p_param1, p_param2, (0x00 != p_param3));
                 }
                 break;
             }
@@ -200,10 +395,9 @@ private:
                 // param1: register address (0-255)
                 // param2: bit num (0-7)
                 // param3: duration  (0-255ms)
-                // void on_pulse_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_duration);
                 if(p_param2 < 0x08)
                 {
-                    on_pulse_register_bit(*this, p_param1, p_param2, p_param3);
+                    m_handler.on_pulse_register_bit(*this, p_param1, p_param2, p_param3);
                 }
                 break;
             }
@@ -213,8 +407,27 @@ private:
                 // param1: register address (0-255)
                 // param2: value (0-255)
                 // param3: cancel (false, true)
-                // void on_subscribe_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel);
-                on_subscribe_register(*this, p_param1, p_param2, (0x00 != p_param3));
+                m_handler.on_subscribe_register(*this, p_param1, p_param2, (0x00 != p_param3));
+                break;
+            }
+
+            case MSG_POLL:
+            {
+                // board: hand over the oldest queued frame
+                // master: the board had nothing queued
+                if(BUS_ADDRESS_NONE == m_address)
+                {
+                    break;
+                }
+                if(0 == m_eventCount)
+                {
+                    dispatch_message(MSG_POLL, 0x00, 0x00, 0x00);
+                    break;
+                }
+                const uint8_t* event = m_events[m_eventHead];
+                m_eventHead = ((m_eventHead + 1) % BUS_EVENT_QUEUE);
+                --m_eventCount;
+                dispatch_message(event[0], event[1], event[2], event[3]);
                 break;
             }
 
@@ -224,6 +437,7 @@ private:
             }
 
         }
+        PROFILE_END(PROF_MESSAGE);
     }
 };
 
@@ -0,0 +1,154 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#include <stdint.h>
+#include <avr/eeprom.h>
+
+#include "output_store.h"
+
+
+struct Record
+{
+    uint8_t m_seq;
+    uint8_t m_value;
+};
+
+static uint8_t EEMEM s_ee_policy;
+static Record EEMEM s_ee_ring[OUTPUT_STORE_RECORDS];
+
+static uint8_t s_policy = POWERON_ALL_OFF;
+static uint8_t s_index = OUTPUT_STORE_NONE;  // newest record
+static uint8_t s_seq = 0;                    // newest record sequence number
+static uint8_t s_stored = 0;                 // value of the newest record
+static uint8_t s_pending = 0;                // value being written
+static uint8_t s_writeStep = 0;              // 0: idle, 1: write value, 2: write seq
+
+
+////////////////////////////////////////
+static uint8_t read_seq(const uint8_t p_index)
+{
+    return(eeprom_read_byte(&s_ee_ring[p_index].m_seq));
+}
+
+////////////////////////////////////////
+// locate the newest record, OUTPUT_STORE_NONE if the ring is empty
+static uint8_t find_newest(void)
+{
+    uint8_t seq = read_seq(0);
+    if(OUTPUT_STORE_SEQ_MOD == seq)
+    {
+        return(OUTPUT_STORE_NONE);  // erased
+    }
+
+    for(uint8_t i=1; i<OUTPUT_STORE_RECORDS; ++i)
+    {
+        const uint8_t next = read_seq(i);
+        if(next != ((seq + 1) % OUTPUT_STORE_SEQ_MOD))
+        {
+            return(i - 1);
+        }
+        seq = next;
+    }
+    return(OUTPUT_STORE_RECORDS - 1);
+}
+
+////////////////////////////////////////
+uint8_t OutputStore::init(void)
+{
+    s_policy = eeprom_read_byte(&s_ee_policy);
+    if(s_policy > POWERON_ALL_ON)
+    {
+        s_policy = POWERON_ALL_OFF;  // erased or garbage
+    }
+
+    s_index = find_newest();
+    if(OUTPUT_STORE_NONE != s_index)
+    {
+        s_seq = read_seq(s_index);
+        s_stored = eeprom_read_byte(&s_ee_ring[s_index].m_value);
+    }
+
+    switch(s_policy)
+    {
+        case POWERON_RESTORE: return(s_stored);
+        case POWERON_ALL_ON:  return(0xff);
+        default:              return(0x00);
+    }
+}
+
+////////////////////////////////////////
+uint8_t OutputStore::get_policy(void)
+{
+    return(s_policy);
+}
+
+////////////////////////////////////////
+bool OutputStore::set_policy(const uint8_t p_policy)
+{
+    if(p_policy > POWERON_ALL_ON)
+    {
+        return(false);
+    }
+    s_policy = p_policy;
+    eeprom_update_byte(&s_ee_policy, p_policy);
+    return(true);
+}
+
+////////////////////////////////////////
+void OutputStore::poll(const uint8_t p_outputs)
+{
+    if(!eeprom_is_ready())
+    {
+        return;  // previous byte still being written
+    }
+
+    switch(s_writeStep)
+    {
+        case 0:
+        {
+            if((POWERON_RESTORE != s_policy) || ((p_outputs == s_stored) && (OUTPUT_STORE_NONE != s_index)))
+            {
+                return;  // nothing to persist
+            }
+            s_pending = p_outputs;
+            s_writeStep = 1;
+            break;
+        }
+
+        case 1:
+        {
+            const uint8_t next = ((OUTPUT_STORE_NONE == s_index) ? 0 : ((s_index + 1) % OUTPUT_STORE_RECORDS));
+            eeprom_update_byte(&s_ee_ring[next].m_value, s_pending);
+            s_writeStep = 2;
+            break;
+        }
+
+        case 2:
+        {
+            const bool empty = (OUTPUT_STORE_NONE == s_index);
+            const uint8_t next = (empty ? 0 : ((s_index + 1) % OUTPUT_STORE_RECORDS));
+            const uint8_t seq = (empty ? 0 : ((s_seq + 1) % OUTPUT_STORE_SEQ_MOD));
+            eeprom_update_byte(&s_ee_ring[next].m_seq, seq);
+            s_index = next;
+            s_seq = seq;
+            s_stored = s_pending;
+            s_writeStep = 0;
+            break;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __output_store_h__
+#define __output_store_h__
+
+#include <stdint.h>
+
+
+//
+// power-on output state, persisted in eeprom
+//
+// the output register is saved to a wear-levelled ring of records:
+//
+// | seq | val | seq | val | ... | seq | val |
+// +-----+-----+-----+-----+-----+-----+-----+
+// |  record 0 |  record 1 | ... | record 63 |
+//
+//   seq = record sequence number (0x00-0xfe), 0xff is erased eeprom
+//   val = logical output register value (bit set = relay on)
+//
+// the newest record is the last one in the run of consecutive sequence
+// numbers starting at record 0. a new record is written value first and
+// sequence number last, so a brown-out mid-write leaves the previous
+// record as the newest.
+//
+#define POWERON_ALL_OFF          0x00
+#define POWERON_RESTORE          0x01
+#define POWERON_ALL_ON           0x02
+
+#define OUTPUT_STORE_RECORDS     64
+#define OUTPUT_STORE_SEQ_MOD     0xff
+#define OUTPUT_STORE_NONE        0xff
+
+
+////////////////////////////////////////////////////////////
+namespace OutputStore
+{
+    // returns the logical output register value to apply at power-on
+    uint8_t init(void);
+
+    uint8_t get_policy(void);
+    bool set_policy(const uint8_t p_policy);
+
+    // call from the main loop with the current logical output value,
+    // writes at most one eeprom byte per call and never waits on the eeprom
+    void poll(const uint8_t p_outputs);
+
+} // namespace OutputStore
+
+#endif // __output_store_h__
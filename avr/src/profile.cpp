@@ -0,0 +1,221 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#include "profile.h"
+
+#ifdef USE_PROFILING
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "msg_defs.h"  // REG_DIAG_*
+
+
+// timer 1 overflows in one second at F_CPU with no prescaler (16MHz: 244)
+#define OVERFLOWS_PER_SEC  ((uint16_t)(F_CPU / 0x10000UL))
+
+struct ProfileSlot
+{
+    uint32_t m_min;
+    uint32_t m_max;
+    uint32_t m_sum;
+    uint16_t m_count;
+};
+
+static ProfileSlot s_slots[PROF_SLOTS];
+static volatile uint16_t s_overflows = 0;     // high word of the cycle counter
+static volatile uint16_t s_secOverflows = 0;  // overflows in the current second
+static volatile uint16_t s_loops = 0;         // loop iterations in the current second
+static volatile uint16_t s_loopRate = 0;      // loop iterations in the last second
+static volatile uint8_t  s_rxPeak = 0;
+static volatile uint16_t s_rxOverflow = 0;
+static volatile uint16_t s_rxParity = 0;
+static volatile uint16_t s_rxOverrun = 0;
+
+
+////////////////////////////////////////
+// timer 1 overflow - see TOIE1
+ISR(TIMER1_OVF_vect)
+{
+    ++s_overflows;
+    if(++s_secOverflows >= OVERFLOWS_PER_SEC)
+    {
+        s_secOverflows = 0;
+        s_loopRate = s_loops;
+        s_loops = 0;
+    }
+}
+
+
+////////////////////////////////////////
+inline uint16_t saturate(const uint32_t p_value)
+{
+    return((p_value > 0xffff) ? 0xffff : (uint16_t)p_value);
+}
+
+
+////////////////////////////////////////
+void profile::init(void)
+{
+    reset();
+
+    // normal mode, free running
+    TCCR1A = 0x00;
+    TCCR1B = 0x00;
+    TCNT1 = 0x0000;
+
+    // enable timer/counter 1 overflow interrupt
+    TIMSK |= _BV(TOIE1);
+
+    // CS12 CS11 CS10 = 001: clkI/O/1 (no prescaling), one count per cpu cycle
+    TCCR1B |= _BV(CS10);
+}
+
+////////////////////////////////////////
+void profile::reset(void)
+{
+    const uint8_t sreg = SREG;
+    cli();
+    for(uint8_t i=0; i<PROF_SLOTS; ++i)
+    {
+        s_slots[i].m_min = 0;
+        s_slots[i].m_max = 0;
+        s_slots[i].m_sum = 0;
+        s_slots[i].m_count = 0;
+    }
+    s_rxPeak = 0;
+    s_rxOverflow = 0;
+    s_rxParity = 0;
+    s_rxOverrun = 0;
+    SREG = sreg;
+}
+
+////////////////////////////////////////
+// safe from both isr and main loop context
+uint32_t profile::now(void)
+{
+    const uint8_t sreg = SREG;
+    cli();
+    uint16_t high = s_overflows;
+    const uint16_t low = TCNT1;
+    if(bit_is_set(TIFR, TOV1) && (low < 0x8000))
+    {
+        ++high;  // wrapped but the overflow isr has not run yet
+    }
+    SREG = sreg;
+    return((((uint32_t)high) << 16) | low);
+}
+
+////////////////////////////////////////
+// PROF_RX_ISR is recorded from isr context, all other slots from the main loop
+void profile::record(const uint8_t p_slot, const uint32_t p_cycles)
+{
+    ProfileSlot& slot = s_slots[p_slot];
+    if((0 == slot.m_count) || (p_cycles < slot.m_min))
+    {
+        slot.m_min = p_cycles;
+    }
+    if(p_cycles > slot.m_max)
+    {
+        slot.m_max = p_cycles;
+    }
+    if((0xffff == slot.m_count) || (slot.m_sum > (0xffffffffUL - p_cycles)))
+    {
+        // halve the history instead of overflowing, keeps a running average
+        slot.m_sum >>= 1;
+        slot.m_count >>= 1;
+    }
+    slot.m_sum += p_cycles;
+    ++slot.m_count;
+}
+
+////////////////////////////////////////
+void profile::loop(void)
+{
+    const uint8_t sreg = SREG;
+    cli();
+    ++s_loops;
+    SREG = sreg;
+}
+
+////////////////////////////////////////
+// called from the rx isr before the byte is queued
+void profile::rx_isr(const uint8_t p_status, const uint8_t p_depth, const uint8_t p_capacity)
+{
+    if(bit_is_set(p_status, DOR))
+    {
+        ++s_rxOverrun;
+    }
+    if(bit_is_set(p_status, PE))
+    {
+        ++s_rxParity;  // byte is dropped
+        return;
+    }
+    if(p_depth >= p_capacity)
+    {
+        ++s_rxOverflow;  // oldest byte is overwritten
+        s_rxPeak = p_capacity;
+    }
+    else if(p_depth >= s_rxPeak)
+    {
+        s_rxPeak = (p_depth + 1);
+    }
+}
+
+////////////////////////////////////////
+bool profile::read(const uint8_t p_registerAddress, uint16_t& p_value)
+{
+    p_value = 0;
+
+    const uint8_t sreg = SREG;
+    cli();
+    switch(p_registerAddress)
+    {
+        case REG_DIAG_LOOP_RATE:   p_value = s_loopRate;   break;
+        case REG_DIAG_RX_PEAK:     p_value = s_rxPeak;     break;
+        case REG_DIAG_RX_OVERFLOW: p_value = s_rxOverflow; break;
+        case REG_DIAG_RX_PARITY:   p_value = s_rxParity;   break;
+        case REG_DIAG_RX_OVERRUN:  p_value = s_rxOverrun;  break;
+        default:
+        {
+            if((p_registerAddress < REG_DIAG_SLOT) || (p_registerAddress >= (REG_DIAG_SLOT + (PROF_SLOTS * 4))))
+            {
+                SREG = sreg;
+                return(false);  // not a diagnostics register
+            }
+
+            // copy with interrupts off, the rx isr slot may be updating
+            const ProfileSlot slot = s_slots[(p_registerAddress - REG_DIAG_SLOT) >> 2];
+            SREG = sreg;
+
+            switch(p_registerAddress & 0x03)
+            {
+                case DIAG_STAT_MIN:   p_value = saturate(slot.m_min); break;
+                case DIAG_STAT_AVG:   p_value = ((0 == slot.m_count) ? 0 : saturate(slot.m_sum / slot.m_count)); break;
+                case DIAG_STAT_MAX:   p_value = saturate(slot.m_max); break;
+                case DIAG_STAT_COUNT: p_value = slot.m_count; break;
+            }
+            return(true);
+        }
+    }
+    SREG = sreg;
+    return(true);
+}
+
+#endif // USE_PROFILING
@@ -0,0 +1,76 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __profile_h__
+#define __profile_h__
+
+#include <stdint.h>
+
+
+//
+// compile-time optional firmware profiling, build with: make PROFILING=1
+//
+// timer 1 free-runs at F_CPU (no prescaler) and its overflow interrupt
+// extends it to a 32-bit cycle counter. this takes timer 1 away from
+// OneShotTimer, so the two cannot be used together.
+//
+// results are read with MSG_READ_REGISTER from the REG_DIAG_* registers
+// defined in msg_defs.h. the 16-bit result comes back in the
+// MSG_WRITE_REGISTER reply as value (low byte) and mask (high byte),
+// cycle counts saturate at 0xffff (~4ms at 16MHz).
+//
+
+// profiled code paths
+#define PROF_POLL               0   // MsgProcessor::poll()
+#define PROF_MESSAGE            1   // MsgProcessor::process_message()
+#define PROF_RX_ISR             2   // usart rx complete isr
+#define PROF_TX                 3   // SerialPort::write(), blocking transmit
+#define PROF_SLOTS              4
+
+
+#ifdef USE_PROFILING
+
+////////////////////////////////////////////////////////////
+namespace profile
+{
+    void init(void);
+    void reset(void);
+    uint32_t now(void);
+    void record(const uint8_t p_slot, const uint32_t p_cycles);
+    void loop(void);
+    void rx_isr(const uint8_t p_status, const uint8_t p_depth, const uint8_t p_capacity);
+    bool read(const uint8_t p_registerAddress, uint16_t& p_value);
+} // namespace profile
+
+#define PROFILE_INIT()          profile::init()
+#define PROFILE_BEGIN(slot)     const uint32_t prof_start_##slot = profile::now()
+#define PROFILE_END(slot)       profile::record((slot), (profile::now() - prof_start_##slot))
+#define PROFILE_LOOP()          profile::loop()
+#define PROFILE_RX_ISR(status, depth, capacity) profile::rx_isr((status), (depth), (capacity))
+
+#else
+
+#define PROFILE_INIT()
+#define PROFILE_BEGIN(slot)
+#define PROFILE_END(slot)
+#define PROFILE_LOOP()
+#define PROFILE_RX_ISR(status, depth, capacity)
+
+#endif // USE_PROFILING
+
+#endif // __profile_h__
@@ -23,6 +23,7 @@
 #include "serial.h"
 #include "ring_buffer.h"
 #include "msg_buf.h"
+#include "profile.h"
 
 
 // The Transmit Complete (TXCn) Flag bit is set one when the entire frame in the Transmit Shift
@@ -33,9 +34,12 @@
 // receive mode and free the communication bus immediately after completing the transmission.
 //#define USE_RS485_RTS
 #ifdef USE_RS485_RTS
-//#define RTS_PIN     PC5
-//#define RTS_DDR     DDRC
-//#define RTS_PORT    PORTC
+// transceiver driver enable, PORTD.4 is free on the a140808 (make RS485=1)
+#ifndef RTS_PIN
+#define RTS_PIN     PD4
+#define RTS_DDR     DDRD
+#define RTS_PORT    PORTD
+#endif // RTS_PIN
 
 inline void rts_init(void)
 {
@@ -77,15 +81,31 @@ ISR(USART_TXC_vect)
 ////////////////////////////////////////
 // usart rx complete - see RXCIE
 RingBuffer s_rx_buffer(128);
+// bytes the isr lost to parity errors or overflows, they are consumed too
+static volatile uint8_t s_rx_dropped = 0;
+static uint8_t s_rx_droppedSeen = 0;
+static uint16_t s_rx_consumed = 0;
 //SIGNAL(USART_RX_vect)
 //ISR(SIG_USART_RECV)
 ISR(USART_RXC_vect)
 {
+    PROFILE_BEGIN(PROF_RX_ISR);
+    const uint8_t status = UCSRA;  // error flags belong to the byte in UDR, read them first
     unsigned char c = UDR;
-    if(bit_is_clear(UCSRA, PE))
+    PROFILE_RX_ISR(status, s_rx_buffer.size(), s_rx_buffer.capacity());
+    if(bit_is_clear(status, PE))
     {
+        if(s_rx_buffer.full())
+        {
+            ++s_rx_dropped;  // the oldest byte goes
+        }
         s_rx_buffer.push_back(c);
     }
+    else
+    {
+        ++s_rx_dropped;
+    }
+    PROFILE_END(PROF_RX_ISR);
 }
 
 
@@ -227,6 +247,7 @@ bool SerialPort::read(MsgBuf& p_msgBuf) const
     while(!s_rx_buffer.empty())
     {
         const uint8_t val = s_rx_buffer.pop_front();
+        ++s_rx_consumed;
         p_msgBuf.push_back(val);
         if(S_OK == p_msgBuf.validate())
         {
@@ -237,6 +258,22 @@ bool SerialPort::read(MsgBuf& p_msgBuf) const
     return(false);
 }
 
+////////////////////////////////////////
+uint16_t SerialPort::rx_consumed(void) const
+{
+    // a single byte, read without blocking the isr
+    const uint8_t dropped = s_rx_dropped;
+    s_rx_consumed += (uint8_t)(dropped - s_rx_droppedSeen);
+    s_rx_droppedSeen = dropped;
+    return(s_rx_consumed);
+}
+
+////////////////////////////////////////
+uint8_t SerialPort::rx_window(void) const
+{
+    return(s_rx_buffer.capacity());
+}
+
 ////////////////////////////////////////
 bool SerialPort::write(MsgBuf& p_msgBuf) const
 {
@@ -245,6 +282,7 @@ bool SerialPort::write(MsgBuf& p_msgBuf) const
         return(false);
     }
 
+    PROFILE_BEGIN(PROF_TX);
     #ifdef USE_RS485_RTS
     rts_high();
     #endif // USE_RS485_RTS
@@ -254,6 +292,7 @@ bool SerialPort::write(MsgBuf& p_msgBuf) const
         while(!(UCSRA & _BV(UDRE)));
         UDR = p_msgBuf[i];
     }
+    PROFILE_END(PROF_TX);
     return(true);
 }
 
@@ -36,6 +36,11 @@ public:
     void close(void);
     bool read(MsgBuf& p_msgBuf) const;
     bool write(MsgBuf& p_msgBuf) const;
+
+    // flow control (MSG_CREDIT): rx bytes taken out of the ring so far,
+    // wraps, and the ring size
+    uint16_t rx_consumed(void) const;
+    uint8_t rx_window(void) const;
 };
 
 #endif // __serial_port_h__
@@ -28,54 +28,79 @@
 #include <vector>
 
 #include "../msg_processor.h"
+#include "../serial.h"
 
 #include "kbhit.h"
 
 
+class Console;
+typedef MsgProcessorT<SerialPort, Console> MsgProcessor;
+
+////////////////////////////////////////////////////////////
+// prints the replies from the a140808, the MsgProcessor event handler
+class Console
+{
+public:
+    void on_poll(MsgProcessor& p_mp);
+    void on_pong(MsgProcessor& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3);
+    void on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress);
+    void on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask);
+    void on_write_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state);
+    void on_pulse_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs);
+    void on_subscribe_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel);
+};
+
 
 ////////////////////////////////////////
-void on_poll(MsgProcessor& p_mp)
+void Console::on_poll(MsgProcessor& p_mp)
 {
     // our timeslice
 }
 
 ////////////////////////////////////////
-void on_pong(MsgProcessor& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
+void Console::on_pong(MsgProcessor& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
 {
     ::printf("\nping response: p1:[%d] p2:[%d] p3:[%d]\n", p_param1, p_param2, p_param3);
     ::printf("\nA140808>");
 }
 
 ////////////////////////////////////////
-void on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress)
+void Console::on_read_register(MsgProcessor& p_mp, const uint8_t p_registerAddress)
 {
     ::printf("\non_read_register - addr: [0x%x]\n", p_registerAddress);
     ::printf("\nA140808>");
 }
 
 ////////////////////////////////////////
-void on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask)
+void Console::on_write_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask)
 {
+    if(p_registerAddress >= REG_DIAG_LOOP_RATE)
+    {
+        // 16-bit diagnostics reply
+        ::printf("\ndiagnostics - addr: [0x%x]  val: [%u]\n", p_registerAddress, (unsigned)((p_mask << 8) | p_value));
+        ::printf("\nA140808>");
+        return;
+    }
     ::printf("\non_write_register - addr: [0x%x]  val: [0x%x]  mask: [0x%x]\n", p_registerAddress, p_value, p_mask);
     ::printf("\nA140808>");
 }
 
 ////////////////////////////////////////
-void on_write_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state)
+void Console::on_write_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state)
 {
     ::printf("\non_write_register_bit - addr: [0x%x]  bit: [0x%d]  state: [%d]\n", p_registerAddress, p_bit, p_state);
     ::printf("\nA140808>");
 }
 
 ////////////////////////////////////////
-void on_pulse_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs)
+void Console::on_pulse_register_bit(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs)
 {
     ::printf("\non_pulse_register_bit - addr: [0x%x]  bit: [0x%d]  duration: [%dms]\n", p_registerAddress, p_bit, p_durationMs);
     ::printf("\nA140808>");
 }
 
 ////////////////////////////////////////
-void on_subscribe_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
+void Console::on_subscribe_register(MsgProcessor& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
 {
     switch(p_registerAddress)
     {
@@ -161,6 +186,47 @@ bool do_command(MsgProcessor& p_mp, const std::string& p_command)
         p_mp.dispatch_read_register(REG_OUTPUT_1);
         return(true);
     }
+    if(0 == ::strcmp("read pol", p_command.c_str()))
+    {
+        p_mp.dispatch_read_register(REG_POWERON_POLICY);
+        return(true);
+    }
+    if(0 == ::strcmp("read bus", p_command.c_str()))
+    {
+        p_mp.dispatch_read_register(REG_BUS_ADDRESS);
+        return(true);
+    }
+    if(0 == ::strcmp("poll", p_command.c_str()))
+    {
+        // a board on a bus hands over one queued event
+        p_mp.dispatch_message(MSG_POLL, 0, 0, 0);
+        return(true);
+    }
+
+    if(0 == ::strcmp("diag", p_command.c_str()))
+    {
+        // firmware built with USE_PROFILING
+        static const uint8_t regs[] = { REG_DIAG_LOOP_RATE, REG_DIAG_RX_PEAK, REG_DIAG_RX_OVERFLOW, REG_DIAG_RX_PARITY, REG_DIAG_RX_OVERRUN };
+        // the avr handles MP_RX_QUEUE messages per 100ms loop, pace the requests so its rx ring does not overflow
+        for(uint8_t i=0; i<sizeof(regs); ++i)
+        {
+            p_mp.dispatch_read_register(regs[i]);
+            ::usleep(110000);
+            p_mp.poll();
+        }
+        for(uint8_t i=0; i<(PROF_SLOTS * 4); ++i)
+        {
+            p_mp.dispatch_read_register(REG_DIAG_SLOT + i);
+            ::usleep(110000);
+            p_mp.poll();
+        }
+        return(true);
+    }
+    if(0 == ::strcmp("diag reset", p_command.c_str()))
+    {
+        p_mp.dispatch_write_register(REG_DIAG_RESET);
+        return(true);
+    }
 
     if(0 == ::strcmp("sub in", p_command.c_str()))
     {
@@ -199,6 +265,62 @@ bool do_command(MsgProcessor& p_mp, const std::string& p_command)
         return(true);
     }
 
+    // select the board on a multi-drop bus, 0 for point to point
+    if((p_command.size() > 4) && (0 == p_command.compare(0, 4, "bus ")))
+    {
+        uint8_t param1 = 0;
+        uint8_t param2 = 0;
+        uint8_t param3 = 0;
+        parse_cmd_parms(p_command, param1, param2, param3);
+        ::printf("talking to board: [0x%02x]\n\n", param1);
+        p_mp.select(param1);
+        return(true);
+    }
+
+    // write bus address
+    if((p_command.size() > 3) && ('w' == p_command[0]) && ('a' == p_command[1]) && (' ' == p_command[2]))
+    {
+        uint8_t param1 = 0;
+        uint8_t param2 = 0;
+        uint8_t param3 = 0;
+        parse_cmd_parms(p_command, param1, param2, param3);
+        if(BUS_ADDRESS_BROADCAST == param1)
+        {
+            ::printf("bus address must be 0-254 - invalid value: [%d]\n\n", param1);
+            return(false);  // error
+        }
+
+        ::printf("writing bus address - address: [0x%02x]\n\n", param1);
+        if(!p_mp.dispatch_write_register(REG_BUS_ADDRESS, param1))
+        {
+            ::printf("failed to send write bus address\n\n");
+            return(false);  // error
+        }
+        return(true);
+    }
+
+    // write power-on policy
+    if((p_command.size() > 3) && ('w' == p_command[0]) && ('p' == p_command[1]) && (' ' == p_command[2]))
+    {
+        uint8_t param1 = 0;
+        uint8_t param2 = 0;
+        uint8_t param3 = 0;
+        parse_cmd_parms(p_command, param1, param2, param3);
+        if(param1 > 2)
+        {
+            ::printf("policy must be 0-2 - invalid value: [%d]\n\n", param1);
+            return(false);  // error
+        }
+
+        ::printf("writing power-on policy - policy: [%d]\n\n", param1);
+        if(!p_mp.dispatch_write_register(REG_POWERON_POLICY, param1))
+        {
+            ::printf("failed to send write power-on policy\n\n");
+            return(false);  // error
+        }
+        return(true);
+    }
+
     // from here on out, commands are two chars followed by a space
     if((p_command.size() < 6) || (' ' != p_command[2]))
     {
@@ -293,14 +415,22 @@ bool scan_keyboard(keyboard& p_kb, MsgProcessor& p_mp)
                     ::printf("\n");
                     ::printf("read in               - read inputs\n");
                     ::printf("read out              - read outputs\n");
+                    ::printf("read pol              - read power-on policy\n");
+                    ::printf("read bus              - read bus address\n");
                     ::printf("sub in                - subscribe inputs\n");
                     ::printf("sub in cancel         - cancel subscribe inputs\n");
                     ::printf("sub out               - subscribe outputs\n");
                     ::printf("sub out cancel        - cancel subscribe outputs\n");
                     ::printf("ping [p1] [p2] [p3]   - ping the avr [optional values]\n");
+                    ::printf("diag                  - read profiling diagnostics\n");
+                    ::printf("diag reset            - clear profiling diagnostics\n");
                     ::printf("wr <value> <mask>     - write register\n");
                     ::printf("wb <bit> <bool>       - write bit\n");
+                    ::printf("wp <policy>           - power-on policy (0: off, 1: restore, 2: on)\n");
                     ::printf("pb <bit> <delay ms>   - pulse bit state for delay ms\n");
+                    ::printf("wa <address>          - bus address (0: point to point)\n");
+                    ::printf("bus <address>         - talk to this board on a bus\n");
+                    ::printf("poll                  - poll the board for an event\n");
                     ::printf("exit                  - quit this application\n");
                     ::printf("\n");
                     command.clear();
@@ -413,12 +543,14 @@ int main(const int p_argc, const char** p_argv)
     const char* serialDevice = p_argv[1];
 
     // create the message pump
-    MsgProcessor mp;
-    if(!mp.init(serialDevice, 57600, true/*E71*/))
+    SerialPort serialPort;
+    if(!serialPort.init(serialDevice, 57600, true/*E71*/))
     {
         ::printf("\nfailed to initialize message processor\n");
         return(1);
     }
+    Console console;
+    MsgProcessor mp(serialPort, console);
 
     keyboard kb;
 //    setvbuf(stdout, NULL, _IONBF, 0);
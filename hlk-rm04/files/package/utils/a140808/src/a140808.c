@@ -16,6 +16,8 @@
 // Author: John Clark (johnc@restswitch.com)
 //
 
+#include <limits.h> // INT_MAX
+#include <stdlib.h> // strtoull
 #include <string.h> // strcmp
 #include <json-c/json.h>
 
@@ -29,10 +31,38 @@
 // ip address end
 
 #include "global.h"
+#include "a140808.h"
+#include "cmd_parse.h"
+#include "cmd_table.h"
+#include "dedup.h"
+#include "fanout.h"
+#include "journal.h"
+#include "json_writer.h"
 #include "websock.h"
 #include "msg_proc.h"
+#include "link_probe.h"
+#include "regcache.h"
+#include "schedule.h"
+#include "results.h"
+#include "trace.h"
 
 
+// relay commands the serial layer refused, for the batch result
+static int s_dispatchErrors = 0;
+// why the last command did not check out, RS_REASON_* (results.h)
+static uint8_t s_invalidReason = RS_REASON_NONE;
+// of the message in hand and its frames, see trace.h
+static uint32_t s_tag = 0;
+
+static char s_deviceId[16] = DEFAULT_SERNO;
+
+
+////////////////////////////////////////
+void setDeviceId(const char* p_id)
+{
+    strncpy(s_deviceId, p_id, (sizeof(s_deviceId) - 1));
+}
+
 
 ////////////////////////////////////////
 void pulseRelay(const uint8_t p_num, const uint8_t p_ms)
@@ -41,17 +71,22 @@ void pulseRelay(const uint8_t p_num, const uint8_t p_ms)
     if(!mp_dispatch_pulse_register_bit(REG_OUTPUT_1, p_num, p_ms))
     {
         log_err("mp_dispatch_pulse_register_bit -- val: [%d]  cyc: [%d]\n", p_num, p_ms);
+        ++s_dispatchErrors;
     }
 }
 
 ////////////////////////////////////////
-void writeOutputRegister(const uint8_t p_value, const uint8_t p_mask)
+// to the selected board, p_board for the register cache
+void writeOutputRegister(const uint8_t p_board, const uint8_t p_value, const uint8_t p_mask)
 {
     log_notice("writeOutputRegister - val: [%d] mask: [%d]", p_value, p_mask);
     if(!mp_dispatch_write_register(REG_OUTPUT_1, p_value, p_mask))
     {
         log_err("mp_dispatch_write_register -- val: [%d]  mask: [%d]\n", p_value, p_mask);
+        ++s_dispatchErrors;
+        return;
     }
+    rc_write(p_board, REG_OUTPUT_1, p_value, p_mask);
 }
 
 ////////////////////////////////////////
@@ -68,19 +103,17 @@ void processHello(const char* p_str)
 
 
 ////////////////////////////////////////
-// { "ipv4Addresses": [ "172.17.133.3", "172.17.133.4", "172.17.133.5" ] }
-void requestIpv4Addresses(void)
+// the ipv4 addresses in a json array, false if there are none to be had
+static bool write_ipv4_addresses(struct json_writer* p_jw)
 {
-    log_notice("requestIpv4Addresses");
-
     struct ifaddrs* paddrs;
     if(getifaddrs(&paddrs) < 0)
     {
         log_err("get_ipv4_addresses:getifaddrs, err: [%s]", strerror(errno));
-        return;
+        return(false);
     }
 
-    json_object* jarray = json_object_new_array();
+    jw_array_begin(p_jw);
     for(struct ifaddrs* pifa = paddrs; pifa != NULL; pifa = pifa->ifa_next)
     {
         if((NULL == pifa->ifa_addr) || (AF_INET != pifa->ifa_addr->sa_family))
@@ -104,21 +137,47 @@ void requestIpv4Addresses(void)
         // an ipv4 address we care about
         const char* ip = inet_ntoa(paddr->sin_addr);
         log_debug("adding ipv4 address: %s", ip);
-        json_object_array_add(jarray, json_object_new_string(ip));
+        jw_string(p_jw, ip);
     }
     freeifaddrs(paddrs);
+    jw_array_end(p_jw);
+    return(true);
+}
 
-    // serialize & send the ipv4 addresses back
-    json_object* jobject = json_object_new_object();
-    json_object_object_add(jobject, "ipv4Addresses", jarray);
-    const char* str = json_object_to_json_string(jobject);
-    ws_send_text(str);
-    json_object_put(jarray);
-    json_object_put(jobject);
+////////////////////////////////////////
+// { "ipv4Addresses": [ "172.17.133.3", "172.17.133.4", "172.17.133.5" ] }
+void requestIpv4Addresses(void)
+{
+    log_notice("requestIpv4Addresses");
+
+    size_t capacity;
+    char* buf = ws_text_reserve(&capacity);
+    if(NULL == buf)
+    {
+        return;
+    }
+    struct json_writer jw;
+    jw_init(&jw, buf, capacity);
+    jw_object_begin(&jw);
+    jw_key(&jw, "ipv4Addresses");
+    if(!write_ipv4_addresses(&jw))
+    {
+        return;  // nothing committed, the reserved message is not sent
+    }
+    jw_object_end(&jw);
+
+    // send the ipv4 addresses back
+    const size_t len = jw_finish(&jw);
+    if(0 == len)
+    {
+        log_err("requestIpv4Addresses: reply does not fit in [%zu] bytes", capacity);
+    }
+    ws_text_commit(len);
 }
 
 
 
+
 ////////////////////////////////////////
 int get_string_from_array(struct json_object* p_pobj, const int p_index, const char** p_result)
 {
@@ -191,140 +250,1023 @@ int get_int_from_array(struct json_object* p_pobj, const int p_index, int* p_res
 
 
 ////////////////////////////////////////
-int dispatch_msg(const char* p_msg)
+// ct_source getters, cp_parse() leaves the name out of the arguments
+static bool cp_source_int(void* p_ctx, const int p_index, int* p_value)
 {
-    log_debug("parsing message: %s", p_msg);
-    struct json_object* pobj = json_tokener_parse(p_msg);
-    if((NULL == pobj) || (is_error(pobj)))
+    return(cp_get_int((const cp_msg*)p_ctx, p_index, p_value));
+}
+static bool cp_source_string(void* p_ctx, const int p_index, const char** p_value)
+{
+    return(cp_get_string((const cp_msg*)p_ctx, p_index, p_value));
+}
+
+////////////////////////////////////////
+// json-c's start after the name
+static bool json_get_int(void* p_ctx, const int p_index, int* p_value)
+{
+    return(0 == get_int_from_array((struct json_object*)p_ctx, (p_index + 1), p_value));
+}
+static bool json_get_string(void* p_ctx, const int p_index, const char** p_value)
+{
+    return(0 == get_string_from_array((struct json_object*)p_ctx, (p_index + 1), p_value));
+}
+
+
+////////////////////////////////////////
+// the optional board address for a multi-drop bus, the first board without it
+static uint8_t board_of(const ct_value* p_board)
+{
+    return(p_board->m_given ? (uint8_t)p_board->m_int : mp_bus_board(0));
+}
+static void select_board(const ct_value* p_board)
+{
+    mp_select(board_of(p_board));
+}
+
+
+//
+// in a batch the output register writes to one board in a row are merged
+// into one write, the masks or'ed and the later values taking their bits
+//
+static bool s_inBatch = false;
+static bool s_writePending = false;
+static uint8_t s_writeBoard;
+static uint8_t s_writeValue;
+static uint8_t s_writeMask;
+
+////////////////////////////////////////
+static void flush_write(void)
+{
+    if(s_writePending)
     {
-        log_err("error: message does not appear to be a valid json message: %s", p_msg);
-        return(-1);
+        s_writePending = false;
+        mp_select(s_writeBoard);
+        writeOutputRegister(s_writeBoard, s_writeValue, s_writeMask);
     }
+}
 
-    // param 0 is the function name
-    const char* fcn;
-    int rc = get_string_from_array(pobj, 0, &fcn);
-    if(0 != rc)
+////////////////////////////////////////
+static void merge_write(const uint8_t p_board, const uint8_t p_value, const uint8_t p_mask)
+{
+    if(s_writePending && (p_board != s_writeBoard))
     {
-        log_err("error: failed to get function name from message");
-        return(-1);
+        flush_write();
+    }
+    if(!s_writePending)
+    {
+        s_writePending = true;
+        s_writeBoard = p_board;
+        s_writeValue = 0;
+        s_writeMask = 0;
     }
+    s_writeValue = ((s_writeValue & ~p_mask) | (p_value & p_mask));
+    s_writeMask |= p_mask;
+}
 
-    if(0 == strcmp("pulseRelay", fcn))
+//
+// events to the cloud: into the send queue while connected, into the
+// journal (journal.h) while not, while the send queue is full and while the
+// journal is replayed so they keep their order. the ones still queued when
+// the connection closes are journaled then (ws_onunsent()). the replay
+// goes out in batches after a reconnect:
+//   ["journal",<seq of the first>,<event>,<event>,...]
+// and ["ackJournal",<seq>] from the server drops what it has
+//
+static uint32_t s_replayed = 0;  // the last record sent on this connection
+static bool s_eventLive = false;
+static char s_eventBuf[JR_RECORD_MAX];
+
+////////////////////////////////////////
+static bool journal_pending(void)
+{
+    return(s_replayed < jr_last());
+}
+
+////////////////////////////////////////
+// the records not sent yet, as many batches as the send queue takes
+static void replay_journal(void)
+{
+    while(ws_is_open() && journal_pending() && (ws_text_room() > 0))
     {
-        // ["pulseRelay",1,250]
-        int num;
-        rc = get_int_from_array(pobj, 1, &num);
-        if(0 != rc)
+        size_t capacity;
+        char* buf = ws_text_reserve(&capacity);
+        struct json_writer jw;
+        jw_init(&jw, buf, capacity);
+        jw_array_begin(&jw);
+        jw_string(&jw, "journal");
+        uint32_t seq;
+        uint16_t len;
+        const char* prec = jr_next(s_replayed, &seq, &len);
+        jw_int(&jw, seq);
+        // a comma, the record, the closing bracket and the nul
+        while((NULL != prec) && ((jw.m_len + len + 3) <= capacity))
         {
-            log_err("error: pulseRelay: failed to extract param0 relay num");
-            return(-1);
+            jw_raw(&jw, prec, len);
+            s_replayed = seq;
+            prec = jr_next(s_replayed, &seq, &len);
         }
-        if((num < 0) || (num > 255))
+        jw_array_end(&jw);
+        ws_text_commit(jw_finish(&jw));
+    }
+}
+
+////////////////////////////////////////
+// where an event is formatted
+static char* event_begin(size_t* p_capacity)
+{
+    char* buf = NULL;
+    s_eventLive = (ws_is_open() && !journal_pending() && (NULL != (buf = ws_text_reserve(p_capacity))));
+    if(s_eventLive)
+    {
+        return(buf);
+    }
+    *p_capacity = sizeof(s_eventBuf);
+    return(s_eventBuf);
+}
+
+////////////////////////////////////////
+static void event_end(const size_t p_len)
+{
+    if(s_eventLive)
+    {
+        ws_text_commit_kept(p_len);
+        return;
+    }
+    if((0 != p_len) && (0 == jr_append(s_eventBuf, p_len)))
+    {
+        log_debug("event_end: not journaled, dropped: [%s]", s_eventBuf);
+    }
+    replay_journal();
+}
+
+////////////////////////////////////////
+// register state, pushed as it arrives in the shape of the commands:
+// [<event>,<reg>,<value>,<board>,<age ms>], the age of a cached value
+//   registerValue    the answer to readRegister (REG_ERR_UNKNOWN: no such register)
+//   registerChanged  a subscribed register, its value when subscribed and each change
+//   subscribeCancel  the subscription ended, on a cancel or REG_ERR_UNKNOWN for no such register
+static void push_register(const char* p_event, const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const uint32_t p_ageMs)
+{
+    size_t capacity;
+    char* buf = event_begin(&capacity);
+    struct json_writer jw;
+    jw_init(&jw, buf, capacity);
+    jw_array_begin(&jw);
+    jw_string(&jw, p_event);
+    jw_int(&jw, p_registerAddress);
+    jw_int(&jw, p_value);
+    jw_int(&jw, p_board);
+    jw_int(&jw, p_ageMs);
+    jw_array_end(&jw);
+    event_end(jw_finish(&jw));
+}
+
+////////////////////////////////////////
+// [<event>,<value>,...]
+static void push_event(const char* p_event, const int64_t* p_values, const uint8_t p_count)
+{
+    size_t capacity;
+    char* buf = event_begin(&capacity);
+    struct json_writer jw;
+    jw_init(&jw, buf, capacity);
+    jw_array_begin(&jw);
+    jw_string(&jw, p_event);
+    for(uint8_t i=0; i<p_count; ++i)
+    {
+        jw_int(&jw, p_values[i]);
+    }
+    jw_array_end(&jw);
+    event_end(jw_finish(&jw));
+}
+
+
+
+//
+// the cloud is one subscriber to register changes (fanout.h), its policy
+// set by subscribePolicy
+//
+static int s_cloudSubscriber = -1;
+
+////////////////////////////////////////
+static bool deliver_cloud(void* p_ctx, const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
+{
+    if(p_cancel)
+    {
+        push_register("subscribeCancel", p_board, p_registerAddress, 0, 0);
+        return(true);
+    }
+    uint8_t value;
+    uint32_t ageMs;
+    if(!rc_get(p_board, p_registerAddress, &value, &ageMs) || (value != p_value))
+    {
+        ageMs = 0;
+    }
+    push_register("registerChanged", p_board, p_registerAddress, p_value, ageMs);
+    return(true);
+}
+
+////////////////////////////////////////
+// the cloud's reads that went to the board, in order, the answers to the
+// daemon's own (rc_watch()) are not pushed
+#define CLOUD_READS  16
+typedef struct
+{
+    uint8_t m_board;
+    uint8_t m_register;
+} cloud_read;
+static cloud_read s_cloudReads[CLOUD_READS];
+static uint8_t s_cloudReadCount = 0;
+
+////////////////////////////////////////
+static void cloud_read_sent(const uint8_t p_board, const uint8_t p_registerAddress)
+{
+    if(CLOUD_READS == s_cloudReadCount)
+    {
+        memmove(&s_cloudReads[0], &s_cloudReads[1], (sizeof(cloud_read) * --s_cloudReadCount));  // never answered
+    }
+    s_cloudReads[s_cloudReadCount].m_board = p_board;
+    s_cloudReads[s_cloudReadCount].m_register = p_registerAddress;
+    ++s_cloudReadCount;
+}
+
+////////////////////////////////////////
+// the read p_registerAddress answers, REG_ERR_UNKNOWN the board's oldest
+static bool cloud_read_answered(const uint8_t p_board, const uint8_t p_registerAddress)
+{
+    for(uint8_t i=0; i<s_cloudReadCount; ++i)
+    {
+        if((s_cloudReads[i].m_board == p_board) &&
+           ((s_cloudReads[i].m_register == p_registerAddress) || (REG_ERR_UNKNOWN == p_registerAddress)))
         {
-            log_err("error: pulseRelay: relay num out of range (0-255): [%d]", num);
-            return(-1);
+            memmove(&s_cloudReads[i], &s_cloudReads[i + 1], (sizeof(cloud_read) * (--s_cloudReadCount - i)));
+            return(true);
         }
+    }
+    return(false);
+}
+
+////////////////////////////////////////
+static int cloud_subscriber(void)
+{
+    if(s_cloudSubscriber < 0)
+    {
+        const fo_policy policy = { 0xff, 0, 0 };  // every change as it comes
+        s_cloudSubscriber = fo_add(deliver_cloud, NULL, &policy);
+    }
+    return(s_cloudSubscriber);
+}
+
+////////////////////////////////////////
+// ["pulseRelay",1,250]  or on a multi-drop bus  ["pulseRelay",1,250,<board>]
+static void cmd_pulse_relay(const ct_value* p_args)
+{
+    select_board(&p_args[2]);
+    pulseRelay((uint8_t)p_args[0].m_int, (uint8_t)p_args[1].m_int);
+}
+
+////////////////////////////////////////
+// ["writeOutputRegister",1,255]  or on a multi-drop bus  ["writeOutputRegister",1,255,<board>]
+static void cmd_write_output_register(const ct_value* p_args)
+{
+    if(s_inBatch)
+    {
+        merge_write(board_of(&p_args[2]), (uint8_t)p_args[0].m_int, (uint8_t)p_args[1].m_int);
+        return;
+    }
+    select_board(&p_args[2]);
+    writeOutputRegister(board_of(&p_args[2]), (uint8_t)p_args[0].m_int, (uint8_t)p_args[1].m_int);
+}
+
+////////////////////////////////////////
+// ["writeRegister",<reg>,<value>,<mask>]  or on a multi-drop bus  ["writeRegister",<reg>,<value>,<mask>,<board>]
+static void cmd_write_register(const ct_value* p_args)
+{
+    select_board(&p_args[3]);
+    if(!mp_dispatch_write_register((uint8_t)p_args[0].m_int, (uint8_t)p_args[1].m_int, (uint8_t)p_args[2].m_int))
+    {
+        ++s_dispatchErrors;
+        return;
+    }
+    rc_write(board_of(&p_args[3]), (uint8_t)p_args[0].m_int, (uint8_t)p_args[1].m_int, (uint8_t)p_args[2].m_int);
+}
+
+////////////////////////////////////////
+// ["writeRegisterBit",<reg>,<bit>,<state>]  or on a multi-drop bus  ["writeRegisterBit",<reg>,<bit>,<state>,<board>]
+static void cmd_write_register_bit(const ct_value* p_args)
+{
+    select_board(&p_args[3]);
+    const uint8_t mask = (1 << p_args[1].m_int);
+    if(!mp_dispatch_write_register_bit((uint8_t)p_args[0].m_int, (uint8_t)p_args[1].m_int, (0 != p_args[2].m_int)))
+    {
+        ++s_dispatchErrors;
+        return;
+    }
+    rc_write(board_of(&p_args[3]), (uint8_t)p_args[0].m_int, ((0 != p_args[2].m_int) ? mask : 0), mask);
+}
+
+////////////////////////////////////////
+// ["readRegister",<reg>]  ["readRegister",<reg>,1] asks the board past the cache,
+// or on a multi-drop bus  ["readRegister",<reg>,<refresh>,<board>]
+// answered with ["registerValue",...] from the cache, or by the board, see
+// mp_on_write_register()
+static void cmd_read_register(const ct_value* p_args)
+{
+    const uint8_t board = board_of(&p_args[2]);
+    const uint8_t reg = (uint8_t)p_args[0].m_int;
+    uint8_t value;
+    uint32_t ageMs;
+    if((0 == p_args[1].m_int) && rc_get(board, reg, &value, &ageMs))
+    {
+        push_register("registerValue", board, reg, value, ageMs);
+        return;
+    }
+    mp_select(board);
+    if(!mp_dispatch_read_register(reg))
+    {
+        ++s_dispatchErrors;
+        return;
+    }
+    cloud_read_sent(board, reg);
+}
+
+////////////////////////////////////////
+// ["subscribeRegister",<reg>]  ["subscribeRegister",<reg>,1] cancels,  or on a
+// multi-drop bus  ["subscribeRegister",<reg>,<cancel>,<board>]
+// the current value and then each change as ["registerChanged",...], see
+// mp_on_subscribe_register(). a register already subscribed on the board is
+// answered from the cache, see fanout.h. a cancel is answered at once
+static void cmd_subscribe_register(const ct_value* p_args)
+{
+    const uint8_t board = board_of(&p_args[2]);
+    const uint8_t reg = (uint8_t)p_args[0].m_int;
+    if(0 != p_args[1].m_int)
+    {
+        fo_unsubscribe(cloud_subscriber(), board, reg);
+        push_register("subscribeCancel", board, reg, 0, 0);
+        return;
+    }
+    if(!fo_subscribe(cloud_subscriber(), board, reg))
+    {
+        ++s_dispatchErrors;
+    }
+}
+
+////////////////////////////////////////
+// ["subscribePolicy",<mask>,<min interval ms>,<coalesce ms>] for the
+// cloud's register changes: the bits it wants, at most one change per
+// interval, and how long a change waits for more, see fanout.h
+static void cmd_subscribe_policy(const ct_value* p_args)
+{
+    const fo_policy policy = { (uint8_t)p_args[0].m_int, (uint32_t)p_args[1].m_int, (uint32_t)p_args[2].m_int };
+    fo_set_policy(cloud_subscriber(), &policy);
+}
+
+//
+// commands the daemon runs at a set time (schedule.h), each one reported
+// when it is done with: ["scheduleDone",<id>,<epoch ms>,<late us>,<status>]
+//
+#define SCHEDULE_RAN        0
+#define SCHEDULE_FAILED     1  // the serial layer refused it
+#define SCHEDULE_LATE       2  // past SCHEDULE_LATE_MS, not run
+#define SCHEDULE_CANCELLED  3
+#define SCHEDULE_UNKNOWN    4  // no such job pending, for a cancel
+
+////////////////////////////////////////
+static void push_schedule_done(const uint32_t p_id, const int64_t p_lateUs, const int p_status)
+{
+    const int64_t values[] = { p_id, (int64_t)date_ms_now(), p_lateUs, p_status };
+    push_event("scheduleDone", values, (sizeof(values) / sizeof(values[0])));
+}
+
+////////////////////////////////////////
+// ["scheduleCancel",<id>] a job from scheduleAt or scheduleIn
+static void cmd_schedule_cancel(const ct_value* p_args)
+{
+    const uint32_t id = (uint32_t)p_args[0].m_int;
+    push_schedule_done(id, 0, (sc_cancel(id) ? SCHEDULE_CANCELLED : SCHEDULE_UNKNOWN));
+}
+
+////////////////////////////////////////
+// ["ackJournal",<seq>] the server has the journal up to <seq>
+static void cmd_ack_journal(const ct_value* p_args)
+{
+    jr_ack((uint32_t)p_args[0].m_int);
+}
+
+////////////////////////////////////////
+// ["dialModem","ATD3,4,4;"]
+static void cmd_dial_modem(const ct_value* p_args)
+{
+    dialModem(p_args[0].m_str);
+}
+
+////////////////////////////////////////
+// ["hello","<device id>"]
+static void cmd_hello(const ct_value* p_args)
+{
+    processHello(p_args[0].m_str);
+}
+
+////////////////////////////////////////
+// ["requestIpv4Addresses"]
+static void cmd_request_ipv4_addresses(const ct_value* p_args)
+{
+    requestIpv4Addresses();
+}
+
+////////////////////////////////////////
+// ["requestQueueStats"] the serial transmit classes, see msg_proc.h:
+// {"queueStats":{"control":[<frames>,<dropped>,<queued>,<avg wait ms>,<max wait ms>],"interactive":[...],"background":[...]}}
+static void cmd_request_queue_stats(const ct_value* p_args)
+{
+    static const char* s_classNames[MP_CLASSES] = { "control", "interactive", "background" };
+    size_t capacity;
+    char* buf = ws_text_reserve(&capacity);
+    if(NULL == buf)
+    {
+        return;
+    }
+    struct json_writer jw;
+    jw_init(&jw, buf, capacity);
+    jw_object_begin(&jw);
+    jw_key(&jw, "queueStats");
+    jw_object_begin(&jw);
+    for(uint8_t i=0; i<MP_CLASSES; ++i)
+    {
+        mp_class_stats stats;
+        mp_get_class_stats(i, &stats);
+        jw_key(&jw, s_classNames[i]);
+        jw_array_begin(&jw);
+        jw_int(&jw, stats.m_frames);
+        jw_int(&jw, stats.m_dropped);
+        jw_int(&jw, stats.m_queued);
+        jw_int(&jw, ((0 == stats.m_frames) ? 0 : (int64_t)(stats.m_waitedMs / stats.m_frames)));
+        jw_int(&jw, stats.m_maxWaitMs);
+        jw_array_end(&jw);
+    }
+    jw_object_end(&jw);
+    jw_object_end(&jw);
+    ws_text_commit(jw_finish(&jw));
+}
+
+// sorted by name, see cmd_table.h
+//   name, type, optional, min, max, default
+static const ct_command s_commands[] =
+{
+    { "ackJournal", cmd_ack_journal, 1, {
+        { "sequence number", CT_INT, false, 0, INT_MAX, 0 } } },
+    { "dialModem", cmd_dial_modem, 1, {
+        { "dial string", CT_STRING, false, 0, 0, 0 } } },
+    { "hello", cmd_hello, 1, {
+        { "device id", CT_STRING, false, 0, 0, 0 } } },
+    { "pulseRelay", cmd_pulse_relay, 3, {
+        { "relay num", CT_INT, false, 0, 255, 0 },
+        { "pulse duration ms", CT_INT, true, 0, 255, 250 },
+        { "board address", CT_INT, true, 0, BUS_ADDRESS_BROADCAST, 0 } } },
+    { "readRegister", cmd_read_register, 3, {
+        { "register address", CT_INT, false, 0, 255, 0 },
+        { "refresh", CT_INT, true, 0, 1, 0 },
+        { "board address", CT_INT, true, 0, BUS_ADDRESS_BROADCAST, 0 } } },
+    { "requestIpv4Addresses", cmd_request_ipv4_addresses, 0, { } },
+    { "requestQueueStats", cmd_request_queue_stats, 0, { } },
+    { "scheduleCancel", cmd_schedule_cancel, 1, {
+        { "job id", CT_INT, false, 1, INT_MAX, 0 } } },
+    { "subscribePolicy", cmd_subscribe_policy, 3, {
+        { "register mask", CT_INT, false, 0, 255, 0 },
+        { "min interval ms", CT_INT, true, 0, 3600000, 0 },
+        { "coalesce ms", CT_INT, true, 0, 60000, 0 } } },
+    { "subscribeRegister", cmd_subscribe_register, 3, {
+        { "register address", CT_INT, false, 0, 255, 0 },
+        { "cancel", CT_INT, true, 0, 1, 0 },
+        { "board address", CT_INT, true, 0, BUS_ADDRESS_BROADCAST, 0 } } },
+    { "writeOutputRegister", cmd_write_output_register, 3, {
+        { "register value", CT_INT, false, 0, 255, 0 },
+        { "register mask", CT_INT, false, 0, 255, 0 },
+        { "board address", CT_INT, true, 0, BUS_ADDRESS_BROADCAST, 0 } } },
+    { "writeRegister", cmd_write_register, 4, {
+        { "register address", CT_INT, false, 0, 255, 0 },
+        { "register value", CT_INT, false, 0, 255, 0 },
+        { "register mask", CT_INT, false, 0, 255, 0 },
+        { "board address", CT_INT, true, 0, BUS_ADDRESS_BROADCAST, 0 } } },
+    { "writeRegisterBit", cmd_write_register_bit, 4, {
+        { "register address", CT_INT, false, 0, 255, 0 },
+        { "bit", CT_INT, false, 0, 7, 0 },
+        { "state", CT_INT, false, 0, 1, 0 },
+        { "board address", CT_INT, true, 0, BUS_ADDRESS_BROADCAST, 0 } } },
+};
+#define COMMAND_COUNT  (sizeof(s_commands) / sizeof(s_commands[0]))
 
-        int ms;
-        rc = get_int_from_array(pobj, 2, &ms);
-        if(0 != rc)
+
+////////////////////////////////////////
+bool checkCommands(void)
+{
+    return(ct_check(s_commands, COMMAND_COUNT));
+}
+
+
+////////////////////////////////////////
+// the commands a job can run, relay and register writes
+static bool schedulable(const ct_command* p_cmd)
+{
+    return((cmd_pulse_relay == p_cmd->m_handler) || (cmd_write_output_register == p_cmd->m_handler) ||
+           (cmd_write_register == p_cmd->m_handler) || (cmd_write_register_bit == p_cmd->m_handler));
+}
+
+////////////////////////////////////////
+// the arguments of a scheduled command, after the time and the name
+typedef struct
+{
+    const ct_source* m_source;
+    int m_offset;
+} shifted_source;
+
+static bool shifted_int(void* p_ctx, const int p_index, int* p_value)
+{
+    const shifted_source* pshifted = (const shifted_source*)p_ctx;
+    return(pshifted->m_source->m_getInt(pshifted->m_source->m_ctx, (p_index + pshifted->m_offset), p_value));
+}
+static bool shifted_string(void* p_ctx, const int p_index, const char** p_value)
+{
+    const shifted_source* pshifted = (const shifted_source*)p_ctx;
+    return(pshifted->m_source->m_getString(pshifted->m_source->m_ctx, (p_index + pshifted->m_offset), p_value));
+}
+
+////////////////////////////////////////
+// ["scheduleIn",<delay ms>,"<command>",<arg>,...]  or at a wall clock time,
+// in a string as it does not fit an int: ["scheduleAt","<epoch ms>","<command>",<arg>,...]
+// ex: ["scheduleAt","1760000400000","pulseRelay",2,250]
+// pulseRelay, writeOutputRegister, writeRegister and writeRegisterBit, not
+// in a batch. checked now, answered with ["scheduled",<id>,<due epoch ms>],
+// id 0 when the schedule is full, and run by sc_on_due()
+static int dispatch_schedule(const char* p_fcn, const ct_source* p_source)
+{
+    const uint64_t now = date_ms_now();
+    uint64_t dueMs;
+    if(0 == strcmp("scheduleAt", p_fcn))
+    {
+        const char* str;
+        char* end;
+        if(!p_source->m_getString(p_source->m_ctx, 0, &str))
         {
-            log_debug("pulseRelay: no cycle ms specified, defaulting to 250ms");
-            ms = 250;
+            log_err("error: %s: param0 'epoch ms' is not a string", p_fcn);
+            return(-1);
         }
-        if((ms < 0) || (ms > 255))
+        errno = 0;
+        dueMs = strtoull(str, &end, 10);
+        if((end == str) || ('\0' != *end) || (0 != errno) || (dueMs > (now + INT_MAX)))
         {
-            log_err("error: pulseRelay: pulse duration ms out of range (0-255): [%dms]", ms);
+            log_err("error: %s: epoch ms invalid or more than [%d] ms out: [%s]", p_fcn, INT_MAX, str);
             return(-1);
         }
+    }
+    else
+    {
+        int delayMs;
+        if(!p_source->m_getInt(p_source->m_ctx, 0, &delayMs) || (delayMs < 0))
+        {
+            log_err("error: %s: param0 'delay ms' is not a number of ms", p_fcn);
+            return(-1);
+        }
+        dueMs = (now + delayMs);
+    }
+
+    const char* name;
+    if(!p_source->m_getString(p_source->m_ctx, 1, &name))
+    {
+        log_err("error: %s: param1 'command' is not a string", p_fcn);
+        return(-1);
+    }
+    const ct_command* cmd = ct_find(s_commands, COMMAND_COUNT, name);
+    if((NULL == cmd) || !schedulable(cmd))
+    {
+        log_err("error: %s: [%s] can not be scheduled", p_fcn, name);
+        return(-1);
+    }
+    shifted_source shifted = { p_source, 2 };
+    const ct_source source = { &shifted, (p_source->m_count - 2), shifted_int, shifted_string };
+    ct_value args[CT_MAX_ARGS];
+    if(!ct_args(cmd, &source, args))
+    {
+        return(-1);
+    }
+
+    sc_job job;
+    memset(&job, 0, sizeof(job));
+    job.m_dueMs = dueMs;
+    strncpy(job.m_name, cmd->m_name, (sizeof(job.m_name) - 1));
+    for(uint8_t i=0; i<cmd->m_argCount; ++i)
+    {
+        job.m_args[i] = args[i].m_int;
+        job.m_given |= (args[i].m_given ? (1 << i) : 0);
+    }
+    const uint32_t id = sc_add(&job);
+    log_notice("%s: [%s] in [%lldms] id: [%u]", p_fcn, cmd->m_name, (long long)(dueMs - now), id);
+    const int64_t values[] = { id, (int64_t)dueMs };
+    push_event("scheduled", values, (sizeof(values) / sizeof(values[0])));
+    return(0);
+}
+
+////////////////////////////////////////
+static int dispatch_cmd(const char* p_fcn, const ct_source* p_source)
+{
+    tr_name(s_tag, p_fcn);
+    if((0 == strcmp("scheduleAt", p_fcn)) || (0 == strcmp("scheduleIn", p_fcn)))
+    {
+        return(dispatch_schedule(p_fcn, p_source));
+    }
+
+    const ct_command* cmd = ct_find(s_commands, COMMAND_COUNT, p_fcn);
+    if(NULL == cmd)
+    {
+        log_err("error: unknown function: [%s]", p_fcn);
+        s_invalidReason = RS_REASON_UNKNOWN;
+        return(-1);
+    }
+
+    ct_value args[CT_MAX_ARGS];
+    if(!ct_args(cmd, p_source, args))
+    {
+        s_invalidReason = RS_REASON_ARGUMENTS;
+        return(-1);
+    }
+    cmd->m_handler(args);
+    return(0);
+}
 
-        pulseRelay((uint8_t)num, (uint8_t)ms);
+////////////////////////////////////////
+// {"batch":{"count":3,"ok":true}}, a command that does not check out
+// ("invalid": index) keeps all of them from running, "errors" counts
+// the ones the serial layer refused
+static void send_batch_result(const int p_count, const int p_invalid, const int p_errors)
+{
+    size_t capacity;
+    char* buf = event_begin(&capacity);
+    if(NULL == buf)
+    {
+        return;
     }
+    struct json_writer jw;
+    jw_init(&jw, buf, capacity);
+    jw_object_begin(&jw);
+    jw_key(&jw, CP_BATCH);
+    jw_object_begin(&jw);
+    jw_key(&jw, "count");
+    jw_int(&jw, p_count);
+    jw_key(&jw, "ok");
+    jw_bool(&jw, ((p_invalid < 0) && (0 == p_errors)));
+    if(p_invalid >= 0)
+    {
+        jw_key(&jw, "invalid");
+        jw_int(&jw, p_invalid);
+    }
+    if(p_errors > 0)
+    {
+        jw_key(&jw, "errors");
+        jw_int(&jw, p_errors);
+    }
+    jw_object_end(&jw);
+    jw_object_end(&jw);
+    event_end(jw_finish(&jw));
+}
 
-    else if(0 == strcmp("writeOutputRegister", fcn))
+////////////////////////////////////////
+// ["batch", ["pulseRelay",1,250], ["writeOutputRegister",1,255], ...]
+// every command is checked before any runs, the frames then go out to
+// the board in one write
+static int dispatch_batch(const char* const* p_fcns, const ct_source* p_sources, const int p_count)
+{
+    const ct_command* cmds[CP_MAX_BATCH];
+    ct_value args[CP_MAX_BATCH][CT_MAX_ARGS];
+    tr_name(s_tag, CP_BATCH);
+    for(int i=0; i<p_count; ++i)
     {
-        // ["writeOutputRegister",1,255]
-        int val;
-        rc = get_int_from_array(pobj, 1, &val);
-        if(0 != rc)
+        cmds[i] = ct_find(s_commands, COMMAND_COUNT, p_fcns[i]);
+        if(NULL == cmds[i])
         {
-            log_err("error: writeOutputRegister: failed to extract param0 'value'");
-            return(-1);
+            log_err("error: batch: unknown function: [%s]", p_fcns[i]);
         }
-        if((val < 0) || (val > 255))
+        if((NULL == cmds[i]) || !ct_args(cmds[i], &p_sources[i], args[i]))
         {
-            log_err("error: writeOutputRegister: register value out of range (0-255): [%d]", val);
+            s_invalidReason = ((NULL == cmds[i]) ? RS_REASON_UNKNOWN : RS_REASON_ARGUMENTS);
+            log_err("error: batch: command [%d] of [%d] is invalid, none run", i, p_count);
+            send_batch_result(p_count, i, 0);
             return(-1);
         }
+    }
 
-        int mask;
-        rc = get_int_from_array(pobj, 2, &mask);
-        if(0 != rc)
+    log_debug("batch: [%d] commands", p_count);
+    const int errors = s_dispatchErrors;
+    s_inBatch = true;
+    mp_burst_begin();
+    for(int i=0; i<p_count; ++i)
+    {
+        if(cmd_write_output_register != cmds[i]->m_handler)
         {
-            log_err("error: writeOutputRegister: failed to extract param1 'mask'");
-            return(-1);
+            flush_write();  // the writes keep their place
         }
-        if((mask < 0) || (mask > 255))
+        cmds[i]->m_handler(args[i]);
+    }
+    flush_write();
+    s_inBatch = false;
+    if(!mp_burst_end())
+    {
+        ++s_dispatchErrors;
+    }
+    send_batch_result(p_count, -1, (s_dispatchErrors - errors));
+    return(0);
+}
+
+static int dispatch_request(const char* p_id, const char* p_msg);
+
+////////////////////////////////////////
+// a command or a batch, p_request takes a request around one too
+static int dispatch(const char* p_msg, const bool p_request)
+{
+    // the usual flat array, without a json-c tree
+    cp_msg msg;
+    if(cp_parse(p_msg, &msg))
+    {
+        const ct_source source = { &msg, msg.m_count, cp_source_int, cp_source_string };
+        return(dispatch_cmd(msg.m_name, &source));
+    }
+
+    const char* fcns[CP_MAX_BATCH];
+    ct_source sources[CP_MAX_BATCH];
+    {
+        cp_msg msgs[CP_MAX_BATCH];
+        const int count = cp_parse_batch(p_msg, msgs, CP_MAX_BATCH);
+        if(count >= 0)
         {
-            log_err("error: writeOutputRegister: register mask out of range (0-255): [%d]", mask);
-            return(-1);
+            for(int i=0; i<count; ++i)
+            {
+                fcns[i] = msgs[i].m_name;
+                sources[i].m_ctx = &msgs[i];
+                sources[i].m_count = msgs[i].m_count;
+                sources[i].m_getInt = cp_source_int;
+                sources[i].m_getString = cp_source_string;
+            }
+            return(dispatch_batch(fcns, sources, count));
         }
+    }
+
+    struct json_object* pobj = json_tokener_parse(p_msg);
+    if((NULL == pobj) || (is_error(pobj)))
+    {
+        log_err("error: message does not appear to be a valid json message: %s", p_msg);
+        s_invalidReason = RS_REASON_PARSE;
+        return(-1);
+    }
 
-        writeOutputRegister((uint8_t)val, (uint8_t)mask);
+    // param 0 is the function name
+    const char* fcn;
+    int rc = get_string_from_array(pobj, 0, &fcn);
+    if(0 != rc)
+    {
+        log_err("error: failed to get function name from message");
+        s_invalidReason = RS_REASON_PARSE;
+        json_object_put(pobj);
+        return(-1);
     }
 
-    else if(0 == strcmp("dialModem", fcn))
+    if(p_request && (0 == strcmp(CP_REQUEST, fcn)))
     {
-        // ["dialModem","ATD3,4,4;"]
-        const char* val;
-        rc = get_string_from_array(pobj, 1, &val);
-        if(0 != rc)
+        // one cp_parse_request() did not take
+        const char* id;
+        struct json_object* pcmd = json_object_array_get_idx(pobj, 2);
+        if((0 != get_string_from_array(pobj, 1, &id)) || ('\0' == id[0]) || (strlen(id) > DD_ID_LEN) ||
+           (json_type_array != json_object_get_type(pcmd)))
         {
-            log_err("error: dialModem: failed to extract param0 dial string");
+            log_err("error: %s: not [\"%s\",\"<id>\",<command>] or the id is longer than [%d]", CP_REQUEST, CP_REQUEST, DD_ID_LEN);
+            json_object_put(pobj);
             return(-1);
         }
+        rc = dispatch_request(id, json_object_to_json_string(pcmd));
+        json_object_put(pobj);
+        return(rc);
+    }
 
-        dialModem(val);
+    if(0 != strcmp(CP_BATCH, fcn))
+    {
+        const ct_source source = { pobj, (json_object_array_length(pobj) - 1), json_get_int, json_get_string };
+        rc = dispatch_cmd(fcn, &source);
+        json_object_put(pobj);  // the strings in it are done with too
+        return(rc);
     }
 
-    else if(0 == strcmp("hello", fcn))
+    // a batch cp_parse_batch() did not take, the commands are arrays
+    const int count = (json_object_array_length(pobj) - 1);
+    if(count > CP_MAX_BATCH)
     {
-        // ["hello","<device id>"]
-        const char* str;
-        rc = get_string_from_array(pobj, 1, &str);
-        if(0 != rc)
+        log_err("error: batch: [%d] commands, at most [%d]", count, CP_MAX_BATCH);
+        send_batch_result(count, CP_MAX_BATCH, 0);
+        json_object_put(pobj);
+        return(-1);
+    }
+    for(int i=0; i<count; ++i)
+    {
+        struct json_object* pcmd = json_object_array_get_idx(pobj, (i + 1));
+        if(0 != get_string_from_array(pcmd, 0, &fcns[i]))
         {
-            log_err("error: hello: failed to extract param0 device id");
+            log_err("error: batch: failed to get function name of command [%d]", i);
+            send_batch_result(count, i, 0);
+            json_object_put(pobj);
             return(-1);
         }
-
-        processHello(str);
+        sources[i].m_ctx = pcmd;
+        sources[i].m_count = (json_object_array_length(pcmd) - 1);
+        sources[i].m_getInt = json_get_int;
+        sources[i].m_getString = json_get_string;
     }
+    rc = dispatch_batch(fcns, sources, count);
+    json_object_put(pobj);
+    return(rc);
+}
 
-    else if(0 == strcmp("requestIpv4Addresses", fcn))
+////////////////////////////////////////
+// ["req","<id>",["pulseRelay",1,250]]  or a batch  ["req","<id>",["batch",...]]
+// run once per id, the server can send it again after a reconnect and
+// gets the result it had, see dedup.h. the id is the server's to keep
+// unique, one of the last DD_MAX_IDS is never run twice. the result goes
+// out when the board has the command, see results.h and rs_on_done()
+static int dispatch_request(const char* p_id, const char* p_msg)
+{
+    const dd_result* pdone = dd_find(p_id);
+    if(NULL != pdone)
+    {
+        log_notice("request: [%s] ran already, not run again", p_id);
+        tr_name(s_tag, CP_REQUEST);
+        rs_replay(p_id, pdone);
+        return(0);
+    }
+    if(rs_running(p_id))
     {
-        requestIpv4Addresses();
+        log_notice("request: [%s] is running, not run again", p_id);
+        tr_name(s_tag, CP_REQUEST);
+        return(0);
     }
 
+    // the request is all of the message, its frames all of the tagged ones
+    rs_begin(p_id, s_tag);
+    const int errors = s_dispatchErrors;
+    s_invalidReason = RS_REASON_INVALID;
+    const int rc = dispatch(p_msg, false);
+    const uint8_t frames = mp_tagged();
+    if(rc < 0)
+    {
+        rs_end(s_tag, DD_INVALID, s_invalidReason, frames);
+    }
+    else if(errors != s_dispatchErrors)
+    {
+        rs_end(s_tag, DD_FAILED, RS_REASON_SERIAL, frames);
+    }
     else
     {
-        log_err("error: unknown function: [%s]", fcn);
+        rs_end(s_tag, DD_OK, RS_REASON_NONE, frames);
     }
-
-    return(0);
+    return(rc);
 }
 
+////////////////////////////////////////
+int dispatch_msg(const char* p_msg)
+{
+    log_debug("parsing message: %s", p_msg);
 
+    char id[DD_ID_LEN + 1];
+    const char* cmd;
+    size_t len;
+    if(cp_parse_request(p_msg, id, sizeof(id), &cmd, &len))
+    {
+        char buf[len + 1];
+        memcpy(buf, cmd, len);
+        buf[len] = '\0';
+        return(dispatch_request(id, buf));
+    }
+    return(dispatch(p_msg, true));
+}
 
 //
 // websock.h callback impl
 //
 
+////////////////////////////////////////
+// everything the server needs after a (re)connect, in one message:
+// {"hello":{"device":"<id>","protocol":<n>,"journal":[<acked>,<last>],"ipv4":[...],
+//   "firmware":[[<board>,<version>,<caps>],...],"registers":[[<board>,<reg>,<value>,<age ms>],...]}}
+// what does not fit is left out with "partial":true, readRegister has the rest
+#define HELLO_CLOSE  32  // kept for "partial" and the closing brackets
+static void send_hello(void)
+{
+    size_t capacity;
+    char* buf = ws_text_reserve(&capacity);
+    if(NULL == buf)
+    {
+        return;
+    }
+    rc_value values[RC_MAX_ENTRIES];
+    const uint8_t count = rc_snapshot(values, RC_MAX_ENTRIES);
+    bool partial = false;
+
+    struct json_writer jw;
+    jw_init(&jw, buf, (capacity - HELLO_CLOSE));
+    jw_object_begin(&jw);
+    jw_key(&jw, "hello");
+    jw_object_begin(&jw);
+    jw_key(&jw, "device");
+    jw_string(&jw, s_deviceId);
+    jw_key(&jw, "protocol");
+    jw_int(&jw, PROTOCOL_VERSION);
+    jw_key(&jw, "journal");
+    jw_array_begin(&jw);
+    jw_int(&jw, jr_acked());
+    jw_int(&jw, jr_last());
+    jw_array_end(&jw);
+
+    // each list and each entry in it goes in whole or not at all, the
+    // writer copied back to where it was when one does not fit
+    struct json_writer before = jw;
+    jw_key(&jw, "ipv4");
+    if(!write_ipv4_addresses(&jw) || jw.m_overflow)
+    {
+        jw = before;
+        partial = true;
+    }
+    for(int list=0; (list < 2) && !partial; ++list)
+    {
+        before = jw;
+        jw_key(&jw, ((0 == list) ? "firmware" : "registers"));
+        jw_array_begin(&jw);
+        for(uint8_t i=0; (i < count) && !partial; ++i)
+        {
+            const rc_value* pvalue = &values[i];
+            const bool firmware = ((REG_FW_VERSION == pvalue->m_register) || (REG_FW_CAPS == pvalue->m_register));
+            uint8_t caps;
+            uint32_t ageMs;
+            if(0 == list)
+            {
+                if((REG_FW_VERSION != pvalue->m_register) || !rc_get(pvalue->m_board, REG_FW_CAPS, &caps, &ageMs))
+                {
+                    continue;  // a board per version, with its caps
+                }
+            }
+            else if(firmware)
+            {
+                continue;
+            }
+            const struct json_writer entry = jw;
+            jw_array_begin(&jw);
+            jw_int(&jw, pvalue->m_board);
+            if(0 == list)
+            {
+                jw_int(&jw, pvalue->m_value);
+                jw_int(&jw, caps);
+            }
+            else
+            {
+                jw_int(&jw, pvalue->m_register);
+                jw_int(&jw, pvalue->m_value);
+                jw_int(&jw, pvalue->m_ageMs);
+            }
+            jw_array_end(&jw);
+            if(jw.m_overflow)
+            {
+                jw = entry;
+                partial = true;
+            }
+        }
+        jw_array_end(&jw);
+        if(jw.m_overflow)
+        {
+            jw = before;  // not even the empty list
+            partial = true;
+        }
+    }
+
+    jw.m_capacity = capacity;
+    if(partial)
+    {
+        jw_key(&jw, "partial");
+        jw_bool(&jw, true);
+    }
+    jw_object_end(&jw);
+    jw_object_end(&jw);
+    ws_text_commit(jw_finish(&jw));
+}
+
 ////////////////////////////////////////
 void ws_onopen(void)
 {
     log_info("ws_onopen -- connection established --");
+    send_hello();
+
+    // what the server missed, from the last record it acknowledged
+    s_replayed = jr_acked();
+    replay_journal();
+}
+
+////////////////////////////////////////
+void ws_ondrain(void)
+{
+    replay_journal();
 }
 
 ////////////////////////////////////////
@@ -332,7 +1274,12 @@ void ws_onmessage(const char* p_msg)
 {
     log_debug("ws_onmessage");
     log_trace("message received: %s", p_msg);
+    s_tag = tr_begin();
+    mp_set_tag(s_tag);
     dispatch_msg(p_msg);
+    mp_set_tag(0);
+    tr_stamp(s_tag, TR_DISPATCHED);
+    s_tag = 0;
 }
 
 ////////////////////////////////////////
@@ -347,6 +1294,23 @@ void ws_onclose(const bool p_force)
     log_info("ws_onclose");
 }
 
+////////////////////////////////////////
+void ws_onunsent(const char* p_msg, const size_t p_len)
+{
+    // an event the connection closed on, replayed with the rest
+    if(0 == jr_append(p_msg, p_len))
+    {
+        log_debug("ws_onunsent: not journaled, dropped: [%.*s]", (int)p_len, p_msg);
+    }
+}
+
+////////////////////////////////////////
+void ws_onpollfd(const int p_fd, const short p_events)
+{
+    // cloud commands and writeable callbacks wake the worker loop
+    mp_wait_fd(p_fd, p_events);
+}
+
 ////////////////////////////////////////
 void ws_onpong(const char* p_msg)
 {
@@ -365,38 +1329,192 @@ void ws_onpong(const char* p_msg)
 // msg_proc.h callback impl
 //
 
+
 ////////////////////////////////////////
 void mp_on_pong(const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
 {
-    log_debug("mp_on_pong");
+    log_debug("mp_on_pong - board: [0x%02x]", mp_rx_address());
+    lp_on_pong(p_param1, p_param2, p_param3);
 }
 
 ////////////////////////////////////////
 void mp_on_read_register(const uint8_t p_registerAddress)
 {
-    log_debug("mp_on_read_register");
+    log_debug("mp_on_read_register - board: [0x%02x]", mp_rx_address());
 }
 
 ////////////////////////////////////////
 void mp_on_write_register(const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask)
 {
-    log_debug("mp_on_write_register");
+    // a board writes the daemon only to answer a read
+    const uint8_t board = mp_rx_address();
+    log_debug("mp_on_write_register - board: [0x%02x]  register: [0x%02x]  value: [0x%02x]", board, p_registerAddress, p_value);
+    if(REG_ERR_UNKNOWN != p_registerAddress)
+    {
+        rc_update(board, p_registerAddress, p_value, false);
+    }
+    if(cloud_read_answered(board, p_registerAddress))
+    {
+        push_register("registerValue", board, p_registerAddress, p_value, 0);
+    }
 }
 
 ////////////////////////////////////////
 void mp_on_write_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state)
 {
-    log_debug("mp_on_write_register_bit");
+    log_debug("mp_on_write_register_bit - board: [0x%02x]", mp_rx_address());
 }
 
 ////////////////////////////////////////
 void mp_on_pulse_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs)
 {
-    log_debug("mp_on_pulse_register_bit");
+    log_debug("mp_on_pulse_register_bit - board: [0x%02x]", mp_rx_address());
 }
 
 ////////////////////////////////////////
 void mp_on_subscribe_register(const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
 {
-    log_debug("mp_on_subscribe_register");
+    const uint8_t board = mp_rx_address();
+    log_debug("mp_on_subscribe_register - board: [0x%02x]  register: [0x%02x]  value: [0x%02x]", board, p_registerAddress, p_value);
+    if(p_cancel)
+    {
+        rc_unsubscribed(board, p_registerAddress);
+    }
+    else
+    {
+        rc_update(board, p_registerAddress, p_value, true);
+    }
+
+    // an unknown register comes back as REG_ERR_UNKNOWN, pushed as it is
+    if(REG_ERR_UNKNOWN == p_registerAddress)
+    {
+        push_register("subscribeCancel", board, p_registerAddress, 0, 0);
+        return;
+    }
+    fo_publish(board, p_registerAddress, p_value, p_cancel);
+}
+
+////////////////////////////////////////
+void mp_on_ack(const uint8_t p_type, const uint8_t p_registerAddress, const uint8_t p_status)
+{
+    tr_stamp(mp_rx_tag(), TR_ACKED);
+    rs_acked(mp_rx_tag(), ((MP_ACK_FAILED == p_status) ? RS_REASON_NOT_DELIVERED :
+                           (((ACK_OK == p_status) || (ACK_DUPLICATE == p_status)) ? RS_REASON_NONE : RS_REASON_REJECTED)));
+    if(MP_ACK_FAILED == p_status)
+    {
+        log_err("mp_on_ack - command: [0x%02x]  register: [0x%02x] not delivered", p_type, p_registerAddress);
+        if((MSG_WRITE_REGISTER == p_type) || (MSG_WRITE_REGISTER_BIT == p_type))
+        {
+            rc_forget(mp_rx_address(), p_registerAddress);  // the write is in the cache already
+        }
+
+        // ["commandFailed",<msg type>,<reg>,<board>]
+        size_t capacity;
+        char* buf = event_begin(&capacity);
+        if(NULL != buf)
+        {
+            struct json_writer jw;
+            jw_init(&jw, buf, capacity);
+            jw_array_begin(&jw);
+            jw_string(&jw, "commandFailed");
+            jw_int(&jw, p_type);
+            jw_int(&jw, p_registerAddress);
+            jw_int(&jw, mp_rx_address());
+            jw_array_end(&jw);
+            event_end(jw_finish(&jw));
+        }
+        return;
+    }
+    log_debug("mp_on_ack - command: [0x%02x]  register: [0x%02x]  status: [%u]", p_type, p_registerAddress, p_status);
+}
+
+////////////////////////////////////////
+void mp_on_sent(const uint32_t p_tag, const bool p_acked)
+{
+    tr_stamp(p_tag, TR_SENT);
+    rs_sent(p_tag, p_acked);
+}
+
+
+
+//
+// results.h callback impl
+//
+
+////////////////////////////////////////
+// ["results",["<id>",<status>,"<reason>",<received epoch ms>,<tx us>,<ack us>,<replayed>],...]
+// status DD_* (dedup.h), the reason when it is not DD_OK, the serial tx
+// and the board's ack in us after the request came in (-1: none), and
+// replayed when it had run already and was not run again
+bool rs_on_done(const rs_done* p_done, const uint8_t p_count)
+{
+    size_t capacity;
+    char* buf = event_begin(&capacity);
+    if(NULL == buf)
+    {
+        return(false);
+    }
+    struct json_writer jw;
+    jw_init(&jw, buf, capacity);
+    jw_array_begin(&jw);
+    jw_string(&jw, "results");
+    for(uint8_t i=0; i<p_count; ++i)
+    {
+        const dd_result* presult = &p_done[i].m_result;
+        jw_array_begin(&jw);
+        jw_string(&jw, p_done[i].m_id);
+        jw_int(&jw, presult->m_status);
+        jw_string(&jw, rs_reason(presult->m_reason));
+        jw_int(&jw, presult->m_receivedMs);
+        jw_int(&jw, presult->m_txUs);
+        jw_int(&jw, presult->m_ackUs);
+        jw_int(&jw, (p_done[i].m_replayed ? 1 : 0));
+        jw_array_end(&jw);
+    }
+    jw_array_end(&jw);
+    const size_t len = jw_finish(&jw);
+    if(0 == len)
+    {
+        log_err("rs_on_done: [%u] results do not fit in [%zu] bytes", p_count, capacity);
+    }
+    event_end(len);
+    for(uint8_t i=0; i<p_count; ++i)
+    {
+        tr_stamp(p_done[i].m_tag, TR_REPLIED);
+    }
+    return(true);
+}
+
+
+
+//
+// schedule.h callback impl
+//
+
+////////////////////////////////////////
+void sc_on_due(const sc_job* p_job, const int64_t p_lateUs)
+{
+    if(p_lateUs > ((int64_t)SCHEDULE_LATE_MS * 1000))
+    {
+        log_err("sc_on_due - [%s] id: [%u] [%lldms] late, not run", p_job->m_name, p_job->m_id, (long long)(p_lateUs / 1000));
+        push_schedule_done(p_job->m_id, p_lateUs, SCHEDULE_LATE);
+        return;
+    }
+    const ct_command* cmd = ct_find(s_commands, COMMAND_COUNT, p_job->m_name);
+    if(NULL == cmd)
+    {
+        push_schedule_done(p_job->m_id, p_lateUs, SCHEDULE_FAILED);  // from a daemon that had it
+        return;
+    }
+    ct_value args[CT_MAX_ARGS];
+    for(uint8_t i=0; i<CT_MAX_ARGS; ++i)
+    {
+        args[i].m_int = p_job->m_args[i];
+        args[i].m_str = NULL;
+        args[i].m_given = (0 != (p_job->m_given & (1 << i)));
+    }
+    const int errors = s_dispatchErrors;
+    cmd->m_handler(args);
+    log_debug("sc_on_due - [%s] id: [%u] late: [%lldus]", p_job->m_name, p_job->m_id, (long long)p_lateUs);
+    push_schedule_done(p_job->m_id, p_lateUs, ((errors == s_dispatchErrors) ? SCHEDULE_RAN : SCHEDULE_FAILED));
 }
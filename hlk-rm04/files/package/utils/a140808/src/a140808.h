@@ -0,0 +1,36 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __a140808_h__
+#define __a140808_h__
+
+#include <stdbool.h>
+
+//
+// the cloud side of the daemon, the websocket and msg_proc callbacks in
+// a140808.c, set up by daemon.c
+//
+
+// the serial number the device goes by, in the hello snapshot
+void setDeviceId(const char* p_id);
+
+// false if the command table is out of order, a command would never be
+// found, the daemon does not start then
+bool checkCommands(void);
+
+#endif // __a140808_h__
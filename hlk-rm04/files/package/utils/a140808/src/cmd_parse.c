@@ -0,0 +1,319 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its 
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including, 
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR 
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any 
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#include <limits.h>
+#include <stddef.h>  // NULL
+#include <string.h>  // strcmp
+
+#include "cmd_parse.h"
+
+
+////////////////////////////////////////
+static bool is_space(const char p_ch)
+{
+    return((' ' == p_ch) || ('\t' == p_ch) || ('\r' == p_ch) || ('\n' == p_ch));
+}
+
+////////////////////////////////////////
+static const char* skip_space(const char* p_pos)
+{
+    while(is_space(*p_pos))
+    {
+        ++p_pos;
+    }
+    return(p_pos);
+}
+
+////////////////////////////////////////
+// a decimal int, NULL if it is not one or does not fit
+static const char* parse_int(const char* p_pos, int* p_value)
+{
+    const bool negative = ('-' == *p_pos);
+    if(negative)
+    {
+        ++p_pos;
+    }
+    if((*p_pos < '0') || (*p_pos > '9') || (('0' == p_pos[0]) && (p_pos[1] >= '0') && (p_pos[1] <= '9')))
+    {
+        return(NULL);
+    }
+
+    long value = 0;
+    while((*p_pos >= '0') && (*p_pos <= '9'))
+    {
+        value = ((value * 10) + (*p_pos++ - '0'));
+        if(value > ((long)INT_MAX + 1))
+        {
+            return(NULL);
+        }
+    }
+    value = (negative ? -value : value);
+    if(value > INT_MAX)
+    {
+        return(NULL);
+    }
+    *p_value = (int)value;
+    return(p_pos);
+}
+
+////////////////////////////////////////
+// a string at the opening quote into p_buf, NULL if it does not fit or
+// has an escape we leave to json-c
+static const char* parse_string(const char* p_pos, char** p_buf, const char* p_bufEnd)
+{
+    char* out = *p_buf;
+    for(++p_pos; '"' != *p_pos; ++p_pos)
+    {
+        char ch = *p_pos;
+        if((unsigned char)ch < 0x20)
+        {
+            // control chars are escaped in json, the end of the message too
+            return(NULL);
+        }
+        if('\\' == ch)
+        {
+            switch(*++p_pos)
+            {
+                case '"':  ch = '"';  break;
+                case '\\': ch = '\\'; break;
+                case '/':  ch = '/';  break;
+                case 'b':  ch = '\b'; break;
+                case 'f':  ch = '\f'; break;
+                case 'n':  ch = '\n'; break;
+                case 'r':  ch = '\r'; break;
+                case 't':  ch = '\t'; break;
+                default:   return(NULL);  // \u and junk
+            }
+        }
+        if(out == p_bufEnd)
+        {
+            return(NULL);
+        }
+        *out++ = ch;
+    }
+    if(out == p_bufEnd)
+    {
+        return(NULL);
+    }
+    *out++ = '\0';
+    *p_buf = out;
+    return(p_pos + 1);
+}
+
+////////////////////////////////////////
+// one command array, the position after its ']' or NULL
+static const char* parse_command(const char* p_pos, cp_msg* p_out)
+{
+    char* buf = p_out->m_buf;
+    const char* bufEnd = (p_out->m_buf + CP_BUF_LEN);
+
+    const char* pos = skip_space(p_pos);
+    if('[' != *pos)
+    {
+        return(NULL);
+    }
+    pos = skip_space(pos + 1);
+    if('"' != *pos)
+    {
+        return(NULL);
+    }
+    p_out->m_name = buf;
+    pos = parse_string(pos, &buf, bufEnd);
+    if(NULL == pos)
+    {
+        return(NULL);
+    }
+
+    p_out->m_count = 0;
+    for(pos=skip_space(pos); ',' == *pos; pos=skip_space(pos))
+    {
+        if(CP_MAX_ARGS == p_out->m_count)
+        {
+            return(NULL);
+        }
+        cp_arg* arg = &p_out->m_args[p_out->m_count++];
+        pos = skip_space(pos + 1);
+        arg->m_isString = ('"' == *pos);
+        if(arg->m_isString)
+        {
+            arg->m_str = buf;
+            pos = parse_string(pos, &buf, bufEnd);
+        }
+        else
+        {
+            arg->m_str = NULL;
+            pos = parse_int(pos, &arg->m_int);
+        }
+        if(NULL == pos)
+        {
+            return(NULL);
+        }
+    }
+
+    return((']' == *pos) ? (pos + 1) : NULL);
+}
+
+////////////////////////////////////////
+bool cp_parse(const char* p_msg, cp_msg* p_out)
+{
+    const char* pos = parse_command(p_msg, p_out);
+    return((NULL != pos) && ('\0' == *skip_space(pos)));
+}
+
+////////////////////////////////////////
+int cp_parse_batch(const char* p_msg, cp_msg* p_out, const int p_max)
+{
+    const char* pos = skip_space(p_msg);
+    if('[' != *pos)
+    {
+        return(-1);
+    }
+    pos = skip_space(pos + 1);
+    if('"' != *pos)
+    {
+        return(-1);
+    }
+    char name[sizeof(CP_BATCH)];
+    char* buf = name;
+    pos = parse_string(pos, &buf, (name + sizeof(name)));
+    if((NULL == pos) || (0 != strcmp(CP_BATCH, name)))
+    {
+        return(-1);
+    }
+
+    int count = 0;
+    for(pos=skip_space(pos); ',' == *pos; pos=skip_space(pos))
+    {
+        if(p_max == count)
+        {
+            return(-1);
+        }
+        pos = parse_command((pos + 1), &p_out[count++]);
+        if(NULL == pos)
+        {
+            return(-1);
+        }
+    }
+
+    if(']' != *pos)
+    {
+        return(-1);
+    }
+    return(('\0' == *skip_space(pos + 1)) ? count : -1);
+}
+
+////////////////////////////////////////
+bool cp_parse_request(const char* p_msg, char* p_id, const size_t p_idLen, const char** p_cmd, size_t* p_cmdLen)
+{
+    const char* pos = skip_space(p_msg);
+    if('[' != *pos)
+    {
+        return(false);
+    }
+    pos = skip_space(pos + 1);
+    if('"' != *pos)
+    {
+        return(false);
+    }
+    char name[sizeof(CP_REQUEST)];
+    char* buf = name;
+    pos = parse_string(pos, &buf, (name + sizeof(name)));
+    if((NULL == pos) || (0 != strcmp(CP_REQUEST, name)))
+    {
+        return(false);
+    }
+    pos = skip_space(pos);
+    if(',' != *pos)
+    {
+        return(false);
+    }
+    pos = skip_space(pos + 1);
+    if('"' != *pos)
+    {
+        return(false);
+    }
+    buf = p_id;
+    pos = parse_string(pos, &buf, (p_id + p_idLen));
+    if((NULL == pos) || ('\0' == p_id[0]))
+    {
+        return(false);
+    }
+    pos = skip_space(pos);
+    if(',' != *pos)
+    {
+        return(false);
+    }
+    pos = skip_space(pos + 1);
+    if('[' != *pos)
+    {
+        return(false);
+    }
+
+    // the command runs to the closing bracket of the request, the end of
+    // the message. the '[' at pos stops the trailing space
+    const char* end = (pos + strlen(pos));
+    while(is_space(end[-1]))
+    {
+        --end;
+    }
+    if(']' != end[-1])
+    {
+        return(false);
+    }
+    --end;
+    while(is_space(end[-1]))
+    {
+        --end;
+    }
+    if(']' != end[-1])
+    {
+        return(false);
+    }
+    *p_cmd = pos;
+    *p_cmdLen = (end - pos);
+    return(true);
+}
+
+////////////////////////////////////////
+bool cp_get_int(const cp_msg* p_msg, const int p_index, int* p_value)
+{
+    if((p_index < 0) || (p_index >= p_msg->m_count))
+    {
+        return(false);
+    }
+    const cp_arg* arg = &p_msg->m_args[p_index];
+    if(!arg->m_isString)
+    {
+        *p_value = arg->m_int;
+        return(true);
+    }
+    const char* end = parse_int(arg->m_str, p_value);
+    return((NULL != end) && ('\0' == *end));
+}
+
+////////////////////////////////////////
+bool cp_get_string(const cp_msg* p_msg, const int p_index, const char** p_value)
+{
+    if((p_index < 0) || (p_index >= p_msg->m_count) || !p_msg->m_args[p_index].m_isString)
+    {
+        return(false);
+    }
+    *p_value = p_msg->m_args[p_index].m_str;
+    return(true);
+}
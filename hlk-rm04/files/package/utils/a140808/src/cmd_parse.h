@@ -0,0 +1,74 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its 
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including, 
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR 
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any 
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#ifndef __cmd_parse_h__
+#define __cmd_parse_h__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//
+// the cloud's commands are flat json arrays, a name then ints and strings:
+//
+//   ["pulseRelay",1,250]   ["hello","<device id>"]
+//
+// cp_parse() decodes that shape straight into a cp_msg on the caller's
+// stack, no allocations. anything else (nesting, floats, true/false/null,
+// \u escapes, more than CP_MAX_ARGS arguments or CP_BUF_LEN of strings)
+// is refused and left to json-c
+//
+
+#define CP_MAX_ARGS   8
+#define CP_BUF_LEN    256
+#define CP_BATCH      "batch"  // name of the envelope, see cp_parse_batch()
+#define CP_MAX_BATCH  16       // commands in one
+#define CP_REQUEST    "req"    // a command or batch with a request id, see cp_parse_request()
+
+typedef struct
+{
+    bool m_isString;
+    int m_int;
+    const char* m_str;       // in cp_msg.m_buf
+} cp_arg;
+
+typedef struct
+{
+    const char* m_name;      // in m_buf
+    uint8_t m_count;         // arguments after the name
+    cp_arg m_args[CP_MAX_ARGS];
+    char m_buf[CP_BUF_LEN];  // the unescaped strings
+} cp_msg;
+
+// false if p_msg is not of the shape above
+bool cp_parse(const char* p_msg, cp_msg* p_out);
+// a batch of them, each in its own cp_msg:
+//   ["batch", ["pulseRelay",1,250], ["writeOutputRegister",1,255]]
+// the number of commands, -1 if p_msg is not of that shape or has more
+// than p_max of them
+int cp_parse_batch(const char* p_msg, cp_msg* p_out, const int p_max);
+// ["req","<id>",<command or batch>], the id into p_id (p_idLen with its nul)
+// and where the command is in p_msg, false if it is not one
+bool cp_parse_request(const char* p_msg, char* p_id, const size_t p_idLen, const char** p_cmd, size_t* p_cmdLen);
+// argument p_index as an int, a string of digits is taken as well like
+// json_object_get_int() does, false if it is neither
+bool cp_get_int(const cp_msg* p_msg, const int p_index, int* p_value);
+bool cp_get_string(const cp_msg* p_msg, const int p_index, const char** p_value);
+
+#endif // __cmd_parse_h__
@@ -0,0 +1,96 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its 
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including, 
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR 
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any 
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#include <stdlib.h>  // bsearch
+#include <string.h>  // strcmp
+
+#include "global.h"
+#include "cmd_table.h"
+
+
+////////////////////////////////////////
+static int compare(const void* p_name, const void* p_cmd)
+{
+    return(strcmp((const char*)p_name, ((const ct_command*)p_cmd)->m_name));
+}
+
+////////////////////////////////////////
+bool ct_check(const ct_command* p_table, const size_t p_count)
+{
+    for(size_t i=1; i<p_count; ++i)
+    {
+        if(strcmp(p_table[i - 1].m_name, p_table[i].m_name) >= 0)
+        {
+            log_err("command table: [%s] is out of order or twice, after [%s]", p_table[i].m_name, p_table[i - 1].m_name);
+            return(false);
+        }
+    }
+    return(true);
+}
+
+////////////////////////////////////////
+const ct_command* ct_find(const ct_command* p_table, const size_t p_count, const char* p_name)
+{
+    return((const ct_command*)bsearch(p_name, p_table, p_count, sizeof(ct_command), compare));
+}
+
+////////////////////////////////////////
+bool ct_args(const ct_command* p_cmd, const ct_source* p_source, ct_value* p_args)
+{
+    for(uint8_t i=0; i<p_cmd->m_argCount; ++i)
+    {
+        const ct_arg* arg = &p_cmd->m_args[i];
+        ct_value* value = &p_args[i];
+        value->m_int = arg->m_default;
+        value->m_str = NULL;
+        value->m_given = (i < p_source->m_count);
+        if(!value->m_given)
+        {
+            if(!arg->m_optional)
+            {
+                log_err("error: %s: missing param%u '%s'", p_cmd->m_name, i, arg->m_name);
+                return(false);
+            }
+            log_debug("%s: no %s specified, defaulting to [%d]", p_cmd->m_name, arg->m_name, arg->m_default);
+            continue;
+        }
+
+        if(CT_STRING == arg->m_type)
+        {
+            if(!p_source->m_getString(p_source->m_ctx, i, &value->m_str))
+            {
+                log_err("error: %s: param%u '%s' is not a string", p_cmd->m_name, i, arg->m_name);
+                return(false);
+            }
+            continue;
+        }
+
+        if(!p_source->m_getInt(p_source->m_ctx, i, &value->m_int))
+        {
+            log_err("error: %s: param%u '%s' is not a number", p_cmd->m_name, i, arg->m_name);
+            return(false);
+        }
+        if((value->m_int < arg->m_min) || (value->m_int > arg->m_max))
+        {
+            log_err("error: %s: %s out of range (%d-%d): [%d]", p_cmd->m_name, arg->m_name, arg->m_min, arg->m_max, value->m_int);
+            return(false);
+        }
+    }
+    return(true);
+}
@@ -0,0 +1,89 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its 
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including, 
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR 
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any 
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#ifndef __cmd_table_h__
+#define __cmd_table_h__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// the commands from the cloud, declared in a table instead of parsed by
+// hand one by one: name, arguments and handler. ct_find() is a binary
+// search, the table has to be sorted by name (strcmp), ct_check() tells.
+// ct_args() fetches and checks the arguments the way the table says, the
+// handler only runs with all of them in range
+//
+//   ["pulseRelay", 1, 250]  -> name, then the arguments in table order
+//
+
+#define CT_MAX_ARGS  4
+
+typedef enum
+{
+    CT_INT,
+    CT_STRING
+} ct_type;
+
+typedef struct
+{
+    const char* m_name;      // for the logs
+    ct_type m_type;
+    bool m_optional;         // m_default when missing
+    int m_min;               // CT_INT range
+    int m_max;
+    int m_default;
+} ct_arg;
+
+typedef struct
+{
+    int m_int;
+    const char* m_str;       // valid until the message is released
+    bool m_given;            // false if an optional one was missing
+} ct_value;
+
+typedef void (*ct_handler)(const ct_value* p_args);
+
+typedef struct
+{
+    const char* m_name;
+    ct_handler m_handler;
+    uint8_t m_argCount;
+    ct_arg m_args[CT_MAX_ARGS];
+} ct_command;
+
+// where ct_args() gets the message's arguments, p_index 0 is the one after
+// the name. the getters return false when the argument has another type
+typedef struct
+{
+    void* m_ctx;
+    int m_count;             // arguments in the message
+    bool (*m_getInt)(void* p_ctx, const int p_index, int* p_value);
+    bool (*m_getString)(void* p_ctx, const int p_index, const char** p_value);
+} ct_source;
+
+// false, and the offending name logged, if p_table is not sorted
+bool ct_check(const ct_command* p_table, const size_t p_count);
+// NULL if there is no such command
+const ct_command* ct_find(const ct_command* p_table, const size_t p_count, const char* p_name);
+// p_args[CT_MAX_ARGS], false (logged) if one is missing, of another type or out of range
+bool ct_args(const ct_command* p_cmd, const ct_source* p_source, ct_value* p_args);
+
+#endif // __cmd_table_h__
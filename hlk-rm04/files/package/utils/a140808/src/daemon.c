@@ -24,10 +24,19 @@
 #include <fcntl.h>
 #include <unistd.h> // _SC_OPEN_MAX
 #include <signal.h>
+#include <poll.h>
 
 #include "global.h"
+#include "a140808.h"
+#include "fanout.h"
 #include "ipaddr.h"
+#include "journal.h"
+#include "link_probe.h"
 #include "msg_proc.h"
+#include "regcache.h"
+#include "results.h"
+#include "schedule.h"
+#include "trace.h"
 #include "websock.h"
 
 #define SERNUM_OFFSET  0x400
@@ -48,6 +57,14 @@ void sig_hup(int p_signum)
     log_notice("received SIGHUP");
 }
 
+////////////////////////////////////////
+// the worker loop dumps the traces, see trace.h
+static bool s_dumpTrace = false;
+void sig_usr1(int p_signum)
+{
+    s_dumpTrace = true;
+}
+
 
 ////////////////////////////////////////
 int get_serial(char* p_buf, const size_t p_len)
@@ -144,6 +161,63 @@ int get_cloudcfg(char* p_buf, const size_t p_len, int* p_port)
 }
 
 
+////////////////////////////////////////
+// board addresses on a multi-drop bus, ex: "1 2 3" or "0x10-0x1f 0x30"
+// returns the count, 0 without a config (point to point)
+int get_buscfg(uint8_t* p_addresses, const size_t p_len)
+{
+    FILE* pfd = fopen(BUS_CONFIG, "r");
+    if(NULL == pfd)
+    {
+        return(0);
+    }
+
+    char* line = NULL;
+    size_t len = 0;
+    const ssize_t rlen = getline(&line, &len, pfd);
+    fclose(pfd);
+    if(rlen <= 0)
+    {
+        if(line) free(line);
+        return(0);
+    }
+
+    size_t count = 0;
+    for(char* pos = line; ; )
+    {
+        char* end;
+        const unsigned long first = strtoul(pos, &end, 0);
+        if(end == pos)
+        {
+            break;
+        }
+        unsigned long last = first;
+        pos = end;
+        if('-' == *pos)
+        {
+            last = strtoul(pos + 1, &end, 0);
+            pos = end;
+        }
+        for(unsigned long address = first; address <= last; ++address)
+        {
+            if((address <= BUS_ADDRESS_NONE) || (address >= BUS_ADDRESS_BROADCAST) || (count == p_len))
+            {
+                log_err("bus address out of range or too many boards: [%lu]", address);
+                free(line);
+                return(-1);
+            }
+            p_addresses[count++] = address;
+        }
+        while((' ' == *pos) || (',' == *pos) || ('\t' == *pos))
+        {
+            ++pos;
+        }
+    }
+    free(line);
+    return(count);
+}
+
+
 ////////////////////////////////////////
 int main(int argc, const char** argv)
 {
@@ -171,6 +245,7 @@ int main(int argc, const char** argv)
     signal(SIGHUP,  SIG_IGN); // ignore hangup signal
 
     signal(SIGHUP, sig_hup);
+    signal(SIGUSR1, sig_usr1);
 
     s_run = true;
     signal(SIGINT, sig_term);
@@ -242,6 +317,13 @@ int main(int argc, const char** argv)
         return(EXIT_FAILURE);
     }
 
+    // a command out of order is never found, ct_check() logs which one
+    if(!checkCommands())
+    {
+        log_err("command table out of order, not starting");
+        return(EXIT_FAILURE);
+    }
+
     // store the pid
     // unlink first to ensure the file does not already exist
     unlink(PIDFILE);
@@ -254,12 +336,35 @@ int main(int argc, const char** argv)
     fprintf(pfd, "%d\n", getpid());
     fclose(pfd);
 
+    // events while offline, without it they are dropped
+    jr_open(JOURNAL_FILE, JOURNAL_SIZE);
+
+    // commands run at a set time, the ones from before a restart too
+    sc_open(SCHEDULE_FILE);
+
     // init the serial message processor
     if(!mp_init(SERIAL_PORT, SERIAL_BAUD, SERIAL_USE_E71))
     {
         log_err("failed to open port: [%s]  baud: [%d]  parity: [%s]\n", SERIAL_PORT, SERIAL_BAUD, (SERIAL_USE_E71 ? "E71" : "N81"));
         return(EXIT_FAILURE);
     }
+    mp_set_reliable(SERIAL_RELIABLE);
+    mp_wait_fd(sc_fd(), POLLIN);
+
+    // boards on a multi-drop bus
+    uint8_t boards[BUS_MAX_BOARDS];
+    const int boardCount = get_buscfg(boards, sizeof(boards));
+    if((boardCount < 0) || ((boardCount > 0) && !mp_bus_init(boards, boardCount)))
+    {
+        log_err("bad bus config: [" BUS_CONFIG "]");
+        return(EXIT_FAILURE);
+    }
+
+    // link health pings, the bus scheduler keeps track of its boards itself
+    lp_init((0 == boardCount) ? LINK_HEALTH_MS : 0);
+
+    // standing subscriptions for the register cache
+    rc_watch();
 
     // kick it at least once to set the creds
     char serno[16] = { 0 };
@@ -268,6 +373,7 @@ int main(int argc, const char** argv)
         log_err("failed to retrieve serial number, errno: [%s]", strerror(errno));
         strcpy(serno, DEFAULT_SERNO);
     }
+    setDeviceId(serno);
 
     char url[64] = { 0 };
     const size_t pos = sprintf(url, "/ws/%s/", serno);
@@ -294,12 +400,25 @@ int main(int argc, const char** argv)
     while(s_run)
     {
         ws_poll();
+        mp_wait(WORKER_WAIT_MS);
+        sc_poll();
+        mp_poll();
+        fo_poll();
+        rs_poll();
+        lp_poll();
+        if(s_dumpTrace)
+        {
+            s_dumpTrace = false;
+            tr_dump(TRACE_FILE);
+        }
     }
 
     // cleanup
     log_notice("daemon closed");
     ws_close();
     mp_close();
+    sc_close();
+    jr_close();
     closesyslog();
     unlink(PIDFILE);
 
@@ -0,0 +1,160 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#include <string.h>  // strcmp
+
+#include "global.h"
+#include "dedup.h"
+
+
+#define DD_BUCKETS  128  // a power of 2, twice DD_MAX_IDS
+
+// the links are entry indexes + 1, 0 for none, so all zeros is empty
+typedef struct
+{
+    char m_id[DD_ID_LEN + 1];
+    uint32_t m_hash;
+    dd_result m_result;
+    uint8_t m_chain;     // the next one in its bucket
+    uint8_t m_newer;     // the use order
+    uint8_t m_older;
+} dd_entry;
+
+static dd_entry s_entries[DD_MAX_IDS];
+static uint8_t s_buckets[DD_BUCKETS];
+static uint8_t s_count = 0;
+static uint8_t s_newest = 0;
+static uint8_t s_oldest = 0;
+
+#define ENTRY(link)  (&s_entries[(link) - 1])
+
+
+////////////////////////////////////////
+// fnv-1a
+static uint32_t hash_of(const char* p_id)
+{
+    uint32_t hash = 2166136261u;
+    while('\0' != *p_id)
+    {
+        hash = ((hash ^ (uint8_t)*p_id++) * 16777619u);
+    }
+    return(hash);
+}
+
+////////////////////////////////////////
+static void unlink_use(const uint8_t p_link)
+{
+    dd_entry* pentry = ENTRY(p_link);
+    if(0 != pentry->m_newer)
+    {
+        ENTRY(pentry->m_newer)->m_older = pentry->m_older;
+    }
+    else
+    {
+        s_newest = pentry->m_older;
+    }
+    if(0 != pentry->m_older)
+    {
+        ENTRY(pentry->m_older)->m_newer = pentry->m_newer;
+    }
+    else
+    {
+        s_oldest = pentry->m_newer;
+    }
+}
+
+////////////////////////////////////////
+static void link_newest(const uint8_t p_link)
+{
+    dd_entry* pentry = ENTRY(p_link);
+    pentry->m_newer = 0;
+    pentry->m_older = s_newest;
+    if(0 != s_newest)
+    {
+        ENTRY(s_newest)->m_newer = p_link;
+    }
+    s_newest = p_link;
+    if(0 == s_oldest)
+    {
+        s_oldest = p_link;
+    }
+}
+
+////////////////////////////////////////
+static void unlink_bucket(const uint8_t p_link)
+{
+    uint8_t* plink = &s_buckets[ENTRY(p_link)->m_hash & (DD_BUCKETS - 1)];
+    while(p_link != *plink)
+    {
+        plink = &ENTRY(*plink)->m_chain;
+    }
+    *plink = ENTRY(p_link)->m_chain;
+}
+
+
+////////////////////////////////////////
+const dd_result* dd_find(const char* p_id)
+{
+    const uint32_t hash = hash_of(p_id);
+    for(uint8_t link = s_buckets[hash & (DD_BUCKETS - 1)]; 0 != link; link = ENTRY(link)->m_chain)
+    {
+        dd_entry* pentry = ENTRY(link);
+        if((hash == pentry->m_hash) && (0 == strcmp(p_id, pentry->m_id)))
+        {
+            unlink_use(link);
+            link_newest(link);
+            return(&pentry->m_result);
+        }
+    }
+    return(NULL);
+}
+
+////////////////////////////////////////
+void dd_add(const char* p_id, const dd_result* p_result)
+{
+    uint8_t link;
+    if(s_count < DD_MAX_IDS)
+    {
+        link = ++s_count;
+    }
+    else
+    {
+        link = s_oldest;
+        unlink_use(link);
+        unlink_bucket(link);
+    }
+    dd_entry* pentry = ENTRY(link);
+    strncpy(pentry->m_id, p_id, DD_ID_LEN);
+    pentry->m_id[DD_ID_LEN] = '\0';
+    pentry->m_hash = hash_of(pentry->m_id);
+    pentry->m_result = *p_result;
+
+    uint8_t* pbucket = &s_buckets[pentry->m_hash & (DD_BUCKETS - 1)];
+    pentry->m_chain = *pbucket;
+    *pbucket = link;
+    link_newest(link);
+}
+
+////////////////////////////////////////
+void dd_clear(void)
+{
+    memset(s_buckets, 0, sizeof(s_buckets));
+    s_count = 0;
+    s_newest = 0;
+    s_oldest = 0;
+}
@@ -0,0 +1,57 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __dedup_h__
+#define __dedup_h__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// the request ids of the commands run lately and how they came out, so a
+// request the server sends again (after a reconnect mid command) is
+// answered with the result it had and not run twice. a hash for the
+// lookup, the least recently used id makes room for a new one
+//
+
+#define DD_MAX_IDS   64
+#define DD_ID_LEN    32  // longest id
+
+#define DD_OK        0
+#define DD_INVALID   1   // the command did not check out, nothing ran
+#define DD_FAILED    2   // the serial layer refused some of it
+
+// the times are from date_ms_now() when the request came in, us after it
+// when its last frame went on the wire and when the board acked that, -1
+// when there was none (a read from the cache, no acks on the link)
+typedef struct
+{
+    uint8_t m_status;      // DD_*
+    uint8_t m_reason;      // RS_REASON_* (results.h), why not DD_OK
+    uint64_t m_receivedMs;
+    int32_t m_txUs;
+    int32_t m_ackUs;
+} dd_result;
+
+// the result of request p_id, NULL if it has not run
+const dd_result* dd_find(const char* p_id);
+// request p_id ran, one past DD_ID_LEN is cut to it
+void dd_add(const char* p_id, const dd_result* p_result);
+void dd_clear(void);
+
+#endif // __dedup_h__
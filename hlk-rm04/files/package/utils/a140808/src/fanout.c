@@ -0,0 +1,228 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#include <string.h>  // memset
+
+#include "global.h"
+#include "fanout.h"
+#include "msg_proc.h"
+#include "regcache.h"
+
+
+typedef struct
+{
+    fo_deliver m_deliver;
+    void* m_ctx;
+    fo_policy m_policy;
+} fo_subscriber;
+
+typedef struct
+{
+    uint8_t m_subscriber;
+    uint8_t m_board;
+    uint8_t m_register;
+    bool m_sent;            // m_sentValue went out, the first event goes out at once
+    uint8_t m_sentValue;
+    bool m_pending;         // m_pendingValue waits for the policy
+    uint8_t m_pendingValue;
+    uint64_t m_pendingSince;
+    uint64_t m_lastSent;
+} fo_subscription;
+
+static fo_subscriber s_subscribers[FO_MAX_SUBSCRIBERS];
+static uint8_t s_subscriberCount = 0;
+static fo_subscription s_subs[FO_MAX_SUBSCRIPTIONS];
+static uint8_t s_subCount = 0;
+
+
+////////////////////////////////////////
+static int find(const int p_subscriber, const uint8_t p_board, const uint8_t p_registerAddress)
+{
+    for(uint8_t i=0; i<s_subCount; ++i)
+    {
+        if((s_subs[i].m_board == p_board) && (s_subs[i].m_register == p_registerAddress) &&
+           ((p_subscriber < 0) || (s_subs[i].m_subscriber == p_subscriber)))
+        {
+            return(i);
+        }
+    }
+    return(-1);
+}
+
+////////////////////////////////////////
+// the pending value when the policy lets it go and the consumer takes it
+static void try_send(fo_subscription* p_sub, const uint64_t p_now)
+{
+    if(!p_sub->m_pending)
+    {
+        return;
+    }
+    const fo_subscriber* psubscriber = &s_subscribers[p_sub->m_subscriber];
+    if(p_sub->m_sent)
+    {
+        const uint64_t due = max((p_sub->m_pendingSince + psubscriber->m_policy.m_coalesceMs), (p_sub->m_lastSent + psubscriber->m_policy.m_minIntervalMs));
+        if(p_now < due)
+        {
+            return;
+        }
+    }
+    if(psubscriber->m_deliver(psubscriber->m_ctx, p_sub->m_board, p_sub->m_register, p_sub->m_pendingValue, false))
+    {
+        p_sub->m_sent = true;
+        p_sub->m_sentValue = p_sub->m_pendingValue;
+        p_sub->m_pending = false;
+        p_sub->m_lastSent = p_now;
+    }
+}
+
+////////////////////////////////////////
+// a new value, a change undone before it went out is not sent
+static void offer(fo_subscription* p_sub, const uint8_t p_value, const uint64_t p_now)
+{
+    const uint8_t mask = s_subscribers[p_sub->m_subscriber].m_policy.m_mask;
+    if(p_sub->m_sent && (0 == ((p_value ^ p_sub->m_sentValue) & mask)))
+    {
+        p_sub->m_pending = false;
+        return;
+    }
+    if(!p_sub->m_pending)
+    {
+        p_sub->m_pending = true;
+        p_sub->m_pendingSince = p_now;
+    }
+    p_sub->m_pendingValue = p_value;
+    try_send(p_sub, p_now);
+}
+
+////////////////////////////////////////
+static void subscribe_board(const uint8_t p_board, const uint8_t p_registerAddress, const bool p_cancel)
+{
+    mp_select(p_board);
+    if(!mp_dispatch_subscribe_register(p_registerAddress, 0, p_cancel))
+    {
+        log_err("fanout: subscribe failed - board: [0x%02x] register: [0x%02x] cancel: [%d]", p_board, p_registerAddress, p_cancel);
+    }
+}
+
+
+////////////////////////////////////////
+int fo_add(fo_deliver p_deliver, void* p_ctx, const fo_policy* p_policy)
+{
+    if(FO_MAX_SUBSCRIBERS == s_subscriberCount)
+    {
+        log_err("fo_add: more than [%d] subscribers", FO_MAX_SUBSCRIBERS);
+        return(-1);
+    }
+    fo_subscriber* psubscriber = &s_subscribers[s_subscriberCount];
+    psubscriber->m_deliver = p_deliver;
+    psubscriber->m_ctx = p_ctx;
+    psubscriber->m_policy = *p_policy;
+    return(s_subscriberCount++);
+}
+
+////////////////////////////////////////
+void fo_set_policy(const int p_subscriber, const fo_policy* p_policy)
+{
+    s_subscribers[p_subscriber].m_policy = *p_policy;
+}
+
+////////////////////////////////////////
+bool fo_subscribe(const int p_subscriber, const uint8_t p_board, const uint8_t p_registerAddress)
+{
+    if(find(p_subscriber, p_board, p_registerAddress) >= 0)
+    {
+        return(true);
+    }
+    if(FO_MAX_SUBSCRIPTIONS == s_subCount)
+    {
+        log_warn("fo_subscribe: more than [%d] subscriptions, board: [0x%02x] register: [0x%02x]", FO_MAX_SUBSCRIPTIONS, p_board, p_registerAddress);
+        return(false);
+    }
+    const bool first = (find(-1, p_board, p_registerAddress) < 0);
+
+    fo_subscription* psub = &s_subs[s_subCount++];
+    memset(psub, 0, sizeof(*psub));
+    psub->m_subscriber = (uint8_t)p_subscriber;
+    psub->m_board = p_board;
+    psub->m_register = p_registerAddress;
+
+    uint8_t value;
+    uint32_t ageMs;
+    if(rc_get(p_board, p_registerAddress, &value, &ageMs))
+    {
+        offer(psub, value, mono_ms_now());
+    }
+    else if(first && !rc_is_watched(p_registerAddress))
+    {
+        subscribe_board(p_board, p_registerAddress, false);  // its answer has the value
+    }
+    return(true);
+}
+
+////////////////////////////////////////
+void fo_unsubscribe(const int p_subscriber, const uint8_t p_board, const uint8_t p_registerAddress)
+{
+    const int i = find(p_subscriber, p_board, p_registerAddress);
+    if(i < 0)
+    {
+        return;
+    }
+    s_subs[i] = s_subs[--s_subCount];
+    if((find(-1, p_board, p_registerAddress) < 0) && !rc_is_watched(p_registerAddress))
+    {
+        subscribe_board(p_board, p_registerAddress, true);  // the last one
+    }
+}
+
+////////////////////////////////////////
+void fo_publish(const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
+{
+    const uint64_t now = mono_ms_now();
+    uint8_t i = 0;
+    while(i < s_subCount)
+    {
+        fo_subscription* psub = &s_subs[i];
+        if((psub->m_board != p_board) || (psub->m_register != p_registerAddress))
+        {
+            ++i;
+        }
+        else if(p_cancel)
+        {
+            // the board ended it, gone for all of them
+            const fo_subscriber* psubscriber = &s_subscribers[psub->m_subscriber];
+            psubscriber->m_deliver(psubscriber->m_ctx, p_board, p_registerAddress, 0, true);
+            s_subs[i] = s_subs[--s_subCount];
+        }
+        else
+        {
+            offer(psub, p_value, now);
+            ++i;
+        }
+    }
+}
+
+////////////////////////////////////////
+void fo_poll(void)
+{
+    const uint64_t now = mono_ms_now();
+    for(uint8_t i=0; i<s_subCount; ++i)
+    {
+        try_send(&s_subs[i], now);
+    }
+}
@@ -0,0 +1,67 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __fanout_h__
+#define __fanout_h__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// register change events to many consumers (the cloud, a lan client, a
+// rules engine) over one board subscription per register
+//
+// the first subscriber to a register subscribes the board and the last one
+// to leave cancels it, the registers the cache watches (regcache.h) stay
+// subscribed. each subscriber has its own policy:
+//   m_mask           the bits it cares about, a change to the others is not sent
+//   m_minIntervalMs  at most one event per interval
+//   m_coalesceMs     how long a change waits for more to go out with it
+// an event held back by the policy is pending, and a later change replaces
+// its value, so a consumer that cannot keep up gets the latest value and
+// never holds up the others
+//
+
+#define FO_MAX_SUBSCRIBERS    4
+#define FO_MAX_SUBSCRIPTIONS  32
+
+typedef struct
+{
+    uint8_t m_mask;
+    uint32_t m_minIntervalMs;
+    uint32_t m_coalesceMs;
+} fo_policy;
+
+// an event to a consumer, false when it cannot take it yet (it stays pending).
+// p_cancel: the board ended the subscription
+typedef bool (*fo_deliver)(void* p_ctx, const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel);
+
+// the subscriber id, -1 when there is no room
+int fo_add(fo_deliver p_deliver, void* p_ctx, const fo_policy* p_policy);
+void fo_set_policy(const int p_subscriber, const fo_policy* p_policy);
+
+// a new subscription gets the register's value at once when the cache has it
+bool fo_subscribe(const int p_subscriber, const uint8_t p_board, const uint8_t p_registerAddress);
+void fo_unsubscribe(const int p_subscriber, const uint8_t p_board, const uint8_t p_registerAddress);
+
+// from mp_on_subscribe_register
+void fo_publish(const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel);
+// the pending events that are due, from the worker loop
+void fo_poll(void);
+
+#endif // __fanout_h__
@@ -0,0 +1,655 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// a140808-fwup: atmega32 firmware update through the serial bootloader
+//
+//   a140808-fwup [-d device] [-a board] [-b baud] [-w window] [-n] image.hex|image.bin
+//
+//   -d  serial device (default: SERIAL_PORT)
+//   -a  board address on a multi-drop bus (default: point to point)
+//   -b  highest rate to negotiate (default: 1000000)
+//   -w  pages in flight (default: the bootloader's slots)
+//   -n  the bootloader is already running, do not ask the application
+//
+// the daemon owns the serial port, stop it first: /etc/init.d/a140808 stop
+//
+// the application is asked to reset into the bootloader (REG_BOOT_REQUEST),
+// the fastest rate both ends agree on is negotiated and the image is
+// streamed as crc protected pages with up to a window of them in flight.
+// pages are acknowledged in order once programmed, a nak or a timeout
+// resends from the oldest unacknowledged page. the bootloader then checks
+// the crc32 of the whole image in flash instead of it being read back.
+// protocol: avr/src/boot_defs.h
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "global.h"
+#include "boot_defs.h"
+#include "msg_proc.h"
+#include "serial.h"
+
+#define HELLO_TRIES      10
+#define REPLY_MS         200
+#define PAGE_ACK_MS      1000
+#define VERIFY_MS        3000
+#define PAGE_RETRIES     5
+#define DEFAULT_BAUD     1000000
+
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t len;
+    uint8_t payload[BOOT_PAYLOAD_MAX];
+} BootFrame;
+
+// candidate rates, fastest first
+static const uint32_t s_rates[] = { 1000000, 500000, 250000, 115200 };
+
+static int s_fd = -1;
+static uint8_t s_in[256];
+static size_t s_inLen = 0;
+static size_t s_inPos = 0;
+
+static uint8_t s_image[BOOT_START];
+static uint32_t s_imageLen = 0;
+
+
+// the engine's events, nothing to do with them here (see msg_proc.h)
+void mp_on_pong(const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3) { }
+void mp_on_read_register(const uint8_t p_registerAddress) { }
+void mp_on_write_register(const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask) { }
+void mp_on_write_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state) { }
+void mp_on_pulse_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs) { }
+void mp_on_subscribe_register(const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel) { }
+void mp_on_ack(const uint8_t p_type, const uint8_t p_registerAddress, const uint8_t p_status) { }
+void mp_on_sent(const uint32_t p_tag, const bool p_acked) { }
+
+
+////////////////////////////////////////
+static uint16_t update_crc16(uint16_t p_crc, const uint8_t p_ch)
+{
+    p_crc ^= p_ch;
+    for(int i=0; i<8; ++i)
+    {
+        p_crc = ((p_crc & 0x0001) ? ((p_crc >> 1) ^ 0xa001) : (p_crc >> 1));
+    }
+    return(p_crc);
+}
+
+////////////////////////////////////////
+// crc32 (ieee 802.3, reflected), same as the bootloader's
+static uint32_t crc32(const uint8_t* p_buf, const size_t p_len)
+{
+    uint32_t crc = 0xffffffff;
+    for(size_t i=0; i<p_len; ++i)
+    {
+        crc ^= p_buf[i];
+        for(int j=0; j<8; ++j)
+        {
+            crc = ((crc & 1) ? ((crc >> 1) ^ 0xedb88320) : (crc >> 1));
+        }
+    }
+    return(~crc);
+}
+
+////////////////////////////////////////
+static void put_le(uint8_t* p_buf, const uint32_t p_val, const int p_bytes)
+{
+    for(int i=0; i<p_bytes; ++i)
+    {
+        p_buf[i] = ((p_val >> (8 * i)) & 0xff);
+    }
+}
+
+////////////////////////////////////////
+static uint32_t get_le(const uint8_t* p_buf, const int p_bytes)
+{
+    uint32_t val = 0;
+    for(int i=(p_bytes - 1); i>=0; --i)
+    {
+        val = ((val << 8) | p_buf[i]);
+    }
+    return(val);
+}
+
+
+////////////////////////////////////////
+static bool send_frame(const uint8_t p_cmd, const uint8_t* p_payload, const uint8_t p_len)
+{
+    uint8_t buf[BOOT_PAYLOAD_MAX + 5];
+    uint16_t crc = 0xffff;
+    buf[0] = BOOT_SYNC;
+    buf[1] = p_cmd;
+    buf[2] = p_len;
+    memcpy(&buf[3], p_payload, p_len);
+    for(int i=1; i<(3 + p_len); ++i)
+    {
+        crc = update_crc16(crc, buf[i]);
+    }
+    buf[3 + p_len] = (crc & 0xff);
+    buf[4 + p_len] = (crc >> 8);
+    return(sp_write(s_fd, buf, (p_len + 5)));
+}
+
+////////////////////////////////////////
+// next received byte, -1 once p_deadline (date_ms_now) has passed
+static int read_byte(const uint64_t p_deadline)
+{
+    while(s_inPos >= s_inLen)
+    {
+        s_inPos = 0;
+        s_inLen = 0;
+        const uint64_t now = date_ms_now();
+        if(now >= p_deadline)
+        {
+            return(-1);
+        }
+        struct pollfd pfd = { s_fd, POLLIN, 0 };
+        if(poll(&pfd, 1, (int)(p_deadline - now)) <= 0)
+        {
+            continue;
+        }
+        const ssize_t len = sp_read(s_fd, s_in, sizeof(s_in));
+        if(len < 0)
+        {
+            return(-1);
+        }
+        s_inLen = len;
+    }
+    return(s_in[s_inPos++]);
+}
+
+////////////////////////////////////////
+// the next reply with a good crc, false on timeout
+static bool read_frame(BootFrame* p_frame, const int p_timeoutMs)
+{
+    const uint64_t deadline = (date_ms_now() + p_timeoutMs);
+    for(;;)
+    {
+        int val;
+        do
+        {
+            if((val = read_byte(deadline)) < 0)
+            {
+                return(false);
+            }
+        } while(BOOT_SYNC != val);
+
+        int cmd = read_byte(deadline);
+        int len = read_byte(deadline);
+        if((cmd < 0) || (len < 0))
+        {
+            return(false);
+        }
+        if(len > BOOT_PAYLOAD_MAX)
+        {
+            continue;  // not a frame, resync
+        }
+        uint16_t crc = update_crc16(update_crc16(0xffff, cmd), len);
+        for(int i=0; i<len; ++i)
+        {
+            if((val = read_byte(deadline)) < 0)
+            {
+                return(false);
+            }
+            p_frame->payload[i] = val;
+            crc = update_crc16(crc, val);
+        }
+        const int lo = read_byte(deadline);
+        const int hi = read_byte(deadline);
+        if((lo < 0) || (hi < 0))
+        {
+            return(false);
+        }
+        if((crc == (lo | (hi << 8))) && (0 != (cmd & BOOT_REPLY)) && (len > 0))
+        {
+            p_frame->cmd = (cmd & ~BOOT_REPLY);
+            p_frame->len = len;
+            return(true);
+        }
+    }
+}
+
+////////////////////////////////////////
+// send a command and wait for its reply, the payload starts with the status
+static bool transact(const uint8_t p_cmd, const uint8_t* p_payload, const uint8_t p_len, BootFrame* p_reply, const int p_timeoutMs)
+{
+    if(!send_frame(p_cmd, p_payload, p_len))
+    {
+        return(false);
+    }
+    const uint64_t deadline = (date_ms_now() + p_timeoutMs);
+    uint64_t now;
+    while((now = date_ms_now()) < deadline)
+    {
+        if(!read_frame(p_reply, (int)(deadline - now)))
+        {
+            return(false);
+        }
+        if(p_cmd == p_reply->cmd)
+        {
+            return(true);
+        }
+    }
+    return(false);
+}
+
+////////////////////////////////////////
+static bool hello(BootFrame* p_reply, const int p_tries)
+{
+    for(int i=0; i<p_tries; ++i)
+    {
+        if(transact(BOOT_CMD_HELLO, NULL, 0, p_reply, REPLY_MS) && (p_reply->len >= 7) && (BOOT_OK == p_reply->payload[0]))
+        {
+            return(true);
+        }
+    }
+    return(false);
+}
+
+
+////////////////////////////////////////
+static int hex_byte(const char* p_str)
+{
+    char buf[3] = { p_str[0], p_str[1], '\0' };
+    char* end;
+    const long val = strtol(buf, &end, 16);
+    return(('\0' == *end) ? (int)val : -1);
+}
+
+////////////////////////////////////////
+// intel hex: data, end of file and the segment/linear address records
+static bool load_hex(FILE* p_file, const char* p_path)
+{
+    char line[600];
+    uint32_t base = 0;
+    int lineNum = 0;
+    while(fgets(line, sizeof(line), p_file))
+    {
+        ++lineNum;
+        if(':' != line[0])
+        {
+            continue;
+        }
+        uint8_t rec[256 + 5];
+        const int count = hex_byte(&line[1]);
+        if(count < 0)
+        {
+            fprintf(stderr, "%s:%d: bad record\n", p_path, lineNum);
+            return(false);
+        }
+        uint8_t sum = 0;
+        for(int i=0; i<(count + 5); ++i)
+        {
+            const int val = hex_byte(&line[1 + (2 * i)]);
+            if(val < 0)
+            {
+                fprintf(stderr, "%s:%d: bad record\n", p_path, lineNum);
+                return(false);
+            }
+            rec[i] = val;
+            sum += val;
+        }
+        if(0 != sum)
+        {
+            fprintf(stderr, "%s:%d: checksum mismatch\n", p_path, lineNum);
+            return(false);
+        }
+
+        const uint32_t addr = (base + ((rec[1] << 8) | rec[2]));
+        switch(rec[3])
+        {
+            case 0x00:  // data
+                if((addr + count) > BOOT_START)
+                {
+                    fprintf(stderr, "%s:%d: data at 0x%x is beyond the application section (0x%x)\n", p_path, lineNum, addr, BOOT_START);
+                    return(false);
+                }
+                memcpy(&s_image[addr], &rec[4], count);
+                s_imageLen = max(s_imageLen, (addr + count));
+                break;
+            case 0x01:  // end of file
+                return(true);
+            case 0x02:  // extended segment address
+                base = (((rec[4] << 8) | rec[5]) << 4);
+                break;
+            case 0x04:  // extended linear address
+                base = (((rec[4] << 8) | rec[5]) << 16);
+                break;
+            default:    // start address records
+                break;
+        }
+    }
+    return(true);
+}
+
+////////////////////////////////////////
+// raw binary, ex: bin/a140808.bin which is padded with 0xff to the end of flash
+static bool load_bin(FILE* p_file, const char* p_path)
+{
+    s_imageLen = fread(s_image, 1, sizeof(s_image), p_file);
+    int ch;
+    while(EOF != (ch = fgetc(p_file)))
+    {
+        if(0xff != ch)
+        {
+            fprintf(stderr, "%s: data beyond the application section (0x%x)\n", p_path, BOOT_START);
+            return(false);
+        }
+    }
+    // erased flash need not be sent
+    while((s_imageLen > 0) && (0xff == s_image[s_imageLen - 1]))
+    {
+        --s_imageLen;
+    }
+    return(true);
+}
+
+////////////////////////////////////////
+static bool load_image(const char* p_path)
+{
+    FILE* file = fopen(p_path, "rb");
+    if(!file)
+    {
+        perror(p_path);
+        return(false);
+    }
+    memset(s_image, 0xff, sizeof(s_image));
+    s_imageLen = 0;
+
+    const int first = fgetc(file);
+    ungetc(first, file);
+    const bool ok = ((':' == first) ? load_hex(file, p_path) : load_bin(file, p_path));
+    fclose(file);
+
+    if(ok && (0 == s_imageLen))
+    {
+        fprintf(stderr, "%s: empty image\n", p_path);
+        return(false);
+    }
+    return(ok);
+}
+
+
+////////////////////////////////////////
+// ask the application to reset into the bootloader, over the normal protocol
+static bool request_bootloader(const char* p_device, const uint8_t p_board)
+{
+    if(!mp_init(p_device, SERIAL_BAUD, SERIAL_USE_E71))
+    {
+        return(false);
+    }
+    mp_select(p_board);
+    const bool ok = mp_dispatch_write_register(REG_BOOT_REQUEST, BOOT_REQUEST_KEY, 0xff);
+    mp_close();
+    sleep_ms(100);  // watchdog reset
+    return(ok);
+}
+
+////////////////////////////////////////
+// the fastest rate up to p_maxBaud that both ends can do, BOOT_BAUD otherwise
+static uint32_t negotiate_baud(const uint32_t p_maxBaud)
+{
+    BootFrame reply;
+    for(size_t i=0; i<(sizeof(s_rates) / sizeof(s_rates[0])); ++i)
+    {
+        const uint32_t baud = s_rates[i];
+        if((baud > p_maxBaud) || (baud <= BOOT_BAUD) || !sp_baud_supported(baud))
+        {
+            continue;
+        }
+
+        uint8_t payload[4];
+        put_le(payload, baud, 4);
+        if(!transact(BOOT_CMD_BAUD, payload, sizeof(payload), &reply, REPLY_MS) || (BOOT_OK != reply.payload[0]))
+        {
+            continue;  // refused at this clock
+        }
+
+        // the bootloader has switched once its reply was out
+        sp_set_baud(s_fd, baud, false);
+        s_inLen = s_inPos = 0;
+        if(hello(&reply, 3))
+        {
+            return(baud);
+        }
+
+        // the link does not work at this rate, wait for the bootloader to fall back
+        sp_set_baud(s_fd, BOOT_BAUD, false);
+        sleep_ms(BOOT_BAUD_CONFIRM_MS + 200);
+        if(!hello(&reply, HELLO_TRIES))
+        {
+            return(0);
+        }
+    }
+    return(BOOT_BAUD);
+}
+
+////////////////////////////////////////
+static bool send_page(const uint32_t p_page)
+{
+    uint8_t payload[BOOT_PAYLOAD_MAX];
+    const uint32_t addr = (p_page * BOOT_PAGE_SIZE);
+    put_le(payload, addr, 2);
+    memcpy(&payload[2], &s_image[addr], BOOT_PAGE_SIZE);
+    return(send_frame(BOOT_CMD_PAGE, payload, sizeof(payload)));
+}
+
+////////////////////////////////////////
+// process acks until the link is quiet, returns the new oldest unacked page
+static uint32_t drain(uint32_t p_acked)
+{
+    BootFrame reply;
+    while(read_frame(&reply, REPLY_MS))
+    {
+        if((BOOT_CMD_PAGE == reply.cmd) && (reply.len >= 3) && (BOOT_OK == reply.payload[0]) &&
+           (get_le(&reply.payload[1], 2) == (p_acked * BOOT_PAGE_SIZE)))
+        {
+            ++p_acked;
+        }
+    }
+    return(p_acked);
+}
+
+////////////////////////////////////////
+// pipelined page transfer, go-back-n on a nak or timeout
+static bool send_pages(const uint32_t p_window)
+{
+    const uint32_t pages = ((s_imageLen + BOOT_PAGE_SIZE - 1) / BOOT_PAGE_SIZE);
+    uint32_t next = 0;   // next page to send
+    uint32_t acked = 0;  // oldest page not yet acknowledged
+    int retries = 0;
+    const bool tty = isatty(STDOUT_FILENO);
+
+    while(acked < pages)
+    {
+        while((next < pages) && ((next - acked) < p_window))
+        {
+            if(!send_page(next++))
+            {
+                return(false);
+            }
+        }
+
+        BootFrame reply;
+        bool resend = true;
+        if(read_frame(&reply, PAGE_ACK_MS) && (BOOT_CMD_PAGE == reply.cmd) && (reply.len >= 3))
+        {
+            const uint32_t addr = get_le(&reply.payload[1], 2);
+            if((BOOT_OK == reply.payload[0]) && (addr == (acked * BOOT_PAGE_SIZE)))
+            {
+                ++acked;
+                retries = 0;
+                resend = false;
+                if(tty && ((0 == (acked % 8)) || (acked == pages)))
+                {
+                    printf("\r%u/%u pages", acked, pages);
+                    fflush(stdout);
+                }
+            }
+            else if((BOOT_OK == reply.payload[0]) && (addr < (acked * BOOT_PAGE_SIZE)))
+            {
+                resend = false;  // a duplicate from an earlier resend
+            }
+            else if(BOOT_E_ADDR == reply.payload[0])
+            {
+                fprintf(stderr, "\nbootloader refused page 0x%04x\n", addr);
+                return(false);
+            }
+        }
+
+        if(resend)
+        {
+            if(++retries > PAGE_RETRIES)
+            {
+                fprintf(stderr, "\nno progress at page %u of %u\n", acked, pages);
+                return(false);
+            }
+            // let the bootloader finish what it has, then go back
+            acked = drain(acked);
+            next = acked;
+        }
+    }
+    if(tty)
+    {
+        printf("\n");
+    }
+    return(true);
+}
+
+////////////////////////////////////////
+static void usage(const char* p_name)
+{
+    fprintf(stderr, "usage: %s [-d device] [-a board] [-b baud] [-w window] [-n] image.hex|image.bin\n", p_name);
+}
+
+////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    const char* device = SERIAL_PORT;
+    uint8_t board = BUS_ADDRESS_NONE;
+    uint32_t maxBaud = DEFAULT_BAUD;
+    uint32_t window = 0;
+    bool request = true;
+    int opt;
+    while(-1 != (opt = getopt(argc, argv, "d:a:b:w:nh")))
+    {
+        switch(opt)
+        {
+            case 'd': device = optarg;                 break;
+            case 'a': board = str2num(optarg, 0);      break;
+            case 'b': maxBaud = str2num(optarg, 10);   break;
+            case 'w': window = str2num(optarg, 10);    break;
+            case 'n': request = false;                 break;
+            default:
+            {
+                usage(argv[0]);
+                return(1);
+            }
+        }
+    }
+    if((optind + 1) != argc)
+    {
+        usage(argv[0]);
+        return(1);
+    }
+    if(!load_image(argv[optind]))
+    {
+        return(1);
+    }
+    const uint32_t imageCrc = crc32(s_image, s_imageLen);
+    printf("%s: %u bytes, crc32 %08x\n", argv[optind], s_imageLen, imageCrc);
+
+    if(request && !request_bootloader(device, board))
+    {
+        fprintf(stderr, "%s: could not ask the application for the bootloader\n", device);
+        return(1);
+    }
+
+    s_fd = sp_open(device, BOOT_BAUD, false);
+    if(s_fd < 0)
+    {
+        fprintf(stderr, "%s: open failed\n", device);
+        return(1);
+    }
+
+    BootFrame reply;
+    if(!hello(&reply, HELLO_TRIES))
+    {
+        fprintf(stderr, "no answer from the bootloader\n");
+        sp_close(s_fd);
+        return(1);
+    }
+    const uint16_t pageSize = get_le(&reply.payload[2], 2);
+    const uint16_t appSize = get_le(&reply.payload[4], 2);
+    const uint8_t slots = reply.payload[6];
+    if((BOOT_PAGE_SIZE != pageSize) || (s_imageLen > appSize))
+    {
+        fprintf(stderr, "bootloader v%u: %u byte pages, %u byte application, the image does not fit\n", reply.payload[1], pageSize, appSize);
+        sp_close(s_fd);
+        return(1);
+    }
+    if((0 == window) || (window > slots))
+    {
+        window = slots;
+    }
+
+    const uint32_t baud = negotiate_baud(maxBaud);
+    if(0 == baud)
+    {
+        fprintf(stderr, "lost the bootloader while changing rates\n");
+        sp_close(s_fd);
+        return(1);
+    }
+    printf("bootloader v%u at %u baud, %u pages in flight\n", reply.payload[1], baud, window);
+
+    const uint64_t start = date_ms_now();
+    if(!send_pages(window))
+    {
+        sp_close(s_fd);
+        return(1);
+    }
+    const uint64_t elapsed = max((date_ms_now() - start), (uint64_t)1);
+
+    uint8_t payload[6];
+    put_le(payload, s_imageLen, 2);
+    put_le(&payload[2], imageCrc, 4);
+    if(!transact(BOOT_CMD_VERIFY, payload, sizeof(payload), &reply, VERIFY_MS) || (reply.len < 5))
+    {
+        fprintf(stderr, "no verify reply\n");
+        sp_close(s_fd);
+        return(1);
+    }
+    if(BOOT_OK != reply.payload[0])
+    {
+        fprintf(stderr, "verify failed: flash crc32 %08x, image %08x\n", get_le(&reply.payload[1], 4), imageCrc);
+        sp_close(s_fd);
+        return(1);
+    }
+    printf("%u bytes in %u ms (%u bytes/s), crc32 verified\n", s_imageLen, (uint32_t)elapsed, (uint32_t)((s_imageLen * 1000ULL) / elapsed));
+
+    transact(BOOT_CMD_RUN, NULL, 0, &reply, REPLY_MS);
+    sp_close(s_fd);
+    return(0);
+}
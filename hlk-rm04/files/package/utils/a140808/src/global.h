@@ -26,6 +26,16 @@
 #define SERIAL_PORT     "/dev/ttyS1"
 #define SERIAL_BAUD     57600
 #define SERIAL_USE_E71  true
+#define SERIAL_RELIABLE true                      // acked relay commands, see mp_set_reliable()
+#define BUS_CONFIG      "/etc/config/a140808bus"  // board addresses on a multi-drop bus
+#define WORKER_WAIT_MS  50                        // longest worker loop sleep
+#define LINK_HEALTH_MS  1000                      // avr link health ping interval, 0 turns it off (link_probe.h)
+#define JOURNAL_FILE    "/tmp/" PROGNAME ".journal"  // events kept while offline, on tmpfs (journal.h)
+#define JOURNAL_SIZE    (64 * 1024)
+#define SCHEDULE_FILE   "/tmp/" PROGNAME ".schedule"  // jobs for scheduleAt/scheduleIn (schedule.h)
+#define SCHEDULE_LATE_MS 60000                    // a job later than that is dropped, after a restart
+#define PROTOCOL_VERSION 1                        // of the websocket messages, in the hello snapshot
+#define TRACE_FILE      "/tmp/" PROGNAME ".trace.json"  // the last commands' latency on SIGUSR1 (trace.h)
 
 #define DEBUG
 //#define DEBUG_TRACE
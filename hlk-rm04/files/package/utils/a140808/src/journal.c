@@ -0,0 +1,259 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#include <string.h>  // memcpy
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "global.h"
+#include "journal.h"
+
+
+#define JR_MAGIC  0x4a523031  // JR01
+#define JR_WRAP   0xffff      // m_len of the marker where the records go back to the start
+#define JR_ALIGN(n)  (((n) + 7) & ~7)
+
+typedef struct
+{
+    uint32_t m_magic;
+    uint32_t m_size;     // of the record area after the header
+    uint32_t m_head;     // offset of the oldest record
+    uint32_t m_tail;     // offset of the next one
+    uint32_t m_count;    // records from m_head, consecutive sequence numbers
+    uint32_t m_nextSeq;
+    uint32_t m_acked;
+} jr_header;
+
+typedef struct
+{
+    uint16_t m_len;
+    uint16_t m_reserved;
+    uint32_t m_seq;
+} jr_record;
+
+static jr_header* s_header = NULL;
+static uint8_t* s_records = NULL;
+static size_t s_mapLen = 0;
+
+// where the last jr_next() left off, a replay reads on from there
+static uint32_t s_iterSeq = 0;
+static uint32_t s_iterOffset = 0;
+
+
+////////////////////////////////////////
+static jr_record* record_at(uint32_t* p_offset)
+{
+    if((*p_offset >= s_header->m_size) || (JR_WRAP == ((jr_record*)&s_records[*p_offset])->m_len))
+    {
+        *p_offset = 0;
+    }
+    return((jr_record*)&s_records[*p_offset]);
+}
+
+////////////////////////////////////////
+static void drop_oldest(void)
+{
+    jr_record* prec = record_at(&s_header->m_head);
+    s_header->m_head += JR_ALIGN(sizeof(jr_record) + prec->m_len);
+    if(0 == --s_header->m_count)
+    {
+        s_header->m_head = 0;
+        s_header->m_tail = 0;
+    }
+    s_iterSeq = 0;
+}
+
+////////////////////////////////////////
+// the header has to describe a ring that fits the records
+static bool valid(const uint32_t p_size)
+{
+    return((JR_MAGIC == s_header->m_magic) && (p_size == s_header->m_size) &&
+           (s_header->m_head <= p_size) && (s_header->m_tail <= p_size) &&
+           (s_header->m_count <= (p_size / JR_ALIGN(sizeof(jr_record)))) &&
+           (s_header->m_count < s_header->m_nextSeq) && (s_header->m_acked < s_header->m_nextSeq));
+}
+
+
+////////////////////////////////////////
+bool jr_open(const char* p_path, const uint32_t p_size)
+{
+    const int fd = open(p_path, (O_RDWR | O_CREAT), 0600);
+    if(fd < 0)
+    {
+        log_err("jr_open: [%s], err: [%s]", p_path, strerror(errno));
+        return(false);
+    }
+    const uint32_t size = (p_size & ~7);
+    s_mapLen = (sizeof(jr_header) + size);
+    if(0 != ftruncate(fd, s_mapLen))
+    {
+        log_err("jr_open: ftruncate [%s], err: [%s]", p_path, strerror(errno));
+        close(fd);
+        return(false);
+    }
+    void* pmap = mmap(NULL, s_mapLen, (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+    close(fd);
+    if(MAP_FAILED == pmap)
+    {
+        log_err("jr_open: mmap [%s], err: [%s]", p_path, strerror(errno));
+        return(false);
+    }
+    s_header = (jr_header*)pmap;
+    s_records = ((uint8_t*)pmap + sizeof(jr_header));
+    s_iterSeq = 0;
+
+    if(!valid(size))
+    {
+        if(0 != s_header->m_magic)
+        {
+            log_warn("jr_open: [%s] not a journal of [%u] bytes, starting over", p_path, size);
+        }
+        memset(s_header, 0, sizeof(jr_header));
+        s_header->m_magic = JR_MAGIC;
+        s_header->m_size = size;
+        s_header->m_nextSeq = 1;
+    }
+    log_notice("jr_open: [%s] records: [%u] next: [%u] acked: [%u]", p_path, s_header->m_count, s_header->m_nextSeq, s_header->m_acked);
+    return(true);
+}
+
+////////////////////////////////////////
+void jr_close(void)
+{
+    if(NULL != s_header)
+    {
+        munmap(s_header, s_mapLen);
+        s_header = NULL;
+        s_records = NULL;
+    }
+}
+
+////////////////////////////////////////
+uint32_t jr_append(const char* p_data, const uint16_t p_len)
+{
+    if((NULL == s_header) || (p_len > JR_RECORD_MAX))
+    {
+        return(0);
+    }
+
+    // room at the tail, or from the start when the end is too short
+    const uint32_t need = JR_ALIGN(sizeof(jr_record) + p_len);
+    uint32_t at;
+    for(;;)
+    {
+        if(0 == s_header->m_count)
+        {
+            at = 0;
+            break;
+        }
+        if(s_header->m_tail > s_header->m_head)
+        {
+            if((s_header->m_tail + need) <= s_header->m_size)
+            {
+                at = s_header->m_tail;
+                break;
+            }
+            if(need <= s_header->m_head)
+            {
+                at = 0;
+                break;
+            }
+        }
+        else if((s_header->m_tail + need) <= s_header->m_head)
+        {
+            at = s_header->m_tail;
+            break;
+        }
+        log_debug("jr_append: full, seq [%u] dropped", (s_header->m_nextSeq - s_header->m_count));
+        drop_oldest();
+    }
+
+    // the record first, the header takes it in after
+    jr_record* prec = (jr_record*)&s_records[at];
+    prec->m_len = p_len;
+    prec->m_reserved = 0;
+    prec->m_seq = s_header->m_nextSeq;
+    memcpy(&prec[1], p_data, p_len);
+    if((at < s_header->m_tail) && (s_header->m_tail < s_header->m_size))
+    {
+        ((jr_record*)&s_records[s_header->m_tail])->m_len = JR_WRAP;
+    }
+    s_header->m_tail = (at + need);
+    ++s_header->m_count;
+    return(s_header->m_nextSeq++);
+}
+
+////////////////////////////////////////
+const char* jr_next(const uint32_t p_seq, uint32_t* p_recordSeq, uint16_t* p_len)
+{
+    if((NULL == s_header) || (0 == s_header->m_count) || (p_seq >= (s_header->m_nextSeq - 1)))
+    {
+        return(NULL);
+    }
+    const uint32_t firstSeq = (s_header->m_nextSeq - s_header->m_count);
+    uint32_t seq = firstSeq;
+    uint32_t offset = s_header->m_head;
+    if((0 != s_iterSeq) && (p_seq == s_iterSeq) && (p_seq >= firstSeq))
+    {
+        seq = (s_iterSeq + 1);
+        offset = s_iterOffset;
+    }
+    for(;;)
+    {
+        jr_record* prec = record_at(&offset);
+        offset += JR_ALIGN(sizeof(jr_record) + prec->m_len);
+        if(seq > p_seq)
+        {
+            s_iterSeq = seq;
+            s_iterOffset = offset;
+            *p_recordSeq = seq;
+            *p_len = prec->m_len;
+            return((const char*)&prec[1]);
+        }
+        ++seq;
+    }
+}
+
+////////////////////////////////////////
+void jr_ack(const uint32_t p_seq)
+{
+    if(NULL == s_header)
+    {
+        return;
+    }
+    const uint32_t seq = min(p_seq, (s_header->m_nextSeq - 1));
+    while((s_header->m_count > 0) && ((s_header->m_nextSeq - s_header->m_count) <= seq))
+    {
+        drop_oldest();
+    }
+    s_header->m_acked = max(s_header->m_acked, seq);
+}
+
+////////////////////////////////////////
+uint32_t jr_acked(void)
+{
+    return((NULL == s_header) ? 0 : s_header->m_acked);
+}
+
+////////////////////////////////////////
+uint32_t jr_last(void)
+{
+    return((NULL == s_header) ? 0 : (s_header->m_nextSeq - 1));
+}
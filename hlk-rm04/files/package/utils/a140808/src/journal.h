@@ -0,0 +1,51 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __journal_h__
+#define __journal_h__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// the events the cloud missed while the websocket was down, kept in a ring
+// file mapped into memory (on tmpfs, so it lasts a daemon restart but not a
+// reboot) until the server acknowledges them
+//
+// each record carries its length and a sequence number, the header the
+// ring's extent, written after the record it takes in, so a crash mid
+// append loses that record only. when full the oldest records make room
+//
+
+#define JR_RECORD_MAX  256  // the longest event
+
+// opens the journal at p_path, what is in it from before kept, false if it
+// cannot be mapped: jr_append() then drops the events
+bool jr_open(const char* p_path, const uint32_t p_size);
+void jr_close(void);
+
+// the event's sequence number, 0 when it is not kept
+uint32_t jr_append(const char* p_data, const uint16_t p_len);
+// the first record after sequence number p_seq, NULL past the last one
+const char* jr_next(const uint32_t p_seq, uint32_t* p_recordSeq, uint16_t* p_len);
+// the server has everything up to p_seq, those records are dropped
+void jr_ack(const uint32_t p_seq);
+uint32_t jr_acked(void);  // the highest sequence number acknowledged
+uint32_t jr_last(void);   // the highest one given out
+
+#endif // __journal_h__
@@ -0,0 +1,247 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its 
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including, 
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR 
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any 
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#include <string.h>  // strlen, memcpy
+
+#include "json_writer.h"
+
+
+////////////////////////////////////////
+static void put(struct json_writer* p_jw, const char* p_data, const size_t p_len)
+{
+    // one byte kept for jw_finish()'s nul
+    if(p_jw->m_overflow || ((p_jw->m_len + p_len) >= p_jw->m_capacity))
+    {
+        p_jw->m_overflow = true;
+        return;
+    }
+    memcpy(&p_jw->m_buf[p_jw->m_len], p_data, p_len);
+    p_jw->m_len += p_len;
+}
+
+////////////////////////////////////////
+static void put_char(struct json_writer* p_jw, const char p_ch)
+{
+    if(p_jw->m_overflow || ((p_jw->m_len + 1) >= p_jw->m_capacity))
+    {
+        p_jw->m_overflow = true;
+        return;
+    }
+    p_jw->m_buf[p_jw->m_len++] = p_ch;
+}
+
+////////////////////////////////////////
+// the comma in front of a value, unless it is the first or follows its key
+static void begin_value(struct json_writer* p_jw)
+{
+    const uint16_t bit = (1 << p_jw->m_depth);
+    if(p_jw->m_afterKey)
+    {
+        p_jw->m_afterKey = false;
+    }
+    else if(p_jw->m_hasValue & bit)
+    {
+        put_char(p_jw, ',');
+    }
+    p_jw->m_hasValue |= bit;
+}
+
+////////////////////////////////////////
+static void open_value(struct json_writer* p_jw, const char p_ch)
+{
+    begin_value(p_jw);
+    put_char(p_jw, p_ch);
+    if((JW_MAX_DEPTH - 1) == p_jw->m_depth)
+    {
+        p_jw->m_overflow = true;
+        return;
+    }
+    ++p_jw->m_depth;
+    p_jw->m_hasValue &= ~(1 << p_jw->m_depth);
+}
+
+////////////////////////////////////////
+static void close_value(struct json_writer* p_jw, const char p_ch)
+{
+    if(0 == p_jw->m_depth)
+    {
+        p_jw->m_overflow = true;
+        return;
+    }
+    --p_jw->m_depth;
+    put_char(p_jw, p_ch);
+}
+
+////////////////////////////////////////
+static void put_string(struct json_writer* p_jw, const char* p_str)
+{
+    static const char hex[] = "0123456789abcdef";
+    put_char(p_jw, '"');
+    const char* run = p_str;  // bytes that go out as they are
+    for(const char* pos=p_str; ; ++pos)
+    {
+        const unsigned char ch = *pos;
+        if((ch >= 0x20) && ('"' != ch) && ('\\' != ch))
+        {
+            continue;
+        }
+        put(p_jw, run, (pos - run));
+        run = (pos + 1);
+        if('\0' == ch)
+        {
+            break;
+        }
+
+        char esc[6] = { '\\', 0, '0', '0', 0, 0 };
+        switch(ch)
+        {
+            case '"':  esc[1] = '"';  break;
+            case '\\': esc[1] = '\\'; break;
+            case '\b': esc[1] = 'b';  break;
+            case '\f': esc[1] = 'f';  break;
+            case '\n': esc[1] = 'n';  break;
+            case '\r': esc[1] = 'r';  break;
+            case '\t': esc[1] = 't';  break;
+            default:
+                esc[1] = 'u';
+                esc[4] = hex[ch >> 4];
+                esc[5] = hex[ch & 0x0f];
+                put(p_jw, esc, 6);
+                continue;
+        }
+        put(p_jw, esc, 2);
+    }
+    put_char(p_jw, '"');
+}
+
+////////////////////////////////////////
+void jw_init(struct json_writer* p_jw, char* p_buf, const size_t p_capacity)
+{
+    p_jw->m_buf = p_buf;
+    p_jw->m_capacity = p_capacity;
+    p_jw->m_len = 0;
+    p_jw->m_overflow = (0 == p_capacity);
+    p_jw->m_depth = 0;
+    p_jw->m_hasValue = 0;
+    p_jw->m_afterKey = false;
+}
+
+////////////////////////////////////////
+void jw_object_begin(struct json_writer* p_jw)
+{
+    open_value(p_jw, '{');
+}
+
+////////////////////////////////////////
+void jw_object_end(struct json_writer* p_jw)
+{
+    close_value(p_jw, '}');
+}
+
+////////////////////////////////////////
+void jw_array_begin(struct json_writer* p_jw)
+{
+    open_value(p_jw, '[');
+}
+
+////////////////////////////////////////
+void jw_array_end(struct json_writer* p_jw)
+{
+    close_value(p_jw, ']');
+}
+
+////////////////////////////////////////
+void jw_key(struct json_writer* p_jw, const char* p_key)
+{
+    begin_value(p_jw);
+    put_string(p_jw, p_key);
+    put_char(p_jw, ':');
+    p_jw->m_afterKey = true;
+}
+
+////////////////////////////////////////
+void jw_string(struct json_writer* p_jw, const char* p_str)
+{
+    begin_value(p_jw);
+    put_string(p_jw, p_str);
+}
+
+////////////////////////////////////////
+void jw_int(struct json_writer* p_jw, const int64_t p_value)
+{
+    begin_value(p_jw);
+
+    // digits from the back, the magnitude unsigned so INT64_MIN works too
+    char digits[20];
+    char* pos = (digits + sizeof(digits));
+    uint64_t mag = ((p_value < 0) ? (0 - (uint64_t)p_value) : (uint64_t)p_value);
+    do
+    {
+        *--pos = (char)('0' + (mag % 10));
+        mag /= 10;
+    } while(mag > 0);
+    if(p_value < 0)
+    {
+        *--pos = '-';
+    }
+    put(p_jw, pos, ((digits + sizeof(digits)) - pos));
+}
+
+////////////////////////////////////////
+void jw_bool(struct json_writer* p_jw, const bool p_value)
+{
+    begin_value(p_jw);
+    if(p_value)
+    {
+        put(p_jw, "true", 4);
+    }
+    else
+    {
+        put(p_jw, "false", 5);
+    }
+}
+
+////////////////////////////////////////
+void jw_null(struct json_writer* p_jw)
+{
+    begin_value(p_jw);
+    put(p_jw, "null", 4);
+}
+
+////////////////////////////////////////
+void jw_raw(struct json_writer* p_jw, const char* p_json, const size_t p_len)
+{
+    begin_value(p_jw);
+    put(p_jw, p_json, p_len);
+}
+
+////////////////////////////////////////
+size_t jw_finish(struct json_writer* p_jw)
+{
+    if(p_jw->m_overflow || (0 != p_jw->m_depth) || p_jw->m_afterKey)
+    {
+        if(p_jw->m_capacity > 0)
+        {
+            p_jw->m_buf[0] = '\0';
+        }
+        return(0);
+    }
+    p_jw->m_buf[p_jw->m_len] = '\0';
+    return(p_jw->m_len);
+}
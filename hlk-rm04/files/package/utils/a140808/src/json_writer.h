@@ -0,0 +1,70 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its 
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including, 
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR 
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any 
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#ifndef __json_writer_h__
+#define __json_writer_h__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// outbound json formatted straight into a caller's buffer (ex: the frame
+// from ws_text_reserve()), no allocations. commas go in by themselves,
+// strings are escaped. a message that does not fit makes jw_finish()
+// return 0, nothing half written goes out:
+//
+//   struct json_writer jw;
+//   jw_init(&jw, buf, sizeof(buf));
+//   jw_object_begin(&jw);
+//   jw_key(&jw, "count");  jw_int(&jw, 3);
+//   jw_object_end(&jw);
+//   const size_t len = jw_finish(&jw);  // {"count":3}
+//
+
+#define JW_MAX_DEPTH  16
+
+struct json_writer
+{
+    char* m_buf;
+    size_t m_capacity;
+    size_t m_len;
+    bool m_overflow;
+    uint8_t m_depth;
+    uint16_t m_hasValue;     // bit per depth, the next value needs a comma
+    bool m_afterKey;         // the next value belongs to a key, no comma
+};
+
+void jw_init(struct json_writer* p_jw, char* p_buf, const size_t p_capacity);
+void jw_object_begin(struct json_writer* p_jw);
+void jw_object_end(struct json_writer* p_jw);
+void jw_array_begin(struct json_writer* p_jw);
+void jw_array_end(struct json_writer* p_jw);
+void jw_key(struct json_writer* p_jw, const char* p_key);
+void jw_string(struct json_writer* p_jw, const char* p_str);
+void jw_int(struct json_writer* p_jw, const int64_t p_value);
+void jw_bool(struct json_writer* p_jw, const bool p_value);
+void jw_null(struct json_writer* p_jw);
+// p_len bytes of json that is already formatted (ex: a journal record)
+void jw_raw(struct json_writer* p_jw, const char* p_json, const size_t p_len);
+// the length, the buffer nul terminated, 0 if it did not fit or the
+// objects and arrays do not add up
+size_t jw_finish(struct json_writer* p_jw);
+
+#endif // __json_writer_h__
@@ -0,0 +1,193 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its 
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including, 
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR 
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any 
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#include <string.h>  // memset
+
+#include "global.h"
+#include "link_probe.h"
+#include "msg_proc.h"
+
+
+#define LP_SLOW_MS       250  // a round trip above this degrades the link, the avr loop is 100ms
+#define LP_DEAD_PROBES   3    // lost in a row
+#define LP_STATS_SEC     60   // histogram log interval
+
+static uint32_t s_intervalMs = 0;
+static uint64_t s_nextProbe = 0;
+static uint8_t s_seq = 0;
+static bool s_outstanding = false;  // the last probe is not answered yet
+static uint8_t s_lostInRow = 0;
+static lp_link_state s_state = LP_LINK_OK;
+
+// round trip histogram, upper bucket edges in ms, the last one takes the rest
+static const uint16_t s_edges[] = { 5, 10, 20, 30, 40, 50, 60, 70, 80, 90, 100, 120, 140, 160, 180, 200, 250, 300, 400, 500, 750, 1000, 0xffff };
+#define LP_BUCKETS  (sizeof(s_edges) / sizeof(s_edges[0]))
+
+// stats, reset every LP_STATS_SEC
+static uint64_t s_statsStart = 0;
+static uint32_t s_hist[LP_BUCKETS];
+static uint32_t s_sent = 0;
+static uint32_t s_lost = 0;
+static uint32_t s_late = 0;  // answers to a probe counted as lost, or twice
+static uint32_t s_maxMs = 0;
+
+
+////////////////////////////////////////
+static uint8_t bucket(const uint32_t p_ms)
+{
+    uint8_t index = 0;
+    while(p_ms > s_edges[index])
+    {
+        ++index;
+    }
+    return(index);
+}
+
+////////////////////////////////////////
+// upper edge of the bucket with the p_permille'th round trip, s_maxMs for the last bucket
+static uint32_t percentile(const uint32_t p_count, const uint32_t p_permille)
+{
+    const uint32_t rank = (((p_count * p_permille) + 999) / 1000);
+    uint32_t seen = 0;
+    for(uint8_t i=0; i<(LP_BUCKETS - 1); ++i)
+    {
+        seen += s_hist[i];
+        if(seen >= rank)
+        {
+            return(min((uint32_t)s_edges[i], s_maxMs));
+        }
+    }
+    return(s_maxMs);
+}
+
+////////////////////////////////////////
+static void set_state(const lp_link_state p_state)
+{
+    if(p_state == s_state)
+    {
+        return;
+    }
+    s_state = p_state;
+    switch(p_state)
+    {
+        case LP_LINK_OK:       log_notice("link: avr link ok");                                        break;
+        case LP_LINK_DEGRADED: log_warn("link: avr link degraded");                                    break;
+        case LP_LINK_DEAD:     log_err("link: avr link dead, [%u] probes lost in a row", s_lostInRow);  break;
+    }
+}
+
+////////////////////////////////////////
+static void log_stats(const uint64_t p_now)
+{
+    uint32_t answered = 0;
+    for(uint8_t i=0; i<LP_BUCKETS; ++i)
+    {
+        answered += s_hist[i];
+    }
+    if(answered > 0)
+    {
+        log_info("link: probes: [%u] lost: [%u] late: [%u]  rtt p50: [%ums] p99: [%ums] max: [%ums]",
+                 s_sent, s_lost, s_late, percentile(answered, 500), percentile(answered, 990), s_maxMs);
+    }
+    else
+    {
+        log_info("link: probes: [%u] lost: [%u] late: [%u]", s_sent, s_lost, s_late);
+    }
+
+    memset(s_hist, 0, sizeof(s_hist));
+    s_sent = 0;
+    s_lost = 0;
+    s_late = 0;
+    s_maxMs = 0;
+    s_statsStart = p_now;
+}
+
+////////////////////////////////////////
+void lp_init(const uint32_t p_intervalMs)
+{
+    s_intervalMs = p_intervalMs;
+    s_nextProbe = mono_ms_now();
+    s_statsStart = s_nextProbe;
+    s_outstanding = false;
+    s_lostInRow = 0;
+    s_state = LP_LINK_OK;
+    memset(s_hist, 0, sizeof(s_hist));
+}
+
+////////////////////////////////////////
+void lp_poll(void)
+{
+    if(0 == s_intervalMs)
+    {
+        return;
+    }
+
+    const uint64_t now = mono_ms_now();
+    if(now < s_nextProbe)
+    {
+        return;
+    }
+    s_nextProbe = (now + s_intervalMs);
+
+    if(s_outstanding)
+    {
+        // not back within an interval
+        ++s_lost;
+        ++s_lostInRow;
+        set_state((s_lostInRow >= LP_DEAD_PROBES) ? LP_LINK_DEAD : LP_LINK_DEGRADED);
+    }
+    if((now - s_statsStart) >= (LP_STATS_SEC * 1000))
+    {
+        log_stats(now);
+    }
+
+    const uint16_t stamp = (uint16_t)now;
+    ++s_seq;
+    s_outstanding = mp_dispatch_ping(s_seq, (stamp >> 8), (stamp & 0xff));
+    ++s_sent;
+}
+
+////////////////////////////////////////
+void lp_on_pong(const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
+{
+    if(p_param1 != s_seq)
+    {
+        ++s_late;
+        return;
+    }
+    if(!s_outstanding)
+    {
+        // counted as lost already
+        ++s_late;
+        return;
+    }
+    s_outstanding = false;
+    s_lostInRow = 0;
+
+    const uint16_t stamp = ((p_param2 << 8) | p_param3);
+    const uint32_t ms = (uint16_t)(((uint16_t)mono_ms_now()) - stamp);
+    ++s_hist[bucket(ms)];
+    s_maxMs = max(s_maxMs, ms);
+    set_state((ms > LP_SLOW_MS) ? LP_LINK_DEGRADED : LP_LINK_OK);
+}
+
+////////////////////////////////////////
+lp_link_state lp_state(void)
+{
+    return(s_state);
+}
@@ -0,0 +1,51 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its 
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including, 
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR 
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any 
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __link_probe_h__
+#define __link_probe_h__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// avr link health: pings the board every probe interval and keeps the
+// round trip times in a histogram, so a slow relay command can be told
+// apart from a slow or broken serial link
+//
+// the ping carries the probe's sequence number in param1 and the low 16
+// bits of mono_ms_now() in param2 (high) and param3 (low). a probe not
+// answered by the time the next one goes out is lost, the link is then
+// degraded, and dead after LP_DEAD_PROBES lost in a row
+//
+
+typedef enum
+{
+    LP_LINK_OK,
+    LP_LINK_DEGRADED,  // the last probe was lost or slower than LP_SLOW_MS
+    LP_LINK_DEAD       // LP_DEAD_PROBES lost in a row
+} lp_link_state;
+
+// p_intervalMs: 0 turns the prober off
+void lp_init(const uint32_t p_intervalMs);
+// send the next probe when it is due, from the worker loop
+void lp_poll(void);
+// from mp_on_pong
+void lp_on_pong(const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3);
+lp_link_state lp_state(void);
+
+#endif // __link_probe_h__
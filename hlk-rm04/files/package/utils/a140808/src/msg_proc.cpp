@@ -0,0 +1,1642 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its 
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including, 
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR 
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any 
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// the daemon end of the avr link: the MsgProcessorT engine from the
+// firmware tree (avr/msg_processor.h) behind the C mp_* api
+//
+
+extern "C" {
+#include "global.h"
+}
+#include <poll.h>
+#include <string.h>  // memset
+
+#include "serial.h"
+#include "msg_proc.h"
+#include "msg_processor.h"
+
+
+//
+// multi-drop bus scheduler, see BusTransport
+//
+#define BUS_QUEUE_LEN          32    // frames waiting for the bus, per class (MP_CLASS_*)
+#define BUS_REPLY_MS           20    // a board's answer time on top of the frames on the wire
+#define BUS_POLL_MS            20    // least time between two polls of one board
+#define BUS_CMD_BURST          4     // frames sent before the next due poll goes out
+#define BUS_OFFLINE_MISSES     3     // answers missed in a row before a board is offline
+#define BUS_OFFLINE_POLL_MS    1000  // offline boards are polled this often
+#define BUS_STATS_SEC          60    // utilization and latency log interval
+#define BUS_BITS_PER_CHAR      10    // start, 7 data, parity, stop (E71) or start, 8 data, stop (N81)
+
+//
+// transmit classes, see BusTransport: the frames each class holds at most,
+// and how long its first frame waits for the higher ones before it goes
+// first (0: never passed over)
+//
+static const uint8_t s_classLen[MP_CLASSES] = { 16, 16, BUS_QUEUE_LEN };
+static const uint16_t s_classAgeMs[MP_CLASSES] = { 0, 100, 500 };
+
+//
+// point to point flow control (MSG_CREDIT), see BusTransport
+//
+#define LINK_PROBE_MS          300   // wait for the answer to a read of REG_LINK_CREDIT
+#define LINK_PROBES            3     // unanswered reads before the board is taken for one without flow control
+#define LINK_CLOSE_MS          1000  // mp_close() waits this long for queued frames and acks
+#define LINK_WINDOW            4     // reliable commands in flight, less than MP_SEQ_WINDOW
+#define LINK_ACK_MS            500   // for the ack, on top of a relay pulse
+#define LINK_TRIES             3     // sends of a reliable command before it is given up
+
+//
+// port recovery, see SerialTransport
+//
+#define SERIAL_CRC_BURST       8     // bad frames in a row before the port is taken for broken
+#define SERIAL_REOPEN_MIN_MS   50    // first reopen after a failure, doubling up to
+#define SERIAL_REOPEN_MAX_MS   5000
+#define SERIAL_BURST_LEN       512   // bytes held back between mp_burst_begin() and mp_burst_end()
+#define MP_MAX_SUBS            16    // subscriptions sent again after a reopen
+
+
+////////////////////////////////////////////////////////////
+// the a140808 serial link, see MsgProcessorT Transport
+//
+// a read or write error (EIO once a usb adapter is gone) or
+// SERIAL_CRC_BURST bad frames in a row (line settings lost, the board at
+// another rate) close the port and mark it failed. mp_poll() then reopens
+// it with the same settings, backing off from SERIAL_REOPEN_MIN_MS
+class SerialTransport
+{
+public:
+    ////////////////////////////////////////
+    SerialTransport(void)
+      : m_fd(-1), m_device(0), m_baud(0), m_parity(false), m_failed(false), m_crcBurst(0), m_inLen(0), m_inPos(0),
+        m_burst(false), m_outLen(0)
+    {
+    }
+
+    ////////////////////////////////////////
+    ~SerialTransport(void)
+    {
+        close();
+    }
+
+    ////////////////////////////////////////
+    bool open(const char* p_device, const uint32_t p_baud, const bool p_parity)
+    {
+        close();
+        m_device = p_device;
+        m_baud = p_baud;
+        m_parity = p_parity;
+        m_fd = sp_open(p_device, p_baud, p_parity);
+        m_failed = (m_fd < 0);
+        m_crcBurst = 0;
+        return(!m_failed);
+    }
+
+    ////////////////////////////////////////
+    // the settings of the last open(), termios and all
+    bool reopen(void)
+    {
+        return(open(m_device, m_baud, m_parity));
+    }
+
+    ////////////////////////////////////////
+    // waiting for reopen()
+    bool failed(void) const
+    {
+        return(m_failed);
+    }
+
+    ////////////////////////////////////////
+    const char* device(void) const
+    {
+        return(m_device);
+    }
+
+    ////////////////////////////////////////
+    void close(void)
+    {
+        sp_close(m_fd);
+        m_fd = -1;
+        m_inLen = 0;
+        m_inPos = 0;
+        m_outLen = 0;
+    }
+
+    ////////////////////////////////////////
+    int fd(void) const
+    {
+        return(m_fd);
+    }
+
+    ////////////////////////////////////////
+    // bytes already read that may hold another frame
+    bool pending(void) const
+    {
+        return(m_inPos < m_inLen);
+    }
+
+    ////////////////////////////////////////
+    bool read(MsgBuf& p_msgBuf)
+    {
+        for(;;)
+        {
+            // bytes left over from the last read belong to the next frame
+            while(m_inPos < m_inLen)
+            {
+                p_msgBuf.push_back(m_in[m_inPos++]);
+                const uint8_t rc = p_msgBuf.validate();
+                if(S_OK == rc)
+                {
+                    // have a message
+                    m_crcBurst = 0;
+                    return(true);
+                }
+                // validate() hands the negative codes back as uint8_t
+                if(((uint8_t)E_BAD_CRC == rc) && (SERIAL_CRC_BURST == ++m_crcBurst))
+                {
+                    fail("bad frames only");
+                    return(false);
+                }
+            }
+
+            if(m_failed)
+            {
+                return(false);
+            }
+            m_inPos = 0;
+            m_inLen = 0;
+            const ssize_t bytesRead = sp_read(m_fd, m_in, sizeof(m_in));
+            if(bytesRead < 0)
+            {
+                fail("read error");
+                return(false);
+            }
+            if(0 == bytesRead)
+            {
+                // no data available
+                return(false);
+            }
+            m_inLen = bytesRead;
+        }
+    }
+
+    ////////////////////////////////////////
+    bool write(MsgBuf& p_msgBuf)
+    {
+        log_trace2("SerialTransport::write");
+        uint8_t buf[BUS_BUF_COUNT + 1];
+        const uint8_t len = encode(p_msgBuf, buf);
+        if(0 == len)
+        {
+            // message is not valid
+            log_trace("ignoring invalid message send request, size: %d", p_msgBuf.size());
+            return(false);
+        }
+        return(write(buf, len));
+    }
+
+    ////////////////////////////////////////
+    bool write(const uint8_t* p_buf, const uint8_t p_len)
+    {
+        if(m_failed)
+        {
+            return(false);
+        }
+        if(m_burst)
+        {
+            if(((m_outLen + p_len) > sizeof(m_out)) && !flush())
+            {
+                return(false);
+            }
+            memcpy(&m_out[m_outLen], p_buf, p_len);
+            m_outLen += p_len;
+            return(true);
+        }
+        if(!sp_write(m_fd, p_buf, p_len))
+        {
+            fail("write error");
+            return(false);
+        }
+        return(true);
+    }
+
+    ////////////////////////////////////////
+    // writes up to burst_end() go out together, in one write(2) as far as
+    // SERIAL_BURST_LEN holds them
+    void burst_begin(void)
+    {
+        m_burst = true;
+    }
+
+    ////////////////////////////////////////
+    bool burst_end(void)
+    {
+        m_burst = false;
+        return(flush());
+    }
+
+    ////////////////////////////////////////
+    // the wire bytes of a frame into p_buf (BUS_BUF_COUNT + 1), 0 if it is not valid
+    static uint8_t encode(MsgBuf& p_msgBuf, uint8_t* p_buf)
+    {
+        if(S_OK != p_msgBuf.validate())
+        {
+            return(0);
+        }
+
+        const uint8_t len = p_msgBuf.size();
+        for(uint8_t i=0; i<len; ++i)
+        {
+            p_buf[i] = p_msgBuf[i];
+        }
+
+        // TODO: bug in atmega32 code requires an extra byte to be sent for now
+        p_buf[len] = '\n';
+        return(len + 1);
+    }
+
+private:
+    ////////////////////////////////////////
+    void fail(const char* p_why)
+    {
+        log_err("serial: %s on [%s], closing the port", p_why, m_device);
+        sp_close(m_fd);
+        m_fd = -1;
+        m_failed = true;
+        m_crcBurst = 0;
+        m_inLen = 0;
+        m_inPos = 0;
+        m_outLen = 0;
+    }
+
+    ////////////////////////////////////////
+    bool flush(void)
+    {
+        if((0 == m_outLen) || m_failed)
+        {
+            return(!m_failed);
+        }
+        const uint16_t len = m_outLen;
+        m_outLen = 0;
+        if(!sp_write(m_fd, m_out, len))
+        {
+            fail("write error");
+            return(false);
+        }
+        return(true);
+    }
+
+    int m_fd;
+    const char* m_device;
+    uint32_t m_baud;
+    bool m_parity;
+    bool m_failed;
+    uint8_t m_crcBurst;         // bad frames since the last good one
+    uint8_t m_in[64];
+    uint8_t m_inLen;
+    uint8_t m_inPos;
+    bool m_burst;
+    uint8_t m_out[SERIAL_BURST_LEN];
+    uint16_t m_outLen;
+};
+
+////////////////////////////////////////////////////////////
+// master side of a multi-drop rs485 bus, see MsgProcessorT Transport
+//
+// boards only answer frames addressed to them and hand over their events
+// when polled (MSG_POLL), so the daemon decides who talks: one frame that
+// expects an answer is in flight at a time, the next goes out once the
+// answer is in or BUS_REPLY_MS past the frames' time on the wire. the
+// boards are polled round robin in between the queued frames, which
+// bounds the time to hear from every board:
+//
+//   cycle <= boards * (1 + BUS_CMD_BURST) * (request + answer + BUS_REPLY_MS)
+//
+// with no boards configured the link is point to point and the board
+// paces the daemon instead (MSG_CREDIT in msg_defs.h): a read of
+// REG_LINK_CREDIT lines up the board's count of consumed bytes with the
+// bytes sent, after that frames go out only while the board's rx ring has
+// room for them. the board keeps count as it works through its ring, a
+// burst waits in the queue instead of overwriting the oldest bytes. a
+// board that never answers the read gets the frames unpaced
+//
+// in reliable mode (mp_set_reliable()) the relay commands go out numbered
+// (SEQ_* in msg_defs.h), up to LINK_WINDOW of them in flight. the board
+// runs them in order and acks each, when the oldest is not acked within
+// LINK_ACK_MS it and all after it are sent again (go-back-n). mp_on_ack()
+// reports the outcome, MP_ACK_FAILED after LINK_TRIES sends
+//
+// the frames queue by class (MP_CLASS_* in msg_proc.h), the relay and
+// register writes first, then reads and subscriptions, then the rest, in
+// order within a class. a frame that waited s_classAgeMs for its class
+// goes ahead of the higher ones so a steady stream of writes can't hold it
+// back for good. on the bus the writes go out ahead of a due poll as well
+class BusTransport
+{
+public:
+    ////////////////////////////////////////
+    BusTransport(SerialTransport& p_port)
+      : m_port(p_port), m_baud(0), m_boardCount(0), m_nextBoard(0),
+        m_burst(0),
+        m_inFlight(false), m_flightAddress(BUS_ADDRESS_NONE), m_flightPoll(false), m_deadline(0),
+        m_statsStart(0), m_txChars(0), m_rxChars(0), m_stray(0),
+        m_link(LINK_SYNC), m_probes(0), m_probeDeadline(0), m_sent(0), m_consumed(0), m_window(0),
+        m_reliable(false), m_seqNext(0), m_pendHead(0), m_pendCount(0), m_resend(0),
+        m_tag(0), m_tagged(0), m_ackTag(0)
+    {
+        memset(m_stats, 0, sizeof(m_stats));
+    }
+
+    ////////////////////////////////////////
+    void set_reliable(const bool p_reliable)
+    {
+        m_reliable = p_reliable;
+    }
+
+    ////////////////////////////////////////
+    // the frames written from now on carry p_tag, see mp_set_tag()
+    void set_tag(const uint32_t p_tag)
+    {
+        m_tag = p_tag;
+        m_tagged = 0;
+    }
+    uint8_t tagged(void) const
+    {
+        return(m_tagged);
+    }
+    uint32_t ack_tag(void) const
+    {
+        return(m_ackTag);
+    }
+
+    ////////////////////////////////////////
+    // the port was (re)opened, line up the point to point credits again
+    void reset(void)
+    {
+        for(uint8_t i=0; i<MP_CLASSES; ++i)
+        {
+            m_queues[i].m_head = 0;
+            m_queues[i].m_count = 0;
+        }
+        m_inFlight = false;
+        m_link = LINK_SYNC;
+        m_probes = 0;
+        m_probeDeadline = 0;
+        m_seqNext = 0;
+        m_pendHead = 0;
+        m_pendCount = 0;
+        m_resend = 0;
+    }
+
+    ////////////////////////////////////////
+    // the port came back after a failure: the board may have lost bytes or
+    // restarted, line up the credits again and send the unacked commands
+    // again once they are, the queue keeps its frames
+    void reopened(void)
+    {
+        m_inFlight = false;
+        m_link = LINK_SYNC;
+        m_probes = 0;
+        m_probeDeadline = 0;
+        m_resend = 0;
+    }
+
+    ////////////////////////////////////////
+    bool init(const uint8_t* p_addresses, const uint8_t p_count, const uint32_t p_baud)
+    {
+        if((p_count > BUS_MAX_BOARDS) || (0 == p_baud))
+        {
+            return(false);
+        }
+
+        const uint64_t now = mono_ms_now();
+        m_baud = p_baud;
+        m_boardCount = p_count;
+        for(uint8_t i=0; i<p_count; ++i)
+        {
+            Board& board = m_boards[i];
+            memset(&board, 0, sizeof(board));
+            board.m_address = p_addresses[i];
+            board.m_online = true;
+            board.m_lastHeard = now;
+        }
+        m_statsStart = now;
+
+        const uint32_t transaction = (frame_ms(BUS_BUF_COUNT + 1) + frame_ms(BUS_BUF_COUNT) + BUS_REPLY_MS);
+        log_notice("bus: [%u] boards at [%u] baud, every board is polled within [%ums]",
+                   p_count, p_baud, (p_count * (1 + BUS_CMD_BURST) * transaction));
+        return(true);
+    }
+
+    ////////////////////////////////////////
+    bool active(void) const
+    {
+        return(m_boardCount > 0);
+    }
+
+    ////////////////////////////////////////
+    // address of configured board p_index, BUS_ADDRESS_NONE past the last one
+    uint8_t board(const uint8_t p_index) const
+    {
+        return((p_index < m_boardCount) ? m_boards[p_index].m_address : BUS_ADDRESS_NONE);
+    }
+
+    ////////////////////////////////////////
+    bool read(MsgBuf& p_msgBuf)
+    {
+        pump();
+        if(!m_port.read(p_msgBuf))
+        {
+            return(false);
+        }
+        if(!active())
+        {
+            credit(p_msgBuf);
+            uint8_t seq;
+            if(p_msgBuf.get_seq(seq))
+            {
+                // numbered answers are ours, the engine gets the next frame
+                acked(p_msgBuf, seq);
+                p_msgBuf.clear();
+                return(read(p_msgBuf));
+            }
+            return(true);
+        }
+
+        const uint8_t address = p_msgBuf.get_address();
+        m_rxChars += ((BUS_ADDRESS_NONE == address) ? RING_BUF_COUNT : BUS_BUF_COUNT);
+        if(m_inFlight && (address == m_flightAddress))
+        {
+            answered(p_msgBuf);
+            pump();  // the bus is free, the next frame goes out right away
+        }
+        else
+        {
+            // late answer or a board out of turn
+            ++m_stray;
+        }
+        return(true);
+    }
+
+    ////////////////////////////////////////
+    bool write(MsgBuf& p_msgBuf)
+    {
+        uint8_t msg[4];
+        if(!p_msgBuf.get_bytes(msg[0], msg[1], msg[2], msg[3]))
+        {
+            return(false);
+        }
+        const uint8_t cls = class_of(msg[0]);
+        if(!active() && (LINK_OPEN == m_link) && !m_port.failed() && (0 == queued()))
+        {
+            ++m_stats[cls].m_frames;  // nothing waits, nothing to overtake
+            if(!m_port.write(p_msgBuf))
+            {
+                return(false);
+            }
+            ++m_tagged;
+            sent(m_tag, false);
+            return(true);
+        }
+
+        Queue& queue = m_queues[cls];
+        if(s_classLen[cls] == queue.m_count)
+        {
+            log_err("%s: class [%u] queue full, dropping frame for board [0x%02x]", (active() ? "bus" : "link"), cls, p_msgBuf.get_address());
+            ++m_stats[cls].m_dropped;
+            return(false);
+        }
+
+        Frame& frame = queue.m_frames[(queue.m_head + queue.m_count) % BUS_QUEUE_LEN];
+        frame.m_len = SerialTransport::encode(p_msgBuf, frame.m_buf);
+        if(0 == frame.m_len)
+        {
+            return(false);
+        }
+        memcpy(frame.m_msg, msg, sizeof(msg));
+        frame.m_queuedAt = mono_ms_now();
+        frame.m_tag = m_tag;
+        const uint8_t type = frame.m_msg[0];
+        frame.m_holdMs = frame.m_msg[3];
+        frame.m_address = p_msgBuf.get_address();
+        frame.m_answered = expects_answer(type) && (BUS_ADDRESS_NONE != frame.m_address) && (BUS_ADDRESS_BROADCAST != frame.m_address);
+        if(MSG_PULSE_REGISTER_BIT != type)
+        {
+            frame.m_holdMs = 0;
+        }
+        ++queue.m_count;
+        ++m_tagged;
+
+        pump();
+        return(true);
+    }
+
+    ////////////////////////////////////////
+    // ms until the scheduler has something to do, at most p_maxMs
+    uint32_t wait_ms(const uint32_t p_maxMs) const
+    {
+        const uint64_t now = mono_ms_now();
+        if(!active())
+        {
+            // credits and acks come in on the port like any frame
+            uint64_t next = (now + p_maxMs);
+            if(LINK_SYNC == m_link)
+            {
+                next = m_probeDeadline;
+            }
+            else if(m_pendCount > 0)
+            {
+                next = m_pending[m_pendHead].m_deadline;
+            }
+            return((next > now) ? (((next - now) < p_maxMs) ? (next - now) : p_maxMs) : 0);
+        }
+
+        uint64_t next = (now + p_maxMs);
+        if(m_inFlight)
+        {
+            next = m_deadline;
+        }
+        else
+        {
+            for(uint8_t i=0; i<MP_CLASSES; ++i)
+            {
+                if(m_queues[i].m_count > 0)
+                {
+                    const Board* board = find(m_queues[i].m_frames[m_queues[i].m_head].m_address);
+                    const uint64_t due = ((0 != board) ? board->m_holdUntil : now);
+                    next = ((due < next) ? due : next);
+                }
+            }
+            for(uint8_t i=0; i<m_boardCount; ++i)
+            {
+                const uint64_t due = poll_due(m_boards[i]);
+                if(due < next)
+                {
+                    next = due;
+                }
+            }
+        }
+        return((next > now) ? (((next - now) < p_maxMs) ? (next - now) : p_maxMs) : 0);
+    }
+
+    ////////////////////////////////////////
+    // next frame out if the bus is free
+    void pump(void)
+    {
+        if(m_port.failed())
+        {
+            // the frames wait for the port
+            return;
+        }
+        const uint64_t now = mono_ms_now();
+        if(!active())
+        {
+            pump_link(now);
+            return;
+        }
+
+        if(m_inFlight)
+        {
+            if(now < m_deadline)
+            {
+                return;
+            }
+            missed(now);
+        }
+        if((now - m_statsStart) >= (BUS_STATS_SEC * 1000))
+        {
+            log_stats(now);
+        }
+
+        // frames without an answer leave the bus free, keep sending
+        while(!m_inFlight)
+        {
+            const int poll = next_poll(now);
+            if((queued() > 0) && ((m_burst < BUS_CMD_BURST) || (poll < 0) || (m_queues[MP_CLASS_CONTROL].m_count > 0)) && send_queued(now))
+            {
+                continue;
+            }
+            if(poll < 0)
+            {
+                break;
+            }
+            send_poll(m_boards[poll], now);
+            m_nextBoard = ((poll + 1) % m_boardCount);
+            m_burst = 0;
+        }
+    }
+
+    ////////////////////////////////////////
+    // send what is queued and wait for the acks, up to p_maxMs
+    void flush(const uint32_t p_maxMs)
+    {
+        const uint64_t end = (mono_ms_now() + p_maxMs);
+        MsgBuf msgBuf;
+        for(uint64_t now=mono_ms_now(); ((queued() > 0) || (m_pendCount > 0)) && !m_port.failed() && (now < end); now=mono_ms_now())
+        {
+            struct pollfd pfd = { m_port.fd(), POLLIN, 0 };
+            poll(&pfd, 1, wait_ms(end - now));
+            while(read(msgBuf))
+            {
+                msgBuf.clear();  // nobody listens any more
+            }
+            pump();
+        }
+    }
+
+    ////////////////////////////////////////
+    void class_stats(const uint8_t p_class, mp_class_stats* p_stats) const
+    {
+        *p_stats = m_stats[p_class];
+        p_stats->m_queued = m_queues[p_class].m_count;
+    }
+
+private:
+    enum Link
+    {
+        LINK_SYNC,              // waiting for the answer to a read of REG_LINK_CREDIT
+        LINK_CREDIT,            // paced by the board's credits
+        LINK_OPEN               // the board has no flow control
+    };
+
+    struct Board
+    {
+        uint8_t m_address;
+        bool m_online;
+        bool m_more;            // the last poll brought an event, there may be more
+        uint8_t m_missed;       // answers missed in a row
+        uint64_t m_lastPoll;    // mono_ms_now()
+        uint64_t m_lastHeard;
+        uint64_t m_holdUntil;   // busy pulsing a relay
+        uint32_t m_polls;
+        uint32_t m_events;
+        uint32_t m_misses;
+        uint32_t m_maxGapMs;    // longest silence, the worst event latency
+    };
+    struct Frame
+    {
+        uint64_t m_queuedAt;    // mono_ms_now()
+        uint32_t m_tag;         // mp_set_tag()
+        uint8_t m_address;
+        bool m_answered;        // the board answers it
+        uint8_t m_holdMs;       // the board is busy this long after it
+        uint8_t m_msg[4];       // type and params, for a numbered copy
+        uint8_t m_len;
+        uint8_t m_buf[BUS_BUF_COUNT + 1];
+    };
+    struct Queue
+    {
+        Frame m_frames[BUS_QUEUE_LEN];
+        uint8_t m_head;
+        uint8_t m_count;
+    };
+    struct Pending
+    {
+        uint32_t m_tag;
+        uint8_t m_seq;
+        uint8_t m_msg[4];
+        uint8_t m_tries;
+        uint64_t m_deadline;    // for the ack, mono_ms_now()
+        uint8_t m_len;
+        uint8_t m_buf[BUS_BUF_COUNT + 1];
+    };
+
+    SerialTransport& m_port;
+    uint32_t m_baud;
+    Board m_boards[BUS_MAX_BOARDS];
+    uint8_t m_boardCount;
+    uint8_t m_nextBoard;        // round robin
+    Queue m_queues[MP_CLASSES];
+    mp_class_stats m_stats[MP_CLASSES];
+    uint8_t m_burst;            // frames sent since the last poll
+    bool m_inFlight;            // waiting for an answer
+    uint8_t m_flightAddress;
+    bool m_flightPoll;
+    uint64_t m_deadline;
+    uint64_t m_statsStart;
+    uint32_t m_txChars;
+    uint32_t m_rxChars;
+    uint32_t m_stray;
+    Link m_link;
+    uint8_t m_probes;           // REG_LINK_CREDIT reads without an answer
+    uint64_t m_probeDeadline;   // mono_ms_now()
+    uint16_t m_sent;            // bytes sent, in the board's count (CREDIT_COUNT_MASK)
+    uint16_t m_consumed;        // the board's last count
+    uint8_t m_window;           // the board's rx ring
+    bool m_reliable;
+    uint8_t m_seqNext;          // 0 until the board has been told to start over
+    Pending m_pending[LINK_WINDOW];
+    uint8_t m_pendHead;
+    uint8_t m_pendCount;
+    uint8_t m_resend;           // pending commands sent since the last go-back, m_pendCount if all
+    uint32_t m_tag;             // of the frames written, see mp_set_tag()
+    uint8_t m_tagged;           // frames written since
+    uint32_t m_ackTag;          // of the command in mp_on_ack()
+
+    ////////////////////////////////////////
+    static bool expects_answer(const uint8_t p_type)
+    {
+        return((MSG_PING == p_type) || (MSG_READ_REGISTER == p_type) || (MSG_SUBSCRIBE_REGISTER == p_type) || (MSG_POLL == p_type));
+    }
+
+    ////////////////////////////////////////
+    static uint8_t class_of(const uint8_t p_type)
+    {
+        switch(p_type)
+        {
+            case MSG_WRITE_REGISTER:
+            case MSG_WRITE_REGISTER_BIT:
+            case MSG_PULSE_REGISTER_BIT:
+                return(MP_CLASS_CONTROL);
+            case MSG_READ_REGISTER:
+            case MSG_SUBSCRIBE_REGISTER:
+                return(MP_CLASS_INTERACTIVE);
+            default:
+                return(MP_CLASS_BACKGROUND);
+        }
+    }
+
+    ////////////////////////////////////////
+    uint8_t queued(void) const
+    {
+        uint8_t count = 0;
+        for(uint8_t i=0; i<MP_CLASSES; ++i)
+        {
+            count += m_queues[i].m_count;
+        }
+        return(count);
+    }
+
+    ////////////////////////////////////////
+    // the class of the next frame out, -1 if there is none the board of
+    // which is free: the first class that waited past its s_classAgeMs,
+    // else the highest
+    int next_class(const uint64_t p_now) const
+    {
+        int highest = -1;
+        for(uint8_t i=0; i<MP_CLASSES; ++i)
+        {
+            const Queue& queue = m_queues[i];
+            if(0 == queue.m_count)
+            {
+                continue;
+            }
+            const Frame& frame = queue.m_frames[queue.m_head];
+            const Board* board = find(frame.m_address);
+            if((0 != board) && (p_now < board->m_holdUntil))
+            {
+                continue;
+            }
+            if((0 != s_classAgeMs[i]) && ((p_now - frame.m_queuedAt) >= s_classAgeMs[i]))
+            {
+                return(i);
+            }
+            highest = ((highest < 0) ? i : highest);
+        }
+        return(highest);
+    }
+
+    ////////////////////////////////////////
+    // the first frame of p_class is on the wire
+    void dequeue(const uint8_t p_class)
+    {
+        Queue& queue = m_queues[p_class];
+        mp_class_stats& stats = m_stats[p_class];
+        const uint32_t waitedMs = (mono_ms_now() - queue.m_frames[queue.m_head].m_queuedAt);
+        ++stats.m_frames;
+        stats.m_waitedMs += waitedMs;
+        stats.m_maxWaitMs = ((waitedMs > stats.m_maxWaitMs) ? waitedMs : stats.m_maxWaitMs);
+        queue.m_head = ((queue.m_head + 1) % BUS_QUEUE_LEN);
+        --queue.m_count;
+    }
+
+    ////////////////////////////////////////
+    static void sent(const uint32_t p_tag, const bool p_acked)
+    {
+        if(0 != p_tag)
+        {
+            mp_on_sent(p_tag, p_acked);
+        }
+    }
+
+    ////////////////////////////////////////
+    // ms the chars take on the wire, rounded up
+    uint32_t frame_ms(const uint32_t p_chars) const
+    {
+        return(((p_chars * BUS_BITS_PER_CHAR * 1000) + m_baud - 1) / m_baud);
+    }
+
+    ////////////////////////////////////////
+    Board* find(const uint8_t p_address)
+    {
+        for(uint8_t i=0; i<m_boardCount; ++i)
+        {
+            if(p_address == m_boards[i].m_address)
+            {
+                return(&m_boards[i]);
+            }
+        }
+        return(0);
+    }
+    const Board* find(const uint8_t p_address) const
+    {
+        return(const_cast<BusTransport*>(this)->find(p_address));
+    }
+
+    ////////////////////////////////////////
+    uint64_t poll_due(const Board& p_board) const
+    {
+        const uint64_t due = (p_board.m_more ? 0 : (p_board.m_lastPoll + (p_board.m_online ? BUS_POLL_MS : BUS_OFFLINE_POLL_MS)));
+        return((due > p_board.m_holdUntil) ? due : p_board.m_holdUntil);
+    }
+
+    ////////////////////////////////////////
+    // board index of the next poll, round robin, -1 if none is due
+    int next_poll(const uint64_t p_now) const
+    {
+        for(uint8_t i=0; i<m_boardCount; ++i)
+        {
+            const uint8_t index = ((m_nextBoard + i) % m_boardCount);
+            if(poll_due(m_boards[index]) <= p_now)
+            {
+                return(index);
+            }
+        }
+        return(-1);
+    }
+
+    ////////////////////////////////////////
+    void transmit(const uint8_t* p_buf, const uint8_t p_len, const uint8_t p_address, const bool p_answered, const uint64_t p_now)
+    {
+        m_port.write(p_buf, p_len);
+        m_txChars += p_len;
+        if(p_answered)
+        {
+            m_inFlight = true;
+            m_flightAddress = p_address;
+            m_deadline = (p_now + frame_ms(p_len) + frame_ms(BUS_BUF_COUNT) + BUS_REPLY_MS);
+        }
+    }
+
+    ////////////////////////////////////////
+    // false if the boards of the queued frames are busy
+    bool send_queued(const uint64_t p_now)
+    {
+        const int cls = next_class(p_now);
+        if(cls < 0)
+        {
+            return(false);
+        }
+        const Frame& frame = m_queues[cls].m_frames[m_queues[cls].m_head];
+        Board* board = find(frame.m_address);
+        const uint32_t tag = frame.m_tag;
+
+        m_flightPoll = false;
+        transmit(frame.m_buf, frame.m_len, frame.m_address, frame.m_answered, p_now);
+        if((0 != board) && (frame.m_holdMs > 0))
+        {
+            board->m_holdUntil = (p_now + frame_ms(frame.m_len) + frame.m_holdMs);
+        }
+        dequeue(cls);
+        ++m_burst;
+        sent(tag, false);
+        return(true);
+    }
+
+    ////////////////////////////////////////
+    void send_poll(Board& p_board, const uint64_t p_now)
+    {
+        MsgBuf msgBuf;
+        msgBuf.set_bytes(p_board.m_address, MSG_POLL, 0x00, 0x00, 0x00);
+        uint8_t buf[BUS_BUF_COUNT + 1];
+        const uint8_t len = SerialTransport::encode(msgBuf, buf);
+
+        m_flightPoll = true;
+        transmit(buf, len, p_board.m_address, true, p_now);
+        p_board.m_lastPoll = p_now;
+        p_board.m_more = false;
+        ++p_board.m_polls;
+    }
+
+    ////////////////////////////////////////
+    void answered(MsgBuf& p_msgBuf)
+    {
+        m_inFlight = false;
+        Board* board = find(m_flightAddress);
+        if(0 == board)
+        {
+            return;
+        }
+
+        const uint64_t now = mono_ms_now();
+        const uint32_t gap = (now - board->m_lastHeard);
+        if(gap > board->m_maxGapMs)
+        {
+            board->m_maxGapMs = gap;
+        }
+        board->m_lastHeard = now;
+        board->m_missed = 0;
+        if(!board->m_online)
+        {
+            board->m_online = true;
+            log_notice("bus: board [0x%02x] online", board->m_address);
+        }
+
+        uint8_t type;
+        uint8_t param1;
+        uint8_t param2;
+        uint8_t param3;
+        if(m_flightPoll && p_msgBuf.get_bytes(type, param1, param2, param3) && (MSG_POLL != type))
+        {
+            // an event, poll again for the rest
+            board->m_more = true;
+            ++board->m_events;
+        }
+    }
+
+    ////////////////////////////////////////
+    void missed(const uint64_t p_now)
+    {
+        m_inFlight = false;
+        Board* board = find(m_flightAddress);
+        if(0 == board)
+        {
+            return;
+        }
+
+        ++board->m_misses;
+        if((BUS_OFFLINE_MISSES == ++board->m_missed) && board->m_online)
+        {
+            board->m_online = false;
+            log_warn("bus: board [0x%02x] offline, no answer in [%ums]", board->m_address, (uint32_t)(p_now - board->m_lastHeard));
+        }
+    }
+
+    ////////////////////////////////////////
+    // bytes sent that the board has not got to yet
+    uint16_t outstanding(void) const
+    {
+        return((m_sent - m_consumed) & CREDIT_COUNT_MASK);
+    }
+
+    ////////////////////////////////////////
+    // point to point: queued frames out while the board has room for them
+    void pump_link(const uint64_t p_now)
+    {
+        if((LINK_SYNC == m_link) && (p_now >= m_probeDeadline))
+        {
+            if(LINK_PROBES == m_probes)
+            {
+                log_warn("link: no flow control from the board, frames go out unpaced");
+                m_link = LINK_OPEN;
+            }
+            else
+            {
+                probe();
+            }
+        }
+
+        if(LINK_SYNC == m_link)
+        {
+            return;
+        }
+
+        // the oldest command is overdue, it and everything after it again
+        if((m_pendCount > 0) && (m_resend == m_pendCount) && (p_now >= m_pending[m_pendHead].m_deadline))
+        {
+            if(m_pending[m_pendHead].m_tries >= LINK_TRIES)
+            {
+                give_up();
+            }
+            m_resend = 0;
+        }
+        while(m_resend < m_pendCount)
+        {
+            Pending& pending = m_pending[(m_pendHead + m_resend) % LINK_WINDOW];
+            if(!send_link(pending.m_buf, pending.m_len))
+            {
+                return;
+            }
+            ++pending.m_tries;
+            pending.m_deadline = ack_deadline(pending.m_msg, p_now);
+            ++m_resend;
+        }
+
+        for(int cls=next_class(p_now); cls>=0; cls=next_class(p_now))
+        {
+            const Frame& frame = m_queues[cls].m_frames[m_queues[cls].m_head];
+            const uint32_t tag = frame.m_tag;
+            const bool isNumbered = numbered(frame.m_msg[0]);
+            if(isNumbered)
+            {
+                if((0 == m_seqNext) && !send_numbered(MSG_PING, 0x00, 0x00, 0x00, 0, p_now))
+                {
+                    break;
+                }
+                if(!send_numbered(frame.m_msg[0], frame.m_msg[1], frame.m_msg[2], frame.m_msg[3], tag, p_now))
+                {
+                    break;
+                }
+            }
+            else if(((m_pendCount > 0) && m_reliable) || !send_link(frame.m_buf, frame.m_len))
+            {
+                // the rest keeps its place behind the relay commands
+                break;
+            }
+            dequeue(cls);
+            sent(tag, isNumbered);
+        }
+    }
+
+    ////////////////////////////////////////
+    // false if the board has no room for it yet
+    bool send_link(const uint8_t* p_buf, const uint8_t p_len)
+    {
+        if((LINK_CREDIT == m_link) && ((outstanding() + p_len) > m_window))
+        {
+            return(false);
+        }
+        m_port.write(p_buf, p_len);
+        m_sent = ((m_sent + p_len) & CREDIT_COUNT_MASK);
+        return(true);
+    }
+
+    ////////////////////////////////////////
+    // reliable mode goes out numbered, only to a board with flow control as
+    // the older firmware has neither
+    bool numbered(const uint8_t p_type) const
+    {
+        return(m_reliable && (LINK_CREDIT == m_link) &&
+               ((MSG_WRITE_REGISTER == p_type) || (MSG_WRITE_REGISTER_BIT == p_type) || (MSG_PULSE_REGISTER_BIT == p_type)));
+    }
+
+    ////////////////////////////////////////
+    uint64_t ack_deadline(const uint8_t* p_msg, const uint64_t p_now) const
+    {
+        return(p_now + LINK_ACK_MS + ((MSG_PULSE_REGISTER_BIT == p_msg[0]) ? p_msg[3] : 0));
+    }
+
+    ////////////////////////////////////////
+    // false if the window is full or the board has no room for it yet
+    bool send_numbered(const uint8_t p_type, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3, const uint32_t p_tag, const uint64_t p_now)
+    {
+        if(LINK_WINDOW == m_pendCount)
+        {
+            return(false);
+        }
+        Pending& pending = m_pending[(m_pendHead + m_pendCount) % LINK_WINDOW];
+        MsgBuf msgBuf;
+        msgBuf.set_seq_bytes(m_seqNext, p_type, p_param1, p_param2, p_param3);
+        pending.m_len = SerialTransport::encode(msgBuf, pending.m_buf);
+        if(!send_link(pending.m_buf, pending.m_len))
+        {
+            return(false);
+        }
+        pending.m_tag = p_tag;
+        pending.m_seq = m_seqNext;
+        pending.m_msg[0] = p_type;
+        pending.m_msg[1] = p_param1;
+        pending.m_msg[2] = p_param2;
+        pending.m_msg[3] = p_param3;
+        pending.m_tries = 1;
+        pending.m_deadline = ack_deadline(pending.m_msg, p_now);
+        ++m_pendCount;
+        m_resend = m_pendCount;
+        m_seqNext = ((m_seqNext % SEQ_MAX) + 1);
+        return(true);
+    }
+
+    ////////////////////////////////////////
+    // the numbered answer p_seq, it acks everything up to it as the board
+    // runs them in order
+    void acked(MsgBuf& p_msgBuf, const uint8_t p_seq)
+    {
+        uint8_t index = 0;
+        while((index < m_pendCount) && ((m_pending[(m_pendHead + index) % LINK_WINDOW].m_seq | SEQ_REPLY) != p_seq))
+        {
+            ++index;
+        }
+        if(index == m_pendCount)
+        {
+            // a late one for a retry
+            return;
+        }
+
+        uint8_t type;
+        uint8_t param1;
+        uint8_t param2;
+        uint8_t status;
+        if(!p_msgBuf.get_bytes(type, param1, param2, status) || (MSG_ACK != type))
+        {
+            status = ACK_OK;
+        }
+        for(uint8_t i=0; i<=index; ++i)
+        {
+            const Pending& pending = m_pending[m_pendHead];
+            if((0 != pending.m_seq) || (MSG_PING != pending.m_msg[0]))
+            {
+                m_ackTag = pending.m_tag;
+                mp_on_ack(pending.m_msg[0], pending.m_msg[1], ((i == index) ? status : ACK_OK));
+                m_ackTag = 0;
+            }
+            m_pendHead = ((m_pendHead + 1) % LINK_WINDOW);
+            --m_pendCount;
+            m_resend = ((m_resend > 0) ? (m_resend - 1) : 0);
+        }
+    }
+
+    ////////////////////////////////////////
+    // the board can't run anything after a command that never got through,
+    // fail them all and start over
+    void give_up(void)
+    {
+        log_err("link: no ack for [%u] commands after [%u] tries", m_pendCount, LINK_TRIES);
+        while(m_pendCount > 0)
+        {
+            const Pending& pending = m_pending[m_pendHead];
+            if((0 != pending.m_seq) || (MSG_PING != pending.m_msg[0]))
+            {
+                m_ackTag = pending.m_tag;
+                mp_on_ack(pending.m_msg[0], pending.m_msg[1], MP_ACK_FAILED);
+                m_ackTag = 0;
+            }
+            m_pendHead = ((m_pendHead + 1) % LINK_WINDOW);
+            --m_pendCount;
+        }
+        m_seqNext = 0;
+    }
+
+    ////////////////////////////////////////
+    // nothing else goes out until the answer is in, the board's count then
+    // covers everything sent
+    void probe(void)
+    {
+        MsgBuf msgBuf;
+        msgBuf.set_bytes(MSG_READ_REGISTER, REG_LINK_CREDIT, 0x00, 0x00);
+        uint8_t buf[BUS_BUF_COUNT + 1];
+        const uint8_t len = SerialTransport::encode(msgBuf, buf);
+        m_port.write(buf, len);
+        m_link = LINK_SYNC;
+        ++m_probes;
+        m_probeDeadline = (mono_ms_now() + LINK_PROBE_MS);
+    }
+
+    ////////////////////////////////////////
+    // point to point: take the board's count from MSG_CREDIT
+    void credit(MsgBuf& p_msgBuf)
+    {
+        uint8_t type;
+        uint8_t param1;
+        uint8_t param2;
+        uint8_t param3;
+        if(!p_msgBuf.get_bytes(type, param1, param2, param3) || (MSG_CREDIT != type))
+        {
+            return;
+        }
+
+        const uint16_t consumed = ((param1 | (param2 << 8)) & CREDIT_COUNT_MASK);
+        if(CREDIT_SYNC & param2)
+        {
+            if(LINK_CREDIT != m_link)
+            {
+                log_info("link: flow control, [%u] byte window", param3);
+            }
+            // the probe's trailing byte is still in the board's ring
+            m_sent = ((consumed + 1) & CREDIT_COUNT_MASK);
+            m_consumed = consumed;
+            m_window = param3;
+            m_link = LINK_CREDIT;
+            m_probes = 0;
+            return;
+        }
+        if(LINK_CREDIT != m_link)
+        {
+            return;
+        }
+        if(CREDIT_RESTART & param2)
+        {
+            // whatever was in flight is gone, line up again
+            log_notice("link: board restarted");
+            probe();
+            return;
+        }
+
+        m_consumed = consumed;
+        m_window = param3;
+        if(outstanding() > m_window)
+        {
+            log_debug("link: board count [%u] is off from [%u] bytes sent, taking it", consumed, m_sent);
+            m_sent = consumed;
+        }
+    }
+
+    ////////////////////////////////////////
+    void log_stats(const uint64_t p_now)
+    {
+        const uint64_t elapsedMs = (p_now - m_statsStart);
+        const uint64_t bits = ((uint64_t)(m_txChars + m_rxChars) * BUS_BITS_PER_CHAR);
+        const uint32_t permille = ((bits * 1000 * 1000) / (m_baud * elapsedMs));
+        uint8_t online = 0;
+        for(uint8_t i=0; i<m_boardCount; ++i)
+        {
+            online += (m_boards[i].m_online ? 1 : 0);
+        }
+        log_info("bus: [%u/%u] boards online  utilization: [%u.%u%%]  tx: [%u] rx: [%u] chars  stray: [%u]",
+                 online, m_boardCount, (permille / 10), (permille % 10), m_txChars, m_rxChars, m_stray);
+
+        for(uint8_t i=0; i<m_boardCount; ++i)
+        {
+            Board& board = m_boards[i];
+            log_debug("bus: board [0x%02x] %s  polls: [%u]  events: [%u]  missed: [%u]  max latency: [%ums]",
+                      board.m_address, (board.m_online ? "online" : "offline"), board.m_polls, board.m_events, board.m_misses, board.m_maxGapMs);
+            board.m_polls = 0;
+            board.m_events = 0;
+            board.m_misses = 0;
+            board.m_maxGapMs = 0;
+        }
+        static const char* s_classNames[MP_CLASSES] = { "control", "interactive", "background" };
+        for(uint8_t i=0; i<MP_CLASSES; ++i)
+        {
+            const mp_class_stats& stats = m_stats[i];
+            log_debug("bus: class [%s]  frames: [%u]  dropped: [%u]  queued: [%u]  wait avg: [%ums] max: [%ums]",
+                      s_classNames[i], stats.m_frames, stats.m_dropped, m_queues[i].m_count,
+                      ((0 == stats.m_frames) ? 0 : (uint32_t)(stats.m_waitedMs / stats.m_frames)), stats.m_maxWaitMs);
+        }
+        m_statsStart = p_now;
+        m_txChars = 0;
+        m_rxChars = 0;
+        m_stray = 0;
+    }
+};
+
+////////////////////////////////////////////////////////////
+// forwards the engine events to the mp_on_* callbacks in a140808.c
+class CallbackHandler
+{
+public:
+    template<class MP> void on_poll(MP& p_mp)
+    {
+    }
+    template<class MP> void on_pong(MP& p_mp, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
+    {
+        mp_on_pong(p_param1, p_param2, p_param3);
+    }
+    template<class MP> void on_read_register(MP& p_mp, const uint8_t p_registerAddress)
+    {
+        mp_on_read_register(p_registerAddress);
+    }
+    template<class MP> void on_write_register(MP& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask)
+    {
+        mp_on_write_register(p_registerAddress, p_value, p_mask);
+    }
+    template<class MP> void on_write_register_bit(MP& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state)
+    {
+        mp_on_write_register_bit(p_registerAddress, p_bit, p_state);
+    }
+    template<class MP> void on_pulse_register_bit(MP& p_mp, const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs)
+    {
+        mp_on_pulse_register_bit(p_registerAddress, p_bit, p_durationMs);
+    }
+    template<class MP> void on_subscribe_register(MP& p_mp, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
+    {
+        mp_on_subscribe_register(p_registerAddress, p_value, p_cancel);
+    }
+};
+
+typedef MsgProcessorT<BusTransport, CallbackHandler> MsgProcessor;
+
+static uint32_t s_baud = 0;
+static SerialTransport s_serial;
+static BusTransport s_bus(s_serial);
+static CallbackHandler s_callbacks;
+static MsgProcessor s_mp(s_bus, s_callbacks);
+
+// board selected for the mp_dispatch_* calls
+static uint8_t s_selected = BUS_ADDRESS_NONE;
+
+// mp_wait() returns for these too, see mp_wait_fd()
+static struct pollfd s_waitFds[MP_WAIT_FDS];
+static uint8_t s_waitCount = 0;
+
+// port recovery, see SerialTransport
+static uint64_t s_failedAt = 0;   // mono_ms_now(), 0 while the port is up
+static uint64_t s_reopenAt = 0;
+static uint32_t s_backoffMs = SERIAL_REOPEN_MIN_MS;
+static uint32_t s_reopenTries = 0;
+
+// subscriptions in force, sent again after a reopen as the board may have
+// restarted meanwhile
+struct Subscription
+{
+    uint8_t m_address;
+    uint8_t m_register;
+    uint8_t m_value;
+};
+static Subscription s_subs[MP_MAX_SUBS];
+static uint8_t s_subCount = 0;
+
+
+////////////////////////////////////////
+static void remember_subscription(const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
+{
+    uint8_t i = 0;
+    while((i < s_subCount) && ((s_subs[i].m_address != s_selected) || (s_subs[i].m_register != p_registerAddress)))
+    {
+        ++i;
+    }
+    if(p_cancel)
+    {
+        if(i < s_subCount)
+        {
+            s_subs[i] = s_subs[--s_subCount];
+        }
+        return;
+    }
+    if(i == s_subCount)
+    {
+        if(MP_MAX_SUBS == s_subCount)
+        {
+            log_warn("serial: more than [%u] subscriptions, register [0x%02x] is not renewed after a reopen", MP_MAX_SUBS, p_registerAddress);
+            return;
+        }
+        ++s_subCount;
+    }
+    s_subs[i].m_address = s_selected;
+    s_subs[i].m_register = p_registerAddress;
+    s_subs[i].m_value = p_value;
+}
+
+////////////////////////////////////////
+// the port failed, try it again once the backoff is over
+static void recover(void)
+{
+    const uint64_t now = mono_ms_now();
+    if(0 == s_failedAt)
+    {
+        s_failedAt = now;
+        s_reopenAt = (now + SERIAL_REOPEN_MIN_MS);
+        s_backoffMs = SERIAL_REOPEN_MIN_MS;
+        s_reopenTries = 0;
+    }
+    if(now < s_reopenAt)
+    {
+        return;
+    }
+
+    ++s_reopenTries;
+    if(!s_serial.reopen())
+    {
+        s_backoffMs = min((s_backoffMs * 2), (uint32_t)SERIAL_REOPEN_MAX_MS);
+        s_reopenAt = (now + s_backoffMs);
+        return;
+    }
+
+    log_notice("serial: [%s] reopened after [%ums] and [%u] tries, [%u] subscriptions to renew",
+               s_serial.device(), (uint32_t)(now - s_failedAt), s_reopenTries, s_subCount);
+    s_failedAt = 0;
+    s_bus.reopened();
+    if(s_bus.active())
+    {
+        sp_set_rs485(s_serial.fd(), true);
+    }
+    for(uint8_t i=0; i<s_subCount; ++i)
+    {
+        s_mp.select(s_subs[i].m_address);
+        s_mp.dispatch_subscribe_register(s_subs[i].m_register, s_subs[i].m_value, false);
+    }
+    s_mp.select(s_selected);
+}
+
+
+////////////////////////////////////////
+// p_parity
+//   false: N81 (none, 8 data, 1 stop)
+//   true:  E71 (even, 7 data, 1 stop)
+bool mp_init(const char* p_device, const uint32_t p_baud, const bool p_parity)
+{
+    s_baud = p_baud;
+    s_bus.reset();
+    s_selected = BUS_ADDRESS_NONE;
+    s_failedAt = 0;
+    s_subCount = 0;
+    return(s_serial.open(p_device, p_baud, p_parity));
+}
+
+////////////////////////////////////////
+void mp_set_reliable(const bool p_reliable)
+{
+    s_bus.set_reliable(p_reliable);
+}
+
+////////////////////////////////////////
+bool mp_bus_init(const uint8_t* p_addresses, const uint8_t p_count)
+{
+    if(!s_bus.init(p_addresses, p_count, s_baud))
+    {
+        log_err("bus: can not drive [%u] boards, at most [%u]", p_count, BUS_MAX_BOARDS);
+        return(false);
+    }
+    sp_set_rs485(s_serial.fd(), true);  // else the transceiver switches by itself
+    s_selected = s_bus.board(0);
+    s_mp.select(s_selected);
+    return(true);
+}
+
+////////////////////////////////////////
+uint8_t mp_bus_board(const uint8_t p_index)
+{
+    return(s_bus.board(p_index));
+}
+
+////////////////////////////////////////
+void mp_select(const uint8_t p_address)
+{
+    s_selected = p_address;
+    s_mp.select(p_address);
+}
+
+////////////////////////////////////////
+uint8_t mp_rx_address(void)
+{
+    return(s_mp.rx_address());
+}
+
+////////////////////////////////////////
+void mp_set_tag(const uint32_t p_tag)
+{
+    s_bus.set_tag(p_tag);
+}
+
+////////////////////////////////////////
+uint8_t mp_tagged(void)
+{
+    return(s_bus.tagged());
+}
+
+////////////////////////////////////////
+uint32_t mp_rx_tag(void)
+{
+    return(s_bus.ack_tag());
+}
+
+////////////////////////////////////////
+void mp_close(void)
+{
+    s_bus.flush(LINK_CLOSE_MS);
+    s_serial.close();
+}
+
+////////////////////////////////////////
+bool mp_dispatch_ping(const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
+{
+    return(s_mp.dispatch_ping(p_param1, p_param2, p_param3));
+}
+
+////////////////////////////////////////
+bool mp_dispatch_read_register(const uint8_t p_registerAddress)
+{
+    return(s_mp.dispatch_read_register(p_registerAddress));
+}
+
+////////////////////////////////////////
+bool mp_dispatch_write_register(const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask)
+{
+    return(s_mp.dispatch_write_register(p_registerAddress, p_value, p_mask));
+}
+
+////////////////////////////////////////
+bool mp_dispatch_write_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state)
+{
+    return(s_mp.dispatch_write_register_bit(p_registerAddress, p_bit, p_state));
+}
+
+////////////////////////////////////////
+bool mp_dispatch_pulse_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs)
+{
+    return(s_mp.dispatch_pulse_register_bit(p_registerAddress, p_bit, p_durationMs));
+}
+
+////////////////////////////////////////
+bool mp_dispatch_subscribe_register(const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
+{
+    remember_subscription(p_registerAddress, p_value, p_cancel);
+    return(s_mp.dispatch_subscribe_register(p_registerAddress, p_value, p_cancel));
+}
+
+////////////////////////////////////////
+bool mp_dispatch_message(const uint8_t p_type, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3)
+{
+    if(MSG_SUBSCRIBE_REGISTER == p_type)
+    {
+        remember_subscription(p_param1, p_param2, (0 != p_param3));
+    }
+    return(s_mp.dispatch_message(p_type, p_param1, p_param2, p_param3));
+}
+
+////////////////////////////////////////
+void mp_burst_begin(void)
+{
+    s_serial.burst_begin();
+}
+
+////////////////////////////////////////
+bool mp_burst_end(void)
+{
+    return(s_serial.burst_end());
+}
+
+////////////////////////////////////////
+bool mp_get_class_stats(const uint8_t p_class, mp_class_stats* p_stats)
+{
+    if(p_class >= MP_CLASSES)
+    {
+        return(false);
+    }
+    s_bus.class_stats(p_class, p_stats);
+    return(true);
+}
+
+////////////////////////////////////////
+bool mp_wait_fd(const int p_fd, const short p_events)
+{
+    uint8_t i = 0;
+    while((i < s_waitCount) && (s_waitFds[i].fd != p_fd))
+    {
+        ++i;
+    }
+    if(0 == p_events)
+    {
+        if(i < s_waitCount)
+        {
+            s_waitFds[i] = s_waitFds[--s_waitCount];
+        }
+        return(true);
+    }
+    if(i == s_waitCount)
+    {
+        if(MP_WAIT_FDS == s_waitCount)
+        {
+            log_err("serial: more than [%u] descriptors to wait on, [%d] is not", MP_WAIT_FDS, p_fd);
+            return(false);
+        }
+        ++s_waitCount;
+    }
+    s_waitFds[i].fd = p_fd;
+    s_waitFds[i].events = p_events;
+    s_waitFds[i].revents = 0;
+    return(true);
+}
+
+////////////////////////////////////////
+void mp_wait(const uint32_t p_maxMs)
+{
+    if(s_serial.pending())
+    {
+        return;
+    }
+    // poll() skips a negative fd
+    struct pollfd pfds[1 + MP_WAIT_FDS] = { { s_serial.fd(), POLLIN, 0 } };
+    memcpy(&pfds[1], s_waitFds, (sizeof(struct pollfd) * s_waitCount));
+    const nfds_t count = (1 + s_waitCount);
+    if(s_serial.failed())
+    {
+        // nothing to wait on but the next reopen
+        const uint64_t now = mono_ms_now();
+        pfds[0].fd = -1;
+        poll(pfds, count, ((0 == s_failedAt) ? 0 : ((s_reopenAt > now) ? min((uint32_t)(s_reopenAt - now), p_maxMs) : 0)));
+        return;
+    }
+    poll(pfds, count, s_bus.wait_ms(p_maxMs));
+}
+
+////////////////////////////////////////
+void mp_poll(void)
+{
+    if(s_serial.failed())
+    {
+        recover();
+        return;
+    }
+    // everything that came in, and the bus keeps going in between
+    do
+    {
+        s_mp.poll();
+    } while(s_serial.pending());
+    s_bus.pump();
+}
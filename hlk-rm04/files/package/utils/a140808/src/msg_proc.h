@@ -22,30 +22,42 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-// top level messages
-#define MSG_PING                 0x01
-#define MSG_PONG                 0x02
-#define MSG_READ_REGISTER        0x11
-#define MSG_WRITE_REGISTER       0x21
-#define MSG_WRITE_REGISTER_BIT   0x31
-#define MSG_PULSE_REGISTER_BIT   0x41
-#define MSG_SUBSCRIBE_REGISTER   0x51
-// register defs
-#define REG_ERR_UNKNOWN          0x9F
-#define REG_INPUT_1              0xA1
-#define REG_OUTPUT_1             0xD1
-
-// event callbacks, impl by avr_impl.cpp right now
+#include "msg_defs.h"  // MSG_*, REG_*, shared with the avr firmware
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// event callbacks, impl by a140808.c
 void mp_on_pong(const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3);
 void mp_on_read_register(const uint8_t p_registerAddress);
 void mp_on_write_register(const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask);
 void mp_on_write_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state);
 void mp_on_pulse_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs);
 void mp_on_subscribe_register(const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel);
+// a reliable command got through, ACK_* (msg_defs.h), or MP_ACK_FAILED
+#define MP_ACK_FAILED  0xFF
+void mp_on_ack(const uint8_t p_type, const uint8_t p_registerAddress, const uint8_t p_status);
+// a frame with a tag (mp_set_tag()) went on the wire, mp_on_ack() follows for it when p_acked
+void mp_on_sent(const uint32_t p_tag, const bool p_acked);
 
 //
-bool mp_init(const char* p_device, const uint16_t p_baud, const bool p_parity);
+bool mp_init(const char* p_device, const uint32_t p_baud, const bool p_parity);
 void mp_close(void);
+// point to point: send relay commands numbered and acknowledged, retried if
+// lost, when the board's firmware has it
+void mp_set_reliable(const bool p_reliable);
+// multi-drop rs485 bus of boards at p_addresses, point to point without it.
+// the first board is selected
+#define BUS_MAX_BOARDS  32
+bool mp_bus_init(const uint8_t* p_addresses, const uint8_t p_count);
+uint8_t mp_bus_board(const uint8_t p_index);  // BUS_ADDRESS_NONE past the last board
+void mp_select(const uint8_t p_address);      // board for the following mp_dispatch_* calls
+uint8_t mp_rx_address(void);                  // board of the event in an mp_on_* callback
+// the frames of the following mp_dispatch_* calls carry p_tag, 0 for none
+void mp_set_tag(const uint32_t p_tag);
+uint8_t mp_tagged(void);                      // frames queued since mp_set_tag()
+uint32_t mp_rx_tag(void);                     // tag of the command in an mp_on_ack() callback
 bool mp_dispatch_ping(const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3);
 bool mp_dispatch_read_register(const uint8_t p_registerAddress);
 bool mp_dispatch_write_register(const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask);
@@ -53,6 +65,35 @@ bool mp_dispatch_write_register_bit(const uint8_t p_registerAddress, const uint8
 bool mp_dispatch_pulse_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs);
 bool mp_dispatch_subscribe_register(const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel);
 bool mp_dispatch_message(const uint8_t p_type, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3);
+// the frames of the mp_dispatch_* calls in between go out in one write,
+// false if it failed
+void mp_burst_begin(void);
+bool mp_burst_end(void);
+// the frames go out by class, relay and register writes ahead of reads and
+// subscriptions ahead of the rest, each class queued on its own. the counts
+// run from the start, the time waited is from the mp_dispatch_* call to the wire
+#define MP_CLASS_CONTROL      0  // write register, write register bit, pulse register bit
+#define MP_CLASS_INTERACTIVE  1  // read register, subscribe register
+#define MP_CLASS_BACKGROUND   2  // ping and the rest
+#define MP_CLASSES            3
+typedef struct mp_class_stats
+{
+    uint32_t m_frames;     // sent
+    uint32_t m_dropped;    // the class queue was full
+    uint32_t m_queued;     // waiting now
+    uint32_t m_maxWaitMs;
+    uint64_t m_waitedMs;   // sum over m_frames
+} mp_class_stats;
+bool mp_get_class_stats(const uint8_t p_class, mp_class_stats* p_stats);
+void mp_wait(const uint32_t p_maxMs);  // for input or the bus, at most p_maxMs
+// other descriptors mp_wait() returns for, p_events as for poll(2), 0 to
+// drop p_fd again. false if MP_WAIT_FDS are in use
+#define MP_WAIT_FDS  4
+bool mp_wait_fd(const int p_fd, const short p_events);
 void mp_poll(void);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // __msg_proc_h__
@@ -0,0 +1,237 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#include "global.h"
+#include "msg_proc.h"
+#include "regcache.h"
+
+
+// the registers kept current by a standing subscription
+static const uint8_t s_watched[] = { REG_INPUT_1, REG_OUTPUT_1 };
+#define WATCHED_COUNT  (sizeof(s_watched) / sizeof(s_watched[0]))
+// and the ones read once
+static const uint8_t s_constant[] = { REG_FW_VERSION, REG_FW_CAPS };
+#define CONSTANT_COUNT  (sizeof(s_constant) / sizeof(s_constant[0]))
+
+typedef struct
+{
+    uint8_t m_board;
+    uint8_t m_register;
+    uint8_t m_value;
+    bool m_known;        // m_value is the board's
+    bool m_subscribed;   // and the board tells each change, or it never changes
+    uint64_t m_updated;  // mono_ms_now() of m_value
+} rc_entry;
+
+static rc_entry s_entries[RC_MAX_ENTRIES];
+static uint8_t s_count = 0;
+
+
+////////////////////////////////////////
+static rc_entry* find(const uint8_t p_board, const uint8_t p_registerAddress)
+{
+    for(uint8_t i=0; i<s_count; ++i)
+    {
+        if((s_entries[i].m_board == p_board) && (s_entries[i].m_register == p_registerAddress))
+        {
+            return(&s_entries[i]);
+        }
+    }
+    return(NULL);
+}
+
+////////////////////////////////////////
+// a new entry, when full the oldest one not subscribed makes room
+static rc_entry* add(const uint8_t p_board, const uint8_t p_registerAddress)
+{
+    rc_entry* pentry = NULL;
+    if(s_count < RC_MAX_ENTRIES)
+    {
+        pentry = &s_entries[s_count++];
+    }
+    else
+    {
+        for(uint8_t i=0; i<s_count; ++i)
+        {
+            if(!s_entries[i].m_subscribed && ((NULL == pentry) || (s_entries[i].m_updated < pentry->m_updated)))
+            {
+                pentry = &s_entries[i];
+            }
+        }
+        if(NULL == pentry)
+        {
+            log_warn("regcache: [%d] subscribed registers, board: [0x%02x] register: [0x%02x] not cached", RC_MAX_ENTRIES, p_board, p_registerAddress);
+            return(NULL);
+        }
+    }
+    pentry->m_board = p_board;
+    pentry->m_register = p_registerAddress;
+    pentry->m_known = false;
+    pentry->m_subscribed = false;
+    return(pentry);
+}
+
+
+////////////////////////////////////////
+static bool is_constant(const uint8_t p_registerAddress)
+{
+    for(uint8_t r=0; r<CONSTANT_COUNT; ++r)
+    {
+        if(s_constant[r] == p_registerAddress)
+        {
+            return(true);
+        }
+    }
+    return(false);
+}
+
+////////////////////////////////////////
+void rc_watch(void)
+{
+    mp_burst_begin();
+    for(uint8_t i=0; ; ++i)
+    {
+        const uint8_t board = mp_bus_board(i);
+        if((BUS_ADDRESS_NONE == board) && (i > 0))
+        {
+            break;  // point to point is the one unaddressed board
+        }
+        mp_select(board);
+        for(uint8_t r=0; r<WATCHED_COUNT; ++r)
+        {
+            if(!mp_dispatch_subscribe_register(s_watched[r], 0, false))
+            {
+                log_err("rc_watch: subscribe failed - board: [0x%02x] register: [0x%02x]", board, s_watched[r]);
+            }
+        }
+        for(uint8_t r=0; r<CONSTANT_COUNT; ++r)
+        {
+            if(!mp_dispatch_read_register(s_constant[r]))
+            {
+                log_err("rc_watch: read failed - board: [0x%02x] register: [0x%02x]", board, s_constant[r]);
+            }
+        }
+        if(BUS_ADDRESS_NONE == board)
+        {
+            break;
+        }
+    }
+    mp_burst_end();
+    mp_select(mp_bus_board(0));
+}
+
+////////////////////////////////////////
+bool rc_is_watched(const uint8_t p_registerAddress)
+{
+    for(uint8_t r=0; r<WATCHED_COUNT; ++r)
+    {
+        if(s_watched[r] == p_registerAddress)
+        {
+            return(true);
+        }
+    }
+    return(false);
+}
+
+////////////////////////////////////////
+void rc_update(const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_subscribed)
+{
+    rc_entry* pentry = find(p_board, p_registerAddress);
+    if(NULL == pentry)
+    {
+        pentry = add(p_board, p_registerAddress);
+        if(NULL == pentry)
+        {
+            return;
+        }
+    }
+    pentry->m_value = p_value;
+    pentry->m_known = true;
+    pentry->m_subscribed |= (p_subscribed || is_constant(p_registerAddress));  // a read answer leaves it as it is
+    pentry->m_updated = mono_ms_now();
+}
+
+////////////////////////////////////////
+void rc_unsubscribed(const uint8_t p_board, const uint8_t p_registerAddress)
+{
+    rc_entry* pentry = find(p_board, p_registerAddress);
+    if(NULL != pentry)
+    {
+        pentry->m_subscribed = false;
+    }
+}
+
+////////////////////////////////////////
+void rc_write(const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask)
+{
+    const uint64_t now = mono_ms_now();
+    for(uint8_t i=0; i<s_count; ++i)
+    {
+        rc_entry* pentry = &s_entries[i];
+        if(pentry->m_known && (pentry->m_register == p_registerAddress) &&
+           ((pentry->m_board == p_board) || (BUS_ADDRESS_BROADCAST == p_board)))
+        {
+            pentry->m_value = ((pentry->m_value & ~p_mask) | (p_value & p_mask));
+            pentry->m_updated = now;
+        }
+    }
+}
+
+////////////////////////////////////////
+void rc_forget(const uint8_t p_board, const uint8_t p_registerAddress)
+{
+    rc_entry* pentry = find(p_board, p_registerAddress);
+    if(NULL != pentry)
+    {
+        pentry->m_known = false;
+    }
+}
+
+////////////////////////////////////////
+bool rc_get(const uint8_t p_board, const uint8_t p_registerAddress, uint8_t* p_value, uint32_t* p_ageMs)
+{
+    const rc_entry* pentry = find(p_board, p_registerAddress);
+    if((NULL == pentry) || !pentry->m_known || !pentry->m_subscribed)
+    {
+        return(false);
+    }
+    *p_value = pentry->m_value;
+    *p_ageMs = (uint32_t)(mono_ms_now() - pentry->m_updated);
+    return(true);
+}
+
+////////////////////////////////////////
+uint8_t rc_snapshot(rc_value* p_values, const uint8_t p_max)
+{
+    const uint64_t now = mono_ms_now();
+    uint8_t count = 0;
+    for(uint8_t i=0; (i < s_count) && (count < p_max); ++i)
+    {
+        const rc_entry* pentry = &s_entries[i];
+        if(pentry->m_known && pentry->m_subscribed)
+        {
+            p_values[count].m_board = pentry->m_board;
+            p_values[count].m_register = pentry->m_register;
+            p_values[count].m_value = pentry->m_value;
+            p_values[count].m_ageMs = (uint32_t)(now - pentry->m_updated);
+            ++count;
+        }
+    }
+    return(count);
+}
@@ -0,0 +1,67 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __regcache_h__
+#define __regcache_h__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// daemon side shadow of the board registers, so a read is answered without
+// a serial round trip
+//
+// rc_watch() subscribes to the watched registers (REG_INPUT_1, REG_OUTPUT_1)
+// on every board and the subscription events keep them current, the
+// daemon's own writes are applied as they go out. a register is current
+// while its subscription stands, after a cancel or an undelivered write
+// rc_get() sends the reader to the board. the registers that never change
+// (REG_FW_VERSION, REG_FW_CAPS) are read once and current from then on
+//
+
+#define RC_MAX_ENTRIES  64  // board and register pairs
+
+typedef struct
+{
+    uint8_t m_board;
+    uint8_t m_register;
+    uint8_t m_value;
+    uint32_t m_ageMs;
+} rc_value;
+
+// subscribe to the watched registers and read the constant ones on every
+// board, at start up
+void rc_watch(void);
+bool rc_is_watched(const uint8_t p_registerAddress);
+
+// a value from the board, a read answer or a subscription event
+void rc_update(const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_subscribed);
+// the subscription is gone, the value ages from here
+void rc_unsubscribed(const uint8_t p_board, const uint8_t p_registerAddress);
+// a write the daemon sent, p_board BUS_ADDRESS_BROADCAST for all of them.
+// only a register with a known value takes it
+void rc_write(const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask);
+// the write never arrived, the board's value is unknown
+void rc_forget(const uint8_t p_board, const uint8_t p_registerAddress);
+
+// the value and its age when it is current, false to ask the board
+bool rc_get(const uint8_t p_board, const uint8_t p_registerAddress, uint8_t* p_value, uint32_t* p_ageMs);
+// every current value, at most p_max, the count
+uint8_t rc_snapshot(rc_value* p_values, const uint8_t p_max);
+
+#endif // __regcache_h__
@@ -0,0 +1,239 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#include <string.h>  // memmove, memset, strcmp, strncpy
+
+#include "global.h"
+#include "results.h"
+
+
+typedef struct
+{
+    uint32_t m_tag;        // 0: free
+    char m_id[DD_ID_LEN + 1];
+    dd_result m_result;
+    uint64_t m_startUs;    // mono_us_now()
+    bool m_ended;          // rs_end() was called, no more frames to come
+    uint8_t m_frames;      // queued
+    uint8_t m_sent;
+    uint8_t m_acks;        // to come for the frames sent
+} rs_request;
+
+static rs_request s_running[RS_MAX_RUNNING];
+static rs_done s_done[RS_MAX_DONE];
+static uint8_t s_doneCount = 0;
+
+static const char* s_reasons[RS_REASONS] =
+{
+    "", "invalid", "unknown command", "bad arguments", "not a command",
+    "serial error", "not delivered", "rejected", "timed out",
+};
+
+
+////////////////////////////////////////
+static rs_request* find(const uint32_t p_tag)
+{
+    for(uint8_t i=0; (0 != p_tag) && (i<RS_MAX_RUNNING); ++i)
+    {
+        if(p_tag == s_running[i].m_tag)
+        {
+            return(&s_running[i]);
+        }
+    }
+    return(NULL);
+}
+
+////////////////////////////////////////
+static int32_t elapsed_us(const rs_request* p_request)
+{
+    const uint64_t us = (mono_us_now() - p_request->m_startUs);
+    return((us > INT32_MAX) ? INT32_MAX : (int32_t)us);
+}
+
+////////////////////////////////////////
+static void flush(void)
+{
+    if((s_doneCount > 0) && rs_on_done(s_done, s_doneCount))
+    {
+        s_doneCount = 0;
+    }
+}
+
+////////////////////////////////////////
+static void add_done(const char* p_id, const dd_result* p_result, const bool p_replayed, const uint32_t p_tag)
+{
+    if(RS_MAX_DONE == s_doneCount)
+    {
+        flush();
+    }
+    if(RS_MAX_DONE == s_doneCount)
+    {
+        log_err("results: [%u] not sent, dropping the result of request: [%s]", s_doneCount, s_done[0].m_id);
+        memmove(&s_done[0], &s_done[1], (sizeof(s_done[0]) * (RS_MAX_DONE - 1)));
+        --s_doneCount;
+    }
+    rs_done* pdone = &s_done[s_doneCount++];
+    strcpy(pdone->m_id, p_id);
+    pdone->m_result = *p_result;
+    pdone->m_replayed = p_replayed;
+    pdone->m_tag = p_tag;
+}
+
+////////////////////////////////////////
+static void finish(rs_request* p_request, const uint8_t p_status, const uint8_t p_reason)
+{
+    if(DD_OK == p_request->m_result.m_status)
+    {
+        p_request->m_result.m_status = p_status;
+        p_request->m_result.m_reason = p_reason;
+    }
+    log_debug("results: request: [%s] status: [%u] [%s]", p_request->m_id, p_request->m_result.m_status, s_reasons[p_request->m_result.m_reason]);
+    dd_add(p_request->m_id, &p_request->m_result);
+    add_done(p_request->m_id, &p_request->m_result, false, p_request->m_tag);
+    p_request->m_tag = 0;
+}
+
+////////////////////////////////////////
+// done when it failed or all of it is through
+static void check(rs_request* p_request)
+{
+    if(p_request->m_ended && ((DD_OK != p_request->m_result.m_status) ||
+       ((p_request->m_sent >= p_request->m_frames) && (0 == p_request->m_acks))))
+    {
+        finish(p_request, DD_OK, RS_REASON_NONE);
+    }
+}
+
+////////////////////////////////////////
+void rs_begin(const char* p_id, const uint32_t p_tag)
+{
+    rs_request* prequest = NULL;
+    for(uint8_t i=0; i<RS_MAX_RUNNING; ++i)
+    {
+        rs_request* pnext = &s_running[i];
+        if((NULL == prequest) || (0 == pnext->m_tag) ||
+           ((0 != prequest->m_tag) && (pnext->m_startUs < prequest->m_startUs)))
+        {
+            prequest = pnext;
+        }
+    }
+    if(0 != prequest->m_tag)
+    {
+        log_err("results: [%u] requests running, request: [%s] gives up", RS_MAX_RUNNING, prequest->m_id);
+        finish(prequest, DD_FAILED, RS_REASON_TIMEOUT);
+    }
+
+    memset(prequest, 0, sizeof(*prequest));
+    prequest->m_tag = p_tag;
+    strncpy(prequest->m_id, p_id, DD_ID_LEN);
+    prequest->m_result.m_status = DD_OK;
+    prequest->m_result.m_reason = RS_REASON_NONE;
+    prequest->m_result.m_receivedMs = date_ms_now();
+    prequest->m_result.m_txUs = -1;
+    prequest->m_result.m_ackUs = -1;
+    prequest->m_startUs = mono_us_now();
+}
+
+////////////////////////////////////////
+bool rs_running(const char* p_id)
+{
+    for(uint8_t i=0; i<RS_MAX_RUNNING; ++i)
+    {
+        if((0 != s_running[i].m_tag) && (0 == strncmp(p_id, s_running[i].m_id, DD_ID_LEN)))
+        {
+            return(true);
+        }
+    }
+    return(false);
+}
+
+////////////////////////////////////////
+void rs_end(const uint32_t p_tag, const uint8_t p_status, const uint8_t p_reason, const uint8_t p_frames)
+{
+    rs_request* prequest = find(p_tag);
+    if(NULL == prequest)
+    {
+        return;
+    }
+    prequest->m_result.m_status = p_status;
+    prequest->m_result.m_reason = p_reason;
+    prequest->m_frames = p_frames;
+    prequest->m_ended = true;
+    check(prequest);
+}
+
+////////////////////////////////////////
+void rs_sent(const uint32_t p_tag, const bool p_acked)
+{
+    rs_request* prequest = find(p_tag);
+    if(NULL == prequest)
+    {
+        return;  // failed already
+    }
+    prequest->m_result.m_txUs = elapsed_us(prequest);
+    ++prequest->m_sent;
+    prequest->m_acks += (p_acked ? 1 : 0);
+    check(prequest);
+}
+
+////////////////////////////////////////
+void rs_acked(const uint32_t p_tag, const uint8_t p_reason)
+{
+    rs_request* prequest = find(p_tag);
+    if(NULL == prequest)
+    {
+        return;
+    }
+    prequest->m_result.m_ackUs = elapsed_us(prequest);
+    prequest->m_acks -= ((prequest->m_acks > 0) ? 1 : 0);
+    if(RS_REASON_NONE != p_reason)
+    {
+        finish(prequest, DD_FAILED, p_reason);
+        return;
+    }
+    check(prequest);
+}
+
+////////////////////////////////////////
+void rs_replay(const char* p_id, const dd_result* p_result)
+{
+    add_done(p_id, p_result, true, 0);
+}
+
+////////////////////////////////////////
+const char* rs_reason(const uint8_t p_reason)
+{
+    return((p_reason < RS_REASONS) ? s_reasons[p_reason] : "");
+}
+
+////////////////////////////////////////
+void rs_poll(void)
+{
+    const uint64_t now = mono_us_now();
+    for(uint8_t i=0; i<RS_MAX_RUNNING; ++i)
+    {
+        rs_request* prequest = &s_running[i];
+        if((0 != prequest->m_tag) && ((now - prequest->m_startUs) >= ((uint64_t)RS_ANSWER_MS * 1000)))
+        {
+            log_err("results: request: [%s] not through in [%ums], [%u/%u] frames sent", prequest->m_id, RS_ANSWER_MS, prequest->m_sent, prequest->m_frames);
+            finish(prequest, DD_FAILED, RS_REASON_TIMEOUT);
+        }
+    }
+    flush();
+}
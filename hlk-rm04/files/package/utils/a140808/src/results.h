@@ -0,0 +1,81 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#ifndef __results_h__
+#define __results_h__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "dedup.h"
+
+//
+// the result of each request (["req","<id>",<command>]), told the server
+// once the board has it: what the command came to, why when it failed,
+// and when it went on the wire and was acked. the frames of a request go
+// out tagged (mp_set_tag()) and msg_proc reports each one sent and acked.
+// finished results wait for rs_poll() and go out together, so the requests
+// of one burst cost the server one message
+//
+
+#define RS_MAX_RUNNING  16     // requests waiting on the board, the oldest fails for a new one past it
+#define RS_MAX_DONE     16     // results waiting to be sent, the most in one message
+#define RS_ANSWER_MS    5000   // a request the board has not taken by then fails
+
+#define RS_REASON_NONE           0
+#define RS_REASON_INVALID        1  // did not check out
+#define RS_REASON_UNKNOWN        2  // no such command
+#define RS_REASON_ARGUMENTS      3  // the arguments did not check out
+#define RS_REASON_PARSE          4  // not a command at all
+#define RS_REASON_SERIAL         5  // the serial layer refused it
+#define RS_REASON_NOT_DELIVERED  6  // never acked after all the tries
+#define RS_REASON_REJECTED       7  // the board acked it with an error
+#define RS_REASON_TIMEOUT        8  // not through in RS_ANSWER_MS
+#define RS_REASONS               9
+
+typedef struct
+{
+    char m_id[DD_ID_LEN + 1];
+    dd_result m_result;
+    bool m_replayed;       // it had run already and was not run again
+    uint32_t m_tag;        // it ran under, 0 for a replay
+} rs_done;
+
+// the results finished since the last call, false when they can't be sent
+// now (they are offered again), impl by a140808.c
+bool rs_on_done(const rs_done* p_done, const uint8_t p_count);
+
+// request p_id came in, its frames go out tagged p_tag (trace.h)
+void rs_begin(const char* p_id, const uint32_t p_tag);
+// p_id came in and is not done yet
+bool rs_running(const char* p_id);
+// request p_tag ran and p_frames of it were queued, a status other than
+// DD_OK is final. done when the frames are sent and acked
+void rs_end(const uint32_t p_tag, const uint8_t p_status, const uint8_t p_reason, const uint8_t p_frames);
+// a frame of p_tag on the wire, an ack follows if p_acked
+void rs_sent(const uint32_t p_tag, const bool p_acked);
+// the ack of a frame of p_tag, RS_REASON_NONE when it got through
+void rs_acked(const uint32_t p_tag, const uint8_t p_reason);
+// the result request p_id had, from dd_find()
+void rs_replay(const char* p_id, const dd_result* p_result);
+const char* rs_reason(const uint8_t p_reason);
+// times out the requests the board never took and sends the results, from the worker loop
+void rs_poll(void);
+
+#endif // __results_h__
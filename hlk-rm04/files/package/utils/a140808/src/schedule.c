@@ -0,0 +1,302 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#include <stdio.h>   // rename
+#include <string.h>  // memcpy
+#include <fcntl.h>
+#include <sys/timerfd.h>
+
+#include "global.h"
+#include "schedule.h"
+
+
+#define SC_MAGIC  0x53433031  // SC01
+
+typedef struct
+{
+    uint32_t m_magic;
+    uint32_t m_nextId;
+    uint32_t m_count;    // sc_job's after the header
+} sc_header;
+
+typedef struct
+{
+    uint64_t m_atUs;     // monotonic
+    sc_job m_job;
+} sc_entry;
+
+// a min heap by m_atUs
+static sc_entry s_heap[SC_MAX_JOBS];
+static uint8_t s_count = 0;
+static uint32_t s_nextId = 1;
+static int s_fd = -1;
+static char s_path[64] = { 0 };
+
+
+////////////////////////////////////////
+// p_dueMs on the wall clock, on the monotonic clock
+static uint64_t monotonic_at(const uint64_t p_dueMs)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    const uint64_t now = mono_us_now();
+    const int64_t inUs = ((int64_t)(p_dueMs * 1000) - (((int64_t)tv.tv_sec * 1000000) + tv.tv_usec));
+    return(((inUs < 0) && ((uint64_t)-inUs > now)) ? 0 : (now + inUs));
+}
+
+////////////////////////////////////////
+static void swap(const uint8_t p_a, const uint8_t p_b)
+{
+    const sc_entry entry = s_heap[p_a];
+    s_heap[p_a] = s_heap[p_b];
+    s_heap[p_b] = entry;
+}
+
+////////////////////////////////////////
+static void sift_up(uint8_t p_at)
+{
+    while((p_at > 0) && (s_heap[p_at].m_atUs < s_heap[(p_at - 1) / 2].m_atUs))
+    {
+        swap(p_at, ((p_at - 1) / 2));
+        p_at = ((p_at - 1) / 2);
+    }
+}
+
+////////////////////////////////////////
+static void sift_down(uint8_t p_at)
+{
+    for(;;)
+    {
+        uint8_t first = p_at;
+        for(uint8_t child = ((2 * p_at) + 1); (child <= ((2 * p_at) + 2)) && (child < s_count); ++child)
+        {
+            if(s_heap[child].m_atUs < s_heap[first].m_atUs)
+            {
+                first = child;
+            }
+        }
+        if(first == p_at)
+        {
+            return;
+        }
+        swap(p_at, first);
+        p_at = first;
+    }
+}
+
+////////////////////////////////////////
+static void remove_at(const uint8_t p_at)
+{
+    s_heap[p_at] = s_heap[--s_count];
+    if(p_at < s_count)
+    {
+        sift_up(p_at);
+        sift_down(p_at);
+    }
+}
+
+////////////////////////////////////////
+static void push(const uint64_t p_atUs, const sc_job* p_job)
+{
+    s_heap[s_count].m_atUs = p_atUs;
+    s_heap[s_count].m_job = *p_job;
+    sift_up(s_count++);
+}
+
+////////////////////////////////////////
+// for the first job, disarmed without one
+static void arm(void)
+{
+    if(s_fd < 0)
+    {
+        return;
+    }
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if(s_count > 0)
+    {
+        // 0 would disarm it, a job already due goes at the next nanosecond
+        const uint64_t atUs = max(s_heap[0].m_atUs, (uint64_t)1);
+        its.it_value.tv_sec = (atUs / 1000000);
+        its.it_value.tv_nsec = ((atUs % 1000000) * 1000);
+    }
+    if(0 != timerfd_settime(s_fd, TFD_TIMER_ABSTIME, &its, NULL))
+    {
+        log_err("sc arm: timerfd_settime, err: [%s]", strerror(errno));
+    }
+}
+
+////////////////////////////////////////
+// the pending jobs, written aside and renamed over so a crash mid write
+// leaves the last complete file
+static void save(void)
+{
+    if('\0' == s_path[0])
+    {
+        return;
+    }
+    char path[sizeof(s_path) + 4];
+    snprintf(path, sizeof(path), "%s.new", s_path);
+    FILE* pf = fopen(path, "w");
+    if(NULL == pf)
+    {
+        log_err("sc save: [%s], err: [%s]", path, strerror(errno));
+        return;
+    }
+    const sc_header header = { SC_MAGIC, s_nextId, s_count };
+    bool ok = (1 == fwrite(&header, sizeof(header), 1, pf));
+    for(uint8_t i=0; ok && (i < s_count); ++i)
+    {
+        ok = (1 == fwrite(&s_heap[i].m_job, sizeof(sc_job), 1, pf));
+    }
+    if((0 != fclose(pf)) || !ok || (0 != rename(path, s_path)))
+    {
+        log_err("sc save: [%s], err: [%s]", s_path, strerror(errno));
+        unlink(path);
+    }
+}
+
+////////////////////////////////////////
+static void load(void)
+{
+    FILE* pf = fopen(s_path, "r");
+    if(NULL == pf)
+    {
+        return;  // nothing kept
+    }
+    sc_header header;
+    if((1 != fread(&header, sizeof(header), 1, pf)) || (SC_MAGIC != header.m_magic) || (header.m_count > SC_MAX_JOBS))
+    {
+        log_warn("sc_open: [%s] not a schedule, starting over", s_path);
+        fclose(pf);
+        return;
+    }
+    sc_job job;
+    while((s_count < header.m_count) && (1 == fread(&job, sizeof(job), 1, pf)))
+    {
+        job.m_name[SC_NAME_LEN - 1] = '\0';
+        push(monotonic_at(job.m_dueMs), &job);
+    }
+    fclose(pf);
+    s_nextId = max(header.m_nextId, (uint32_t)1);
+}
+
+
+////////////////////////////////////////
+bool sc_open(const char* p_path)
+{
+    s_count = 0;
+    s_nextId = 1;
+    snprintf(s_path, sizeof(s_path), "%s", p_path);
+    load();
+
+    s_fd = timerfd_create(CLOCK_MONOTONIC, (TFD_NONBLOCK | TFD_CLOEXEC));
+    if(s_fd < 0)
+    {
+        log_err("sc_open: timerfd_create, err: [%s]", strerror(errno));
+    }
+    arm();
+    log_notice("sc_open: [%s] jobs: [%u] next id: [%u]", s_path, s_count, s_nextId);
+    return(s_fd >= 0);
+}
+
+////////////////////////////////////////
+void sc_close(void)
+{
+    if(s_fd >= 0)
+    {
+        close(s_fd);
+        s_fd = -1;
+    }
+    s_count = 0;
+    s_path[0] = '\0';
+}
+
+////////////////////////////////////////
+int sc_fd(void)
+{
+    return(s_fd);
+}
+
+////////////////////////////////////////
+uint32_t sc_add(const sc_job* p_job)
+{
+    if(SC_MAX_JOBS == s_count)
+    {
+        log_err("sc_add: [%s] refused, [%u] jobs pending", p_job->m_name, s_count);
+        return(0);
+    }
+    sc_job job = *p_job;
+    job.m_id = s_nextId;
+    job.m_name[SC_NAME_LEN - 1] = '\0';
+    s_nextId = ((UINT32_MAX == s_nextId) ? 1 : (s_nextId + 1));
+    push(monotonic_at(job.m_dueMs), &job);
+    save();
+    arm();
+    return(job.m_id);
+}
+
+////////////////////////////////////////
+bool sc_cancel(const uint32_t p_id)
+{
+    for(uint8_t i=0; i<s_count; ++i)
+    {
+        if(p_id == s_heap[i].m_job.m_id)
+        {
+            remove_at(i);
+            save();
+            arm();
+            return(true);
+        }
+    }
+    return(false);
+}
+
+////////////////////////////////////////
+uint8_t sc_count(void)
+{
+    return(s_count);
+}
+
+////////////////////////////////////////
+void sc_poll(void)
+{
+    if((0 == s_count) || (s_heap[0].m_atUs > mono_us_now()))
+    {
+        return;
+    }
+    if(s_fd >= 0)
+    {
+        uint64_t expirations;
+        if(read(s_fd, &expirations, sizeof(expirations)) < 0)
+        {
+            // not expired yet when the loop got here first
+        }
+    }
+
+    // taken off before it runs, sc_on_due() may add another
+    uint64_t now;
+    while((s_count > 0) && (s_heap[0].m_atUs <= (now = mono_us_now())))
+    {
+        const sc_entry entry = s_heap[0];
+        remove_at(0);
+        sc_on_due(&entry.m_job, (int64_t)(now - entry.m_atUs));
+    }
+    save();
+    arm();
+}
@@ -0,0 +1,67 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+#ifndef __schedule_h__
+#define __schedule_h__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cmd_table.h"  // CT_MAX_ARGS
+
+//
+// commands run by the daemon at a set time rather than when the cloud
+// sends them, so internet jitter and outages do not move them. the jobs
+// are kept in a heap by their due time on the monotonic clock, a timerfd
+// armed for the first one wakes the worker loop (mp_wait_fd()) when it is
+// due
+//
+// every change is written to a file (on tmpfs, like the journal), the
+// jobs a restarted daemon finds there are put back by their wall clock
+// time, the ones already past are due at once
+//
+
+#define SC_MAX_JOBS  32
+#define SC_NAME_LEN  24
+
+typedef struct
+{
+    uint32_t m_id;                // given by sc_add()
+    uint64_t m_dueMs;             // epoch ms, the wall clock
+    char m_name[SC_NAME_LEN];     // of the command, see cmd_table.h
+    uint8_t m_given;              // bit per argument, clear for a missing optional one
+    int32_t m_args[CT_MAX_ARGS];  // CT_INT only
+} sc_job;
+
+// a job is due, p_lateUs past its time. impl by a140808.c
+void sc_on_due(const sc_job* p_job, const int64_t p_lateUs);
+
+// the jobs kept at p_path by the last run are put back, false without a
+// timerfd: the jobs are then only as precise as the worker loop
+bool sc_open(const char* p_path);
+void sc_close(void);
+int sc_fd(void);  // readable when a job is due, -1 without one
+
+// the job's id, 0 when the schedule is full
+uint32_t sc_add(const sc_job* p_job);
+bool sc_cancel(const uint32_t p_id);  // false if it is not pending
+uint8_t sc_count(void);
+// runs the jobs that are due, sc_on_due() for each
+void sc_poll(void);
+
+#endif // __schedule_h__
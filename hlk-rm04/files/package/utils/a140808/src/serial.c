@@ -17,42 +17,61 @@
 //
 
 #include <stdio.h>
+#include <errno.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <termios.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>  // struct serial_rs485
 
 #include "global.h"
 #include "serial.h"
 
-static int s_fd = -1;
-
 speed_t sp_parse_baudrate(uint32_t p_requested);
 
+#define SP_WRITE_WAIT_MS  100  // for room in a full tty buffer
+
 
 ////////////////////////////////////////
-// p_device: ignored
 // p_parity
 //   false: N81 (none, 8 data, 1 stop)
 //   true:  E71 (even, 7 data, 1 stop)
-bool sp_init(const char* p_device, const uint16_t p_baud, const bool p_parity)
+int sp_open(const char* p_device, const uint32_t p_baud, const bool p_parity)
 {
-    sp_close();
-    log_notice("opening %s at %d baud, %s\n", p_device, p_baud, (p_parity ? "E71" : "N81"));
+    log_notice("opening %s at %u baud, %s\n", p_device, p_baud, (p_parity ? "E71" : "N81"));
 
-    const speed_t baudrate = sp_parse_baudrate(p_baud);
-    if(0 == baudrate)
+    if(!sp_baud_supported(p_baud))
     {
         log_crit("baudrate not supported");
-        return(false);
+        return(-1);
     }
 
     // open serial device for reading and writing and not as controlling tty so we don't get killed by CTRL-C
-    s_fd = open(p_device, O_RDWR | O_NOCTTY | O_NDELAY);
-    if(s_fd < 0)
+    const int fd = open(p_device, O_RDWR | O_NOCTTY | O_NDELAY);
+    if(fd < 0)
     {
         log_crit("failed to open device: %s", p_device);
+        return(-1);
+    }
+
+    sp_set_baud(fd, p_baud, p_parity);
+    return(fd);
+}
+
+////////////////////////////////////////
+// p_parity
+//   false: N81 (none, 8 data, 1 stop)
+//   true:  E71 (even, 7 data, 1 stop)
+bool sp_set_baud(const int p_fd, const uint32_t p_baud, const bool p_parity)
+{
+    const speed_t baudrate = sp_parse_baudrate(p_baud);
+    if(0 == baudrate)
+    {
+        log_err("baudrate not supported: %u", p_baud);
         return(false);
     }
 
@@ -76,82 +95,96 @@ bool sp_init(const char* p_device, const uint16_t p_baud, const bool p_parity)
     // local modes
     tio.c_lflag = 0;
 
-    // clean the modem line and activate the settings for the port
-    tcflush(s_fd, TCIOFLUSH);
-    tcsetattr(s_fd, TCSANOW, &tio);
-
+    // let pending output go out at the old rate, drop input and activate the settings for the port
+    tcdrain(p_fd);
+    tcflush(p_fd, TCIOFLUSH);
+    if(0 != tcsetattr(p_fd, TCSANOW, &tio))
+    {
+        log_err("failed to set %u baud", p_baud);
+        return(false);
+    }
     return(true);
 }
 
 ////////////////////////////////////////
-void sp_close(void)
+// half-duplex rs485: the uart driver raises rts (driver enable) while sending
+bool sp_set_rs485(const int p_fd, const bool p_enable)
 {
-    if(s_fd > -1)
+    struct serial_rs485 rs485;
+    memset(&rs485, 0, sizeof(rs485));
+    if(p_enable)
+    {
+        rs485.flags = (SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND);
+    }
+    if(ioctl(p_fd, TIOCSRS485, &rs485) < 0)
     {
-        close(s_fd);
-        s_fd = -1;
+        log_warn("rs485 mode not supported by the uart driver, err: [%s]", strerror(errno));
+        return(false);
     }
+    return(true);
+}
+
+////////////////////////////////////////
+bool sp_baud_supported(const uint32_t p_baud)
+{
+    return(0 != sp_parse_baudrate(p_baud));
 }
 
 ////////////////////////////////////////
-bool sp_read(struct ring_buf_data* p_pd)
+void sp_close(const int p_fd)
 {
-    for(;;)
+    if(p_fd > -1)
     {
-        uint8_t val = 0;
-        const ssize_t bytesRead = read(s_fd, &val, 1);
-        if(bytesRead < 0)
-        {
-            // error
-            log_err("serial read error");
-            return(false);
-        }
+        close(p_fd);
+    }
+}
 
-        if(0 == bytesRead)
+////////////////////////////////////////
+ssize_t sp_read(const int p_fd, uint8_t* p_buf, const size_t p_len)
+{
+    const ssize_t bytesRead = read(p_fd, p_buf, p_len);
+    if(bytesRead < 0)
+    {
+        if((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno))
         {
             // no data available
-            break;
-        }
-
-        rb_push_back(p_pd, val);
-        if(S_OK == mb_validate(p_pd))
-        {
-            // have a message
-            return(true);
+            return(0);
         }
+        log_err("serial read error, err: [%s]", strerror(errno));
+        return(-1);
     }
-    return(false);
+    return(bytesRead);
 }
 
 ////////////////////////////////////////
-bool sp_write(struct ring_buf_data* p_pd)
+bool sp_write(const int p_fd, const uint8_t* p_buf, const size_t p_len)
 {
-    log_trace2("sp_write");
-    if(S_OK != mb_validate(p_pd))
-    {
-        // message is not valid
-        log_trace("ignoring invalid message send request, size: %d", rb_size(p_pd));
-        return(false);
-    }
-
     log_trace2("send: -->");
-    for(uint8_t i=0, imax=rb_size(p_pd); i<imax; ++i)
+    size_t off = 0;
+    while(off < p_len)
     {
-        const uint8_t val = rb_at(p_pd, i);
-        const ssize_t bytesWritten = write(s_fd, &val, 1);
-        if(1 != bytesWritten)
+        const ssize_t bytesWritten = write(p_fd, (p_buf + off), (p_len - off));
+        if(bytesWritten < 0)
         {
-            // error
-            log_err("serial write error");
+            if(EINTR == errno)
+            {
+                continue;
+            }
+            if((EAGAIN == errno) || (EWOULDBLOCK == errno))
+            {
+                // the tty buffer is full, give it a moment to drain
+                struct pollfd pfd = { p_fd, POLLOUT, 0 };
+                if(poll(&pfd, 1, SP_WRITE_WAIT_MS) > 0)
+                {
+                    continue;
+                }
+            }
+            log_err("serial write error, err: [%s]", strerror(errno));
             return(false);
         }
-        log_trace2("%c", val);
+        off += bytesWritten;
     }
-    log_trace2("<--");
-
-    // TODO: bug in atmega32 code requires an extra byte to be sent for now
-    write(s_fd, "\n", 1);
-
+    log_trace2("%.*s<--", (int)p_len, p_buf);
     return(true);
 }
 
@@ -21,14 +21,27 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <sys/types.h>  // ssize_t
 
-#include "ring_buf.h"
-#include "msg_buf.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
 
+// returns the open port's fd, -1 on error
+int sp_open(const char* p_device, const uint32_t p_baud, const bool p_parity);
+void sp_close(const int p_fd);
+// change the rate of an open port, pending input is discarded
+bool sp_set_baud(const int p_fd, const uint32_t p_baud, const bool p_parity);
+bool sp_baud_supported(const uint32_t p_baud);
+// rts as driver enable for a multi-drop bus, false if the driver can't
+bool sp_set_rs485(const int p_fd, const bool p_enable);
+// returns the bytes read, 0 if none are waiting, -1 on error (ex: EIO once the device is gone)
+ssize_t sp_read(const int p_fd, uint8_t* p_buf, const size_t p_len);
+// false on error, a full tty buffer gets SP_WRITE_WAIT_MS to drain
+bool sp_write(const int p_fd, const uint8_t* p_buf, const size_t p_len);
 
-bool sp_init(const char* p_device, const uint16_t p_baud, const bool p_parity);
-void sp_close(void);
-bool sp_read(struct ring_buf_data* p_pd);
-bool sp_write(struct ring_buf_data* p_pd);
+#ifdef __cplusplus
+}
+#endif
 
 #endif // __serial_port_h__
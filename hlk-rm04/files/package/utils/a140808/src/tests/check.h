@@ -0,0 +1,62 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// what every test shares: check() prints a case and counts it if it
+// failed, check_end() reports the count and is the test's exit status
+//
+
+#ifndef __check_h__
+#define __check_h__
+
+#include <stdio.h>
+#include <time.h>
+
+static int s_failed = 0;
+
+
+////////////////////////////////////////
+static inline void check_begin(void)
+{
+	printf("\n--- begin test ---\n\n");
+}
+
+////////////////////////////////////////
+static inline void check(const char* p_what, const int p_ok)
+{
+	printf("%-60s %s\n", p_what, (p_ok ? "ok" : "FAILED"));
+	s_failed += (p_ok ? 0 : 1);
+}
+
+////////////////////////////////////////
+static inline int check_end(void)
+{
+	printf("---  end test: [%d] failed ---\n\n", s_failed);
+	return((0 == s_failed) ? 0 : 1);
+}
+
+////////////////////////////////////////
+// for the benchmarks
+static inline double now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return(ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
+#endif // __check_h__
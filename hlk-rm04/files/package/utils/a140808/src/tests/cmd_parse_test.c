@@ -0,0 +1,219 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// cp_parse(): the shapes it takes and refuses, random mutations of real
+// commands (it must neither crash nor overrun cp_msg), and the cost per
+// message with the resident set before and after
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../cmd_parse.h"
+#include "check.h"
+
+#define FUZZ_ROUNDS   1000000
+#define BENCH_ROUNDS  2000000
+
+
+////////////////////////////////////////
+static long rss_kb(void)
+{
+	long pages = 0;
+	FILE* pf = fopen("/proc/self/statm", "r");
+	if(NULL != pf)
+	{
+		if(1 != fscanf(pf, "%*d %ld", &pages))
+		{
+			pages = 0;
+		}
+		fclose(pf);
+	}
+	return(pages * (sysconf(_SC_PAGESIZE) / 1024));
+}
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+	cp_msg msg;
+	int val;
+	const char* str;
+
+
+	/////////////////////////////////
+	// the shapes the cloud sends
+	printf("----------------\n");
+	check("[\"pulseRelay\",1,250]",
+	      cp_parse("[\"pulseRelay\",1,250]", &msg) && (0 == strcmp("pulseRelay", msg.m_name)) && (2 == msg.m_count) &&
+	      cp_get_int(&msg, 0, &val) && (1 == val) && cp_get_int(&msg, 1, &val) && (250 == val) && !cp_get_int(&msg, 2, &val));
+	check(" [ \"writeOutputRegister\" , -7 ,\t\"255\" , 3 ]\\n",
+	      cp_parse(" [ \"writeOutputRegister\" , -7 ,\t\"255\" , 3 ]\n", &msg) && (3 == msg.m_count) &&
+	      cp_get_int(&msg, 0, &val) && (-7 == val) && cp_get_int(&msg, 1, &val) && (255 == val) && !cp_get_string(&msg, 0, &str));
+	check("[\"hello\",\"dev \\\"1\\\"\\\\\"]",
+	      cp_parse("[\"hello\",\"dev \\\"1\\\"\\\\\"]", &msg) && cp_get_string(&msg, 0, &str) && (0 == strcmp("dev \"1\"\\", str)));
+	check("[\"requestIpv4Addresses\"]",
+	      cp_parse("[\"requestIpv4Addresses\"]", &msg) && (0 == msg.m_count));
+	check("[\"x\",\"12a\"] not an int",
+	      cp_parse("[\"x\",\"12a\"]", &msg) && !cp_get_int(&msg, 0, &val));
+	check("[\"x\",2147483647,-2147483648]",
+	      cp_parse("[\"x\",2147483647,-2147483648]", &msg) && cp_get_int(&msg, 1, &val) && (-2147483647 - 1 == val));
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// left to json-c
+	printf("----------------\n");
+	static const char* refused[] =
+	{
+		"", "[]", "[1,2]", "{\"a\":1}", "[\"x\",1.5]", "[\"x\",true]", "[\"x\",null]", "[\"x\",[1]]",
+		"[\"x\",\"\\u0041\"]", "[\"x\",01]", "[\"x\",2147483648]", "[\"x\",1,]", "[\"x\" 1]", "[\"x\",1] 2",
+		"[\"x\",1", "[\"x", "[\"x\",\"a\nb\"]", "[\"x\",1,2,3,4,5,6,7,8,9]",
+	};
+	for(size_t i=0; i<(sizeof(refused) / sizeof(refused[0])); ++i)
+	{
+		char what[64];
+		snprintf(what, sizeof(what), "refused: %s", refused[i]);
+		check(what, !cp_parse(refused[i], &msg));
+	}
+	{
+		// strings past CP_BUF_LEN
+		char big[CP_BUF_LEN + 16];
+		memset(big, 'a', sizeof(big));
+		memcpy(big, "[\"", 2);
+		memcpy(&big[sizeof(big) - 3], "\"]", 3);
+		check("refused: a name longer than CP_BUF_LEN", !cp_parse(big, &msg));
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// batches
+	printf("----------------\n");
+	{
+		cp_msg msgs[CP_MAX_BATCH];
+		check("[\"batch\",[\"pulseRelay\",1,250],[\"hello\",\"x\"]]",
+		      (2 == cp_parse_batch("[\"batch\",[\"pulseRelay\",1,250],[\"hello\",\"x\"]]", msgs, CP_MAX_BATCH)) &&
+		      (0 == strcmp("hello", msgs[1].m_name)) && cp_get_int(&msgs[0], 1, &val) && (250 == val));
+		check("[\"batch\"]", (0 == cp_parse_batch("[\"batch\"]", msgs, CP_MAX_BATCH)));
+		check("refused: [\"batch\",[\"a\"],[\"b\"],[\"c\"]] past p_max", (-1 == cp_parse_batch("[\"batch\",[\"a\"],[\"b\"],[\"c\"]]", msgs, 2)));
+		check("refused: [\"batch\",1]", (-1 == cp_parse_batch("[\"batch\",1]", msgs, CP_MAX_BATCH)));
+		check("refused: [\"batches\",[\"a\"]]", (-1 == cp_parse_batch("[\"batches\",[\"a\"]]", msgs, CP_MAX_BATCH)));
+		check("refused: [\"pulseRelay\",1,250] by cp_parse_batch", (-1 == cp_parse_batch("[\"pulseRelay\",1,250]", msgs, CP_MAX_BATCH)));
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// requests
+	printf("----------------\n");
+	{
+		char id[8];
+		const char* cmd;
+		size_t len;
+		check("[\"req\",\"k1\",[\"pulseRelay\",1,250]]",
+		      cp_parse_request("[\"req\",\"k1\",[\"pulseRelay\",1,250]]", id, sizeof(id), &cmd, &len) &&
+		      (0 == strcmp("k1", id)) && (20 == len) && (0 == strncmp("[\"pulseRelay\",1,250]", cmd, len)));
+		check(" [ \"req\" , \"k\\\"2\" , [\"batch\",[\"a\"]] ] \\n",
+		      cp_parse_request(" [ \"req\" , \"k\\\"2\" , [\"batch\",[\"a\"]] ] \n", id, sizeof(id), &cmd, &len) &&
+		      (0 == strcmp("k\"2", id)) && (0 == strncmp("[\"batch\",[\"a\"]]", cmd, len)) && (15 == len));
+		static const char* refused[] =
+		{
+			"[\"pulseRelay\",1,250]", "[\"req\",\"k\"]", "[\"req\",\"\",[\"a\"]]", "[\"req\",1,[\"a\"]]",
+			"[\"req\",\"k\",[\"a\"]", "[\"req\",\"k\",[]", "[\"req\",\"k\",\"a\"]", "[\"request\",\"k\",[\"a\"]]",
+			"[\"req\",\"12345678\",[\"a\"]]",
+		};
+		for(size_t i=0; i<(sizeof(refused) / sizeof(refused[0])); ++i)
+		{
+			char what[64];
+			snprintf(what, sizeof(what), "refused: %s", refused[i]);
+			check(what, !cp_parse_request(refused[i], id, sizeof(id), &cmd, &len));
+		}
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// random mutations of real commands
+	printf("----------------\n");
+	static const char* seeds[] =
+	{
+		"[\"pulseRelay\",1,250]", "[\"writeOutputRegister\",170,255,3]", "[\"hello\",\"a140808-0001\"]",
+		"[\"dialModem\",\"ATD3,4,4;\"]", "[\"requestIpv4Addresses\"]",
+	};
+	static const char alphabet[] = "[]\",\\ -0123456789aeflnrstu{}.:\n";
+	srand(1);
+	int parsed = 0;
+	int overrun = 0;
+	for(int i=0; i<FUZZ_ROUNDS; ++i)
+	{
+		char buf[64];
+		strcpy(buf, seeds[i % (sizeof(seeds) / sizeof(seeds[0]))]);
+		const size_t len = strlen(buf);
+		for(int m=(1 + (rand() % 3)); m>0; --m)
+		{
+			const size_t at = (rand() % len);
+			buf[at] = ((0 == (rand() % 16)) ? '\0' : alphabet[rand() % (sizeof(alphabet) - 1)]);
+		}
+		if(cp_parse(buf, &msg))
+		{
+			++parsed;
+			overrun += ((msg.m_count > CP_MAX_ARGS) || (msg.m_name < msg.m_buf) || (msg.m_name >= (msg.m_buf + CP_BUF_LEN))) ? 1 : 0;
+			for(int a=0; a<msg.m_count; ++a)
+			{
+				str = msg.m_args[a].m_str;
+				overrun += (msg.m_args[a].m_isString && ((str < msg.m_buf) || ((str + strlen(str)) >= (msg.m_buf + CP_BUF_LEN)))) ? 1 : 0;
+			}
+		}
+	}
+	printf("[%d] mutations, [%d] still parsed\n", FUZZ_ROUNDS, parsed);
+	check("parsed mutations stay inside cp_msg", (0 == overrun));
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// cost per message, the resident set has to stay put
+	printf("----------------\n");
+	long sum = 0;
+	for(int i=0; i<(BENCH_ROUNDS / 10); ++i)
+	{
+		// warm up, the pages touched the first time are not growth
+		cp_parse(seeds[i & 1], &msg);
+		sum += msg.m_count;
+	}
+	rss_kb();  // and the first fopen() grows the heap
+	const long rssBefore = rss_kb();
+	const double start = now_sec();
+	for(int i=0; i<BENCH_ROUNDS; ++i)
+	{
+		cp_parse(seeds[i & 1], &msg);
+		sum += msg.m_count;
+	}
+	const double elapsed = (now_sec() - start);
+	const long rssAfter = rss_kb();
+	printf("[%d] messages in [%.3fs], [%.0fns] per message (%ld)\n", BENCH_ROUNDS, elapsed, ((elapsed * 1e9) / BENCH_ROUNDS), sum);
+	printf("rss before: [%ldKB] after: [%ldKB]\n", rssBefore, rssAfter);
+	// the kernel's count lags by a few pages, a byte per message would be 2MB
+	check("rss steady", (rssAfter <= (rssBefore + 256)));
+	printf("----------------\n\n");
+
+	return(check_end());
+}
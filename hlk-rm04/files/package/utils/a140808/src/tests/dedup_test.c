@@ -0,0 +1,158 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// dedup: results found by id, the least recently used id the one that
+// makes room, and random adds and lookups against a plain list in use
+// order
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../global.h"
+#include "../dedup.h"
+#include "check.h"
+
+#define RANDOM_ROUNDS  500000
+#define RANDOM_IDS     (DD_MAX_IDS * 3)
+
+
+// the model, the most recently used first
+static int s_used[DD_MAX_IDS];
+static int s_usedCount = 0;
+
+
+////////////////////////////////////////
+static const char* id_of(const int p_num)
+{
+	static char id[DD_ID_LEN + 1];
+	snprintf(id, sizeof(id), "srv-%d", p_num);
+	return(id);
+}
+
+////////////////////////////////////////
+static void add(const int p_num)
+{
+	const dd_result result = { (uint8_t)(p_num % 3) };
+	dd_add(id_of(p_num), &result);
+}
+
+////////////////////////////////////////
+static bool found(const int p_num)
+{
+	const dd_result* presult = dd_find(id_of(p_num));
+	return((NULL != presult) && ((p_num % 3) == presult->m_status));
+}
+
+////////////////////////////////////////
+// p_num to the front of the model, the last one out when full
+static void model_use(const int p_num)
+{
+	int at = 0;
+	while((at < s_usedCount) && (s_used[at] != p_num))
+	{
+		++at;
+	}
+	if(at == s_usedCount)
+	{
+		at = ((DD_MAX_IDS == s_usedCount) ? (s_usedCount - 1) : s_usedCount++);
+	}
+	memmove(&s_used[1], &s_used[0], (sizeof(int) * at));
+	s_used[0] = p_num;
+}
+
+////////////////////////////////////////
+static bool model_has(const int p_num)
+{
+	for(int i=0; i<s_usedCount; ++i)
+	{
+		if(s_used[i] == p_num)
+		{
+			return(true);
+		}
+	}
+	return(false);
+}
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+
+
+	/////////////////////////////////
+	// lookups and eviction
+	printf("----------------\n");
+	check("empty", !found(1));
+	for(int i=0; i<DD_MAX_IDS; ++i)
+	{
+		add(i);
+	}
+	bool all = true;
+	for(int i=(DD_MAX_IDS - 1); i>=0; --i)
+	{
+		all = (all && found(i));  // the first one is the most recent after
+	}
+	check("DD_MAX_IDS found", all);
+	add(DD_MAX_IDS);
+	check("the least recently used one made room", !found(DD_MAX_IDS - 1) && found(DD_MAX_IDS) && found(0));
+	{
+		char longId[DD_ID_LEN + 8];
+		memset(longId, 'x', sizeof(longId));
+		longId[sizeof(longId) - 1] = '\0';
+		const dd_result result = { DD_FAILED };
+		dd_add(longId, &result);
+		longId[DD_ID_LEN] = '\0';
+		const dd_result* presult = dd_find(longId);
+		check("an id past DD_ID_LEN cut to it", (NULL != presult) && (DD_FAILED == presult->m_status));
+	}
+	dd_clear();
+	check("cleared", !found(0) && !found(DD_MAX_IDS));
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// random adds and lookups against the model
+	printf("----------------\n");
+	srand(1);
+	int bad = 0;
+	int hits = 0;
+	for(int i=0; i<RANDOM_ROUNDS; ++i)
+	{
+		const int num = (rand() % RANDOM_IDS);
+		const bool expected = model_has(num);
+		const bool got = found(num);
+		if(got != expected)
+		{
+			++bad;
+		}
+		if(!got)
+		{
+			add(num);
+		}
+		hits += (got ? 1 : 0);
+		model_use(num);
+	}
+	printf("[%d] lookups, [%d] found\n", RANDOM_ROUNDS, hits);
+	check("random adds and lookups", (0 == bad));
+	printf("----------------\n\n");
+
+	return(check_end());
+}
@@ -0,0 +1,173 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+//
+// fanout: one board subscription per register whatever the subscribers,
+// and each subscriber's policy on its own, a consumer that refuses events
+// holds up none of the others
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../global.h"
+#include "../fanout.h"
+#include "../msg_proc.h"
+#include "../regcache.h"
+#include "check.h"
+
+#define BOARD  0x00  // point to point
+
+
+// the board subscriptions sent, through the stubs of msg_proc.h
+static int s_subscribes = 0;
+static int s_cancels = 0;
+uint8_t mp_bus_board(const uint8_t p_index) { return(BUS_ADDRESS_NONE); }
+void mp_select(const uint8_t p_address) { }
+bool mp_dispatch_subscribe_register(const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
+{
+	s_subscribes += (p_cancel ? 0 : 1);
+	s_cancels += (p_cancel ? 1 : 0);
+	return(true);
+}
+bool mp_dispatch_read_register(const uint8_t p_registerAddress) { return(true); }
+void mp_burst_begin(void) { }
+bool mp_burst_end(void) { return(true); }
+
+// what each consumer got, the values in order
+typedef struct
+{
+	bool m_refuse;
+	int m_count;
+	uint8_t m_values[32];
+	int m_cancels;
+} consumer;
+
+////////////////////////////////////////
+static bool deliver(void* p_ctx, const uint8_t p_board, const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel)
+{
+	consumer* pc = (consumer*)p_ctx;
+	if(pc->m_refuse)
+	{
+		return(false);
+	}
+	if(p_cancel)
+	{
+		++pc->m_cancels;
+		return(true);
+	}
+	pc->m_values[pc->m_count++ % 32] = p_value;
+	return(true);
+}
+
+
+////////////////////////////////////////
+// an input change from the board, as mp_on_subscribe_register() sees it
+static void change(const uint8_t p_registerAddress, const uint8_t p_value)
+{
+	rc_update(BOARD, p_registerAddress, p_value, true);
+	fo_publish(BOARD, p_registerAddress, p_value, false);
+}
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+	consumer fast = { 0 };
+	consumer slow = { 0 };
+	consumer stuck = { 0 };
+	const fo_policy all = { 0xff, 0, 0 };
+	const fo_policy slowPolicy = { 0x0f, 200, 50 };
+	const int fastId = fo_add(deliver, &fast, &all);
+	const int slowId = fo_add(deliver, &slow, &slowPolicy);
+	const int stuckId = fo_add(deliver, &stuck, &all);
+
+
+	/////////////////////////////////
+	// one board subscription
+	printf("----------------\n");
+	rc_watch();
+	const int watchSubscribes = s_subscribes;
+	change(REG_INPUT_1, 0x01);
+	fo_subscribe(fastId, BOARD, REG_INPUT_1);
+	fo_subscribe(slowId, BOARD, REG_INPUT_1);
+	stuck.m_refuse = true;
+	fo_subscribe(stuckId, BOARD, REG_INPUT_1);
+	check("watched register: the cache's subscription, no other", (watchSubscribes == s_subscribes));
+	check("the current value at once", (1 == fast.m_count) && (0x01 == fast.m_values[0]) && (1 == slow.m_count));
+
+	fo_subscribe(fastId, BOARD, REG_POWERON_POLICY);
+	fo_subscribe(slowId, BOARD, REG_POWERON_POLICY);
+	check("other register: subscribed on the board once", ((watchSubscribes + 1) == s_subscribes));
+	fo_unsubscribe(fastId, BOARD, REG_POWERON_POLICY);
+	check("not cancelled while a subscriber is left", (0 == s_cancels));
+	fo_unsubscribe(slowId, BOARD, REG_POWERON_POLICY);
+	check("cancelled with the last one", (1 == s_cancels));
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// policies
+	printf("----------------\n");
+	for(int i=2; i<=11; ++i)
+	{
+		change(REG_INPUT_1, (uint8_t)i);
+	}
+	check("all: every change", (11 == fast.m_count) && (0x0b == fast.m_values[10]));
+	check("slow: none yet, inside its interval", (1 == slow.m_count));
+	sleep_ms(250);
+	fo_poll();
+	check("slow: the latest after its interval", (2 == slow.m_count) && (0x0b == slow.m_values[1]));
+
+	change(REG_INPUT_1, 0x1b);  // a bit outside its mask
+	sleep_ms(250);
+	fo_poll();
+	check("slow: a change outside its mask is not sent", (2 == slow.m_count) && (12 == fast.m_count));
+
+	change(REG_INPUT_1, 0x1c);
+	change(REG_INPUT_1, 0x1b);
+	sleep_ms(100);
+	fo_poll();
+	check("slow: a change undone in the window is not sent", (2 == slow.m_count) && (14 == fast.m_count));
+
+	change(REG_INPUT_1, 0x10);
+	fo_poll();
+	check("slow: waits the coalescing window", (2 == slow.m_count));
+	sleep_ms(100);
+	fo_poll();
+	check("slow: then sends", (3 == slow.m_count) && (0x10 == slow.m_values[2]));
+
+	check("stuck: nothing taken, the others unaffected", (0 == stuck.m_count));
+	stuck.m_refuse = false;
+	fo_poll();
+	check("stuck: the latest value once it takes it", (1 == stuck.m_count) && (0x10 == stuck.m_values[0]));
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// the board ends it
+	printf("----------------\n");
+	fo_publish(BOARD, REG_INPUT_1, 0, true);
+	check("a cancel reaches every subscriber", (1 == fast.m_cancels) && (1 == slow.m_cancels) && (1 == stuck.m_cancels));
+	change(REG_INPUT_1, 0x20);
+	check("and ends their subscriptions", (15 == fast.m_count));
+	printf("----------------\n\n");
+
+	return(check_end());
+}
@@ -0,0 +1,163 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+//
+// journal: records in and out in order, acknowledged ones gone, the oldest
+// making room when full, what is left found again after a reopen, and
+// random appends and acks against a plain list of what should be there
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../global.h"
+#include "../journal.h"
+#include "check.h"
+
+#define JOURNAL_PATH   "/tmp/journal_test.journal"
+#define RANDOM_ROUNDS  200000
+
+
+////////////////////////////////////////
+// the event text for a sequence number, its length varies with it
+static uint16_t event(const uint32_t p_seq, char* p_buf)
+{
+	int len = sprintf(p_buf, "[\"registerChanged\",161,%u,0,0]", (p_seq & 0xff));
+	for(uint32_t i=0; i<(p_seq % 23); ++i)
+	{
+		p_buf[len++] = ' ';
+	}
+	return((uint16_t)len);
+}
+
+////////////////////////////////////////
+// every record after p_from is the one appended with its number
+static bool holds(const uint32_t p_from, const uint32_t p_to)
+{
+	char expected[JR_RECORD_MAX];
+	uint32_t seq = p_from;
+	uint32_t recordSeq;
+	uint16_t len;
+	const char* pdata;
+	while(NULL != (pdata = jr_next(seq, &recordSeq, &len)))
+	{
+		if((recordSeq != (seq + 1)) || (len != event(recordSeq, expected)) || (0 != memcmp(pdata, expected, len)))
+		{
+			printf("  seq: [%u] got: [%u] len: [%u]\n", (seq + 1), recordSeq, len);
+			return(false);
+		}
+		seq = recordSeq;
+	}
+	return(seq == p_to);
+}
+
+////////////////////////////////////////
+static uint32_t append(void)
+{
+	char buf[JR_RECORD_MAX];
+	return(jr_append(buf, event(jr_last() + 1, buf)));
+}
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+	unlink(JOURNAL_PATH);
+
+
+	/////////////////////////////////
+	// in and out
+	printf("----------------\n");
+	check("open", jr_open(JOURNAL_PATH, 4096));
+	check("empty", (NULL == jr_next(0, NULL, NULL)) && (0 == jr_last()));
+	for(int i=0; i<10; ++i)
+	{
+		append();
+	}
+	check("10 in order", holds(0, 10));
+	check("from the middle", holds(4, 10));
+	jr_ack(6);
+	check("acked 6: 7 to 10 left", (6 == jr_acked()) && holds(6, 10));
+	{
+		uint32_t seq;
+		uint16_t len;
+		check("acked 6: the first is 7", (NULL != jr_next(0, &seq, &len)) && (7 == seq));
+	}
+	jr_ack(100);
+	check("ack past the last", (10 == jr_acked()) && (NULL == jr_next(0, NULL, NULL)));
+	check("refused: longer than JR_RECORD_MAX", (0 == jr_append("x", (JR_RECORD_MAX + 1))));
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// full, and reopened
+	printf("----------------\n");
+	for(int i=0; i<1000; ++i)
+	{
+		append();
+	}
+	uint32_t first;
+	uint16_t len;
+	jr_next(0, &first, &len);
+	printf("1000 in 4KB: [%u] to [%u] kept\n", first, jr_last());
+	check("full: the newest kept, in order", (1010 == jr_last()) && (first > 11) && holds((first - 1), 1010));
+	jr_close();
+	check("reopen", jr_open(JOURNAL_PATH, 4096));
+	check("reopened: the same records", (1010 == jr_last()) && (10 == jr_acked()) && holds((first - 1), 1010));
+	append();
+	jr_next(0, &first, &len);
+	check("reopened: appends on", (1011 == jr_last()) && holds((first - 1), 1011));
+	jr_close();
+	check("reopen with another size starts over", jr_open(JOURNAL_PATH, 8192) && (0 == jr_last()));
+	jr_close();
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// random appends and acks, what is left has to be the newest unacked
+	printf("----------------\n");
+	unlink(JOURNAL_PATH);
+	jr_open(JOURNAL_PATH, 2048);
+	srand(1);
+	int bad = 0;
+	for(int i=0; i<RANDOM_ROUNDS; ++i)
+	{
+		const int op = (rand() % 10);
+		if(op < 7)
+		{
+			append();
+		}
+		else if(op < 9)
+		{
+			jr_ack(jr_last() - (rand() % 8));
+		}
+		else if(!holds(max(jr_acked(), (jr_next(0, &first, &len) ? (first - 1) : jr_last())), jr_last()))
+		{
+			++bad;
+		}
+	}
+	check("random appends and acks", (0 == bad));
+	jr_close();
+	unlink(JOURNAL_PATH);
+	printf("----------------\n\n");
+
+	return(check_end());
+}
@@ -0,0 +1,189 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// json_writer: output and escaping, messages that do not fit, and the cost
+// of the ipv4 address reply against json-c's object tree (built with
+// -DHAVE_JSON_C, see make_tests.sh) at the target's -Os
+//
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_JSON_C
+#include <json-c/json.h>
+#endif
+
+#include "../json_writer.h"
+#include "check.h"
+
+#define BENCH_ROUNDS  1000000
+
+static const char* s_ips[] = { "172.17.133.3", "172.17.133.4", "192.168.100.254" };
+#define IP_COUNT  (sizeof(s_ips) / sizeof(s_ips[0]))
+
+
+////////////////////////////////////////
+static void check_json(const char* p_what, const char* p_got, const char* p_expected)
+{
+	const int ok = (0 == strcmp(p_got, p_expected));
+	check(p_what, ok);
+	if(!ok)
+	{
+		printf("  expected: [%s]\n       got: [%s]\n", p_expected, p_got);
+	}
+}
+
+
+////////////////////////////////////////
+// {"ipv4Addresses":["172.17.133.3",...]} like requestIpv4Addresses()
+static size_t ipv4_reply(char* p_buf, const size_t p_capacity)
+{
+	struct json_writer jw;
+	jw_init(&jw, p_buf, p_capacity);
+	jw_object_begin(&jw);
+	jw_key(&jw, "ipv4Addresses");
+	jw_array_begin(&jw);
+	for(size_t i=0; i<IP_COUNT; ++i)
+	{
+		jw_string(&jw, s_ips[i]);
+	}
+	jw_array_end(&jw);
+	jw_object_end(&jw);
+	return(jw_finish(&jw));
+}
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+	char buf[512];
+	struct json_writer jw;
+
+
+	/////////////////////////////////
+	// output
+	printf("----------------\n");
+	ipv4_reply(buf, sizeof(buf));
+	check_json("ipv4 reply", buf, "{\"ipv4Addresses\":[\"172.17.133.3\",\"172.17.133.4\",\"192.168.100.254\"]}");
+
+	jw_init(&jw, buf, sizeof(buf));
+	jw_object_begin(&jw);
+	jw_key(&jw, "batch");
+	jw_object_begin(&jw);
+	jw_key(&jw, "count");    jw_int(&jw, 3);
+	jw_key(&jw, "ok");       jw_bool(&jw, false);
+	jw_key(&jw, "invalid");  jw_int(&jw, -1);
+	jw_key(&jw, "none");     jw_null(&jw);
+	jw_key(&jw, "empty");    jw_array_begin(&jw);  jw_array_end(&jw);
+	jw_object_end(&jw);
+	jw_object_end(&jw);
+	jw_finish(&jw);
+	check_json("nested object", buf, "{\"batch\":{\"count\":3,\"ok\":false,\"invalid\":-1,\"none\":null,\"empty\":[]}}");
+
+	jw_init(&jw, buf, sizeof(buf));
+	jw_array_begin(&jw);
+	jw_int(&jw, 0);
+	jw_int(&jw, 9223372036854775807LL);
+	jw_int(&jw, (-9223372036854775807LL - 1));
+	jw_array_end(&jw);
+	jw_finish(&jw);
+	check_json("int64 range", buf, "[0,9223372036854775807,-9223372036854775808]");
+
+	jw_init(&jw, buf, sizeof(buf));
+	jw_array_begin(&jw);
+	jw_string(&jw, "journal");
+	jw_raw(&jw, "[\"a\",1]", 7);
+	jw_raw(&jw, "{}", 2);
+	jw_array_end(&jw);
+	jw_finish(&jw);
+	check_json("raw", buf, "[\"journal\",[\"a\",1],{}]");
+
+	jw_init(&jw, buf, sizeof(buf));
+	jw_string(&jw, "q\" b\\ /\b\f\n\r\t\x01\x1f \xc3\xa9");
+	jw_finish(&jw);
+	check_json("escapes", buf, "\"q\\\" b\\\\ /\\b\\f\\n\\r\\t\\u0001\\u001f \xc3\xa9\"");
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// refused
+	printf("----------------\n");
+	{
+		// the nul needs a byte on top of the reply
+		const size_t len = ipv4_reply(buf, sizeof(buf));
+		check_json("one byte short", ((0 == ipv4_reply(buf, len)) ? "0" : buf), "0");
+		check_json("just enough", ((len == ipv4_reply(buf, (len + 1))) ? "ok" : buf), "ok");
+	}
+
+	jw_init(&jw, buf, sizeof(buf));
+	jw_object_begin(&jw);
+	jw_key(&jw, "open");
+	check_json("unclosed object", ((0 == jw_finish(&jw)) ? "0" : buf), "0");
+
+	jw_init(&jw, buf, sizeof(buf));
+	jw_array_end(&jw);
+	check_json("close without open", ((0 == jw_finish(&jw)) ? "0" : buf), "0");
+
+	jw_init(&jw, buf, sizeof(buf));
+	for(int i=0; i<(JW_MAX_DEPTH + 1); ++i)
+	{
+		jw_array_begin(&jw);
+	}
+	check_json("past JW_MAX_DEPTH", ((0 == jw_finish(&jw)) ? "0" : buf), "0");
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// cost of the ipv4 reply
+	printf("----------------\n");
+	{
+		size_t sum = 0;
+		const double start = now_sec();
+		for(int i=0; i<BENCH_ROUNDS; ++i)
+		{
+			sum += ipv4_reply(buf, sizeof(buf));
+		}
+		const double elapsed = (now_sec() - start);
+		printf("json_writer: [%.0fns] per message (%zu)\n", ((elapsed * 1e9) / BENCH_ROUNDS), sum);
+	}
+#ifdef HAVE_JSON_C
+	{
+		size_t sum = 0;
+		const double start = now_sec();
+		for(int i=0; i<BENCH_ROUNDS; ++i)
+		{
+			json_object* jarray = json_object_new_array();
+			for(size_t ip=0; ip<IP_COUNT; ++ip)
+			{
+				json_object_array_add(jarray, json_object_new_string(s_ips[ip]));
+			}
+			json_object* jobject = json_object_new_object();
+			json_object_object_add(jobject, "ipv4Addresses", jarray);
+			sum += strlen(json_object_to_json_string(jobject));
+			json_object_put(jobject);
+		}
+		const double elapsed = (now_sec() - start);
+		printf("json-c:      [%.0fns] per message (%zu)\n", ((elapsed * 1e9) / BENCH_ROUNDS), sum);
+	}
+#else
+	printf("json-c:      not built, see make_tests.sh\n");
+#endif // HAVE_JSON_C
+	printf("----------------\n\n");
+
+	return(check_end());
+}
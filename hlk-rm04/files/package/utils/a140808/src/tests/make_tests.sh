@@ -17,5 +17,18 @@
 # Author: John Clark (johnc@restswitch.com)
 #
 
+gcc -std=gnu99 -O2 -o cmd_parse_test cmd_parse_test.c ../cmd_parse.c
+gcc -std=gnu99 -O2 -o dedup_test dedup_test.c ../dedup.c
+# -Os as on the target, against json-c where it is installed
+gcc -std=gnu99 -Os -o json_writer_test json_writer_test.c ../json_writer.c \
+    $(pkg-config --exists json-c 2> /dev/null && echo "-DHAVE_JSON_C $(pkg-config --cflags --libs json-c)")
+gcc -std=gnu99 -O2 -I../avr -o fanout_test fanout_test.c ../fanout.c ../regcache.c
+gcc -std=gnu99 -O2 -o journal_test journal_test.c ../journal.c
+# C++ as in the daemon's Makefile, against a fake serial port
+g++ -std=gnu++98 -fno-exceptions -fno-rtti -O2 -I../avr -o msg_proc_test msg_proc_test.cpp ../msg_proc.cpp
+gcc -std=gnu99 -O2 -I../avr -o regcache_test regcache_test.c ../regcache.c
+gcc -std=gnu99 -O2 -o results_test results_test.c ../results.c ../dedup.c
+gcc -std=gnu99 -O2 -o schedule_test schedule_test.c ../schedule.c
+gcc -std=gnu99 -O2 -o trace_test trace_test.c ../trace.c ../json_writer.c
 gcc -o ring_buffer_test ring_buffer_test.c
 
@@ -0,0 +1,258 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// msg_proc over a fake serial port (the sp_* calls of serial.h): a burst
+// of frames with a bad crc closes the port and mp_poll() opens it again,
+// and the frames queued while the link lines up its credits go out by
+// class, the writes first, an aged one ahead of them, each class queue
+// bounded on its own. mp_wait() returns for the other descriptors the
+// worker loop waits on, the websocket's among them
+//
+
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+
+extern "C" {
+#include "../global.h"
+#include "../serial.h"
+}
+#include "../msg_proc.h"
+#include "msg_buf.h"
+#include "check.h"
+
+#define CRC_BURST     8   // SERIAL_CRC_BURST in msg_proc.cpp
+#define REOPEN_MS     50  // SERIAL_REOPEN_MIN_MS
+#define CLASS_LEN     16  // s_classLen[MP_CLASS_INTERACTIVE]
+#define BG_AGE_MS     500 // s_classAgeMs[MP_CLASS_BACKGROUND]
+
+
+// the fake port: what the board sends waits in s_in, the descriptor for
+// mp_wait() is a pipe nothing comes through
+static int s_portFds[2] = { -1, -1 };
+static uint8_t s_in[1024];
+static size_t s_inLen = 0;
+static size_t s_inPos = 0;
+static int s_opens = 0;
+static int s_closes = 0;
+static uint8_t s_sent[64];  // the frame types written, in order
+static int s_sentCount = 0;
+static uint16_t s_sentBytes = 0;
+
+int sp_open(const char* p_device, const uint32_t p_baud, const bool p_parity) { ++s_opens; return(s_portFds[0]); }
+void sp_close(const int p_fd) { s_closes += ((p_fd >= 0) ? 1 : 0); }
+bool sp_set_baud(const int p_fd, const uint32_t p_baud, const bool p_parity) { return(true); }
+bool sp_baud_supported(const uint32_t p_baud) { return(true); }
+bool sp_set_rs485(const int p_fd, const bool p_enable) { return(true); }
+bool sp_write(const int p_fd, const uint8_t* p_buf, const size_t p_len)
+{
+	s_sentBytes += p_len;
+	for(size_t i=0; ((i + 2) < p_len) && (s_sentCount < (int)sizeof(s_sent)); ++i)
+	{
+		if(MSG_BEGIN_CHAR == p_buf[i])
+		{
+			s_sent[s_sentCount++] = ((HEX2DEC(p_buf[i + 1]) << 4) | HEX2DEC(p_buf[i + 2]));
+		}
+	}
+	return(true);
+}
+ssize_t sp_read(const int p_fd, uint8_t* p_buf, const size_t p_len)
+{
+	const size_t len = (((s_inLen - s_inPos) < p_len) ? (s_inLen - s_inPos) : p_len);
+	memcpy(p_buf, &s_in[s_inPos], len);
+	s_inPos += len;
+	return(len);
+}
+
+// what the engine handed on
+static int s_writeRegisters = 0;
+void mp_on_pong(const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3) { }
+void mp_on_read_register(const uint8_t p_registerAddress) { }
+void mp_on_write_register(const uint8_t p_registerAddress, const uint8_t p_value, const uint8_t p_mask) { ++s_writeRegisters; }
+void mp_on_write_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const bool p_state) { }
+void mp_on_pulse_register_bit(const uint8_t p_registerAddress, const uint8_t p_bit, const uint8_t p_durationMs) { }
+void mp_on_subscribe_register(const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel) { }
+void mp_on_ack(const uint8_t p_type, const uint8_t p_registerAddress, const uint8_t p_status) { }
+void mp_on_sent(const uint32_t p_tag, const bool p_acked) { }
+
+
+////////////////////////////////////////
+// a point to point frame from the board into s_in, its crc broken if p_bad
+static void board_sends(const uint8_t p_type, const uint8_t p_param1, const uint8_t p_param2, const uint8_t p_param3, const bool p_bad)
+{
+	MsgBuf msgBuf;
+	msgBuf.set_bytes(p_type, p_param1, p_param2, p_param3);
+	const uint8_t len = msgBuf.size();
+	for(uint8_t i=0; i<len; ++i)
+	{
+		s_in[s_inLen + i] = msgBuf[i];
+	}
+	if(p_bad)
+	{
+		// the last crc char, before the end marker
+		uint8_t& ch = s_in[s_inLen + len - 2];
+		ch = (('0' == ch) ? '1' : '0');
+	}
+	s_inLen += len;
+}
+
+////////////////////////////////////////
+static void bad_frames(const int p_count)
+{
+	for(int i=0; i<p_count; ++i)
+	{
+		board_sends(MSG_WRITE_REGISTER, REG_OUTPUT_1, i, 0xff, true);
+	}
+}
+
+////////////////////////////////////////
+// a fresh port, the link waiting for the answer to its credit probe
+static void reopen(void)
+{
+	mp_init("/dev/fake", 9600, false);
+	mp_poll();
+}
+
+////////////////////////////////////////
+// the board answers the probe with room for all of it, what was queued
+// goes out
+static void line_up(void)
+{
+	s_sentCount = 0;
+	s_sentBytes = 0;
+	board_sends(MSG_CREDIT, 0x00, CREDIT_SYNC, 0xff, false);
+	mp_poll();
+}
+
+////////////////////////////////////////
+// the board got through all of it (and the probe's trailing byte), the
+// rest goes out
+static void consume_all(void)
+{
+	const uint16_t consumed = (s_sentBytes + 1);
+	board_sends(MSG_CREDIT, (consumed & 0xff), ((consumed >> 8) & (CREDIT_COUNT_MASK >> 8)), 0xff, false);
+	mp_poll();
+}
+
+////////////////////////////////////////
+static bool sent(const uint8_t* p_types, const int p_count)
+{
+	return((p_count == s_sentCount) && (0 == memcmp(s_sent, p_types, p_count)));
+}
+
+////////////////////////////////////////
+static uint32_t dropped(const uint8_t p_class)
+{
+	mp_class_stats stats;
+	mp_get_class_stats(p_class, &stats);
+	return(stats.m_dropped);
+}
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+	if(0 != pipe(s_portFds))
+	{
+		return(1);
+	}
+
+	check("mp_init opens the port", mp_init("/dev/fake", 9600, false) && (1 == s_opens));
+
+	bad_frames(CRC_BURST - 1);
+	mp_poll();
+	check("one bad frame short of the burst keeps the port", (0 == s_closes));
+
+	board_sends(MSG_WRITE_REGISTER, REG_OUTPUT_1, 0x01, 0xff, false);
+	bad_frames(CRC_BURST - 1);
+	mp_poll();
+	check("a good frame starts the count over", (0 == s_closes) && (1 == s_writeRegisters));
+
+	bad_frames(1);
+	mp_poll();
+	check("SERIAL_CRC_BURST bad frames in a row fail the port", (1 == s_closes));
+
+	mp_poll();
+	check("no reopen before the backoff", (1 == s_opens));
+	sleep_ms(REOPEN_MS + 10);
+	mp_poll();
+	check("reopened after SERIAL_REOPEN_MIN_MS", (2 == s_opens));
+
+	board_sends(MSG_WRITE_REGISTER, REG_OUTPUT_1, 0x02, 0xff, false);
+	mp_poll();
+	check("frames come in on the reopened port", (2 == s_writeRegisters));
+
+	printf("----------------\n");
+	{
+		reopen();
+		mp_dispatch_ping(0x01, 0x00, 0x00);
+		mp_dispatch_ping(0x02, 0x00, 0x00);
+		mp_dispatch_write_register(REG_OUTPUT_1, 0x01, 0xff);
+		check("frames wait for the credits", (0 == s_sentCount) || (MSG_READ_REGISTER == s_sent[s_sentCount - 1]));
+		line_up();
+		const uint8_t order[] = { MSG_WRITE_REGISTER, MSG_PING, MSG_PING };
+		check("the write overtakes the queued pings", sent(order, sizeof(order)));
+	}
+	{
+		reopen();
+		mp_dispatch_ping(0x01, 0x00, 0x00);
+		sleep_ms(BG_AGE_MS + 20);
+		mp_dispatch_write_register(REG_OUTPUT_1, 0x01, 0xff);
+		line_up();
+		const uint8_t order[] = { MSG_PING, MSG_WRITE_REGISTER };
+		check("a ping past its age goes ahead of the write", sent(order, sizeof(order)));
+	}
+	{
+		reopen();
+		const uint32_t readsDropped = dropped(MP_CLASS_INTERACTIVE);
+		bool ok = true;
+		for(int i=0; i<CLASS_LEN; ++i)
+		{
+			ok = (ok && mp_dispatch_read_register(REG_OUTPUT_1));
+		}
+		check("the read class takes its CLASS_LEN frames", ok);
+		check("and refuses one more", !mp_dispatch_read_register(REG_OUTPUT_1) && ((readsDropped + 1) == dropped(MP_CLASS_INTERACTIVE)));
+		check("the other classes still queue", mp_dispatch_write_register(REG_OUTPUT_1, 0x01, 0xff) && mp_dispatch_ping(0x01, 0x00, 0x00) &&
+		      (0 == dropped(MP_CLASS_CONTROL)) && (0 == dropped(MP_CLASS_BACKGROUND)));
+		line_up();
+		consume_all();
+		check("the write first, the reads, then the ping", (MSG_WRITE_REGISTER == s_sent[0]) && (MSG_READ_REGISTER == s_sent[1]) &&
+		      (MSG_READ_REGISTER == s_sent[CLASS_LEN]) && (MSG_PING == s_sent[CLASS_LEN + 1]) && ((CLASS_LEN + 2) == s_sentCount));
+	}
+	printf("----------------\n");
+	{
+		int fds[2];
+		check("a pipe to wait on", (0 == pipe(fds)) && mp_wait_fd(fds[0], POLLIN));
+		const char ch = 'x';
+		check("written", (1 == write(fds[1], &ch, 1)));
+		double start = now_sec();
+		mp_wait(1000);
+		check("mp_wait() returns for it at once", ((now_sec() - start) < 0.05));
+		check("dropped again", mp_wait_fd(fds[0], 0));
+		start = now_sec();
+		mp_wait(100);
+		check("mp_wait() then waits it out", ((now_sec() - start) >= 0.09));
+		close(fds[0]);
+		close(fds[1]);
+	}
+	printf("----------------\n\n");
+
+	mp_close();
+	return(check_end());
+}
@@ -0,0 +1,129 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+//
+// regcache: what makes a register current and what sends the reader to
+// the board, and the cost of a cached read
+//
+
+#include <stdio.h>
+
+#include "../global.h"
+#include "../msg_proc.h"
+#include "../regcache.h"
+#include "check.h"
+
+#define BENCH_ROUNDS  10000000
+
+
+// rc_watch() subscribes through these, two boards on a bus
+static const uint8_t s_boards[] = { 0x11, 0x12 };
+static int s_subscribes = 0;
+static int s_reads = 0;
+uint8_t mp_bus_board(const uint8_t p_index) { return((p_index < sizeof(s_boards)) ? s_boards[p_index] : BUS_ADDRESS_NONE); }
+void mp_select(const uint8_t p_address) { }
+bool mp_dispatch_subscribe_register(const uint8_t p_registerAddress, const uint8_t p_value, const bool p_cancel) { ++s_subscribes; return(true); }
+bool mp_dispatch_read_register(const uint8_t p_registerAddress) { ++s_reads; return(true); }
+void mp_burst_begin(void) { }
+bool mp_burst_end(void) { return(true); }
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+	uint8_t val = 0;
+	uint32_t age = 0;
+
+
+	/////////////////////////////////
+	// current or not
+	printf("----------------\n");
+	rc_watch();
+	check("rc_watch: 2 registers on 2 boards", (4 == s_subscribes));
+	check("rc_watch: 2 constant ones read on 2 boards", (4 == s_reads));
+	check("watched: REG_INPUT_1, not REG_POWERON_POLICY", rc_is_watched(REG_INPUT_1) && !rc_is_watched(REG_POWERON_POLICY));
+	check("nothing before the subscription answers", !rc_get(0x11, REG_INPUT_1, &val, &age));
+
+	rc_update(0x11, REG_INPUT_1, 0x0f, false);
+	check("a read answer alone is not kept current", !rc_get(0x11, REG_INPUT_1, &val, &age));
+	rc_update(0x11, REG_INPUT_1, 0x05, true);
+	check("subscription event", rc_get(0x11, REG_INPUT_1, &val, &age) && (0x05 == val) && (age < 100));
+	check("the other board", !rc_get(0x12, REG_INPUT_1, &val, &age));
+
+	rc_update(0x11, REG_OUTPUT_1, 0xf0, true);
+	rc_update(0x12, REG_OUTPUT_1, 0x00, true);
+	rc_write(0x11, REG_OUTPUT_1, 0x01, 0x03);
+	check("own write, masked", rc_get(0x11, REG_OUTPUT_1, &val, &age) && (0xf1 == val));
+	rc_write(BUS_ADDRESS_BROADCAST, REG_OUTPUT_1, 0x80, 0x80);
+	check("broadcast write, board 1", rc_get(0x11, REG_OUTPUT_1, &val, &age) && (0xf1 == val));
+	check("broadcast write, board 2", rc_get(0x12, REG_OUTPUT_1, &val, &age) && (0x80 == val));
+	rc_write(0x11, REG_POWERON_POLICY, 0x01, 0xff);
+	check("write to an unknown register is not cached", !rc_get(0x11, REG_POWERON_POLICY, &val, &age));
+
+	rc_forget(0x12, REG_OUTPUT_1);
+	check("undelivered write", !rc_get(0x12, REG_OUTPUT_1, &val, &age));
+	rc_update(0x12, REG_OUTPUT_1, 0x00, false);
+	check("a read answer makes it known again", rc_get(0x12, REG_OUTPUT_1, &val, &age) && (0x00 == val));
+	rc_unsubscribed(0x11, REG_INPUT_1);
+	check("cancelled subscription", !rc_get(0x11, REG_INPUT_1, &val, &age));
+	rc_update(0x12, REG_FW_VERSION, 0x02, false);
+	check("a constant register's read answer is current", rc_get(0x12, REG_FW_VERSION, &val, &age) && (0x02 == val));
+	{
+		rc_value values[RC_MAX_ENTRIES];
+		const uint8_t count = rc_snapshot(values, RC_MAX_ENTRIES);
+		check("snapshot: the current values", (3 == count) && (0x11 == values[0].m_board) && (REG_OUTPUT_1 == values[0].m_register) &&
+		      (0xf1 == values[0].m_value) && (REG_FW_VERSION == values[2].m_register));
+		check("snapshot: at most p_max", (1 == rc_snapshot(values, 1)));
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// full: the unsubscribed entries make room, the oldest first
+	printf("----------------\n");
+	// on top of the 3 current from above
+	for(int i=0; i<(RC_MAX_ENTRIES - 2); ++i)
+	{
+		rc_update(0x20, (uint8_t)i, (uint8_t)i, (i > 0));
+	}
+	check("0x11/REG_INPUT_1 made room", !rc_get(0x11, REG_INPUT_1, &val, &age));
+	check("0x20/0x00 made room", !rc_get(0x20, 0x00, &val, &age));
+	check("0x20/0x3d cached", rc_get(0x20, (RC_MAX_ENTRIES - 3), &val, &age) && ((RC_MAX_ENTRIES - 3) == val));
+	rc_update(0x21, 0x00, 0x01, true);
+	check("all subscribed, 0x21/0x00 not cached", !rc_get(0x21, 0x00, &val, &age));
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// cost of a cached read
+	printf("----------------\n");
+	{
+		long sum = 0;
+		const double start = now_sec();
+		for(int i=0; i<BENCH_ROUNDS; ++i)
+		{
+			sum += rc_get(0x11, REG_OUTPUT_1, &val, &age) ? val : 0;
+		}
+		const double elapsed = (now_sec() - start);
+		printf("rc_get: [%.0fns] per read (%ld)\n", ((elapsed * 1e9) / BENCH_ROUNDS), sum);
+	}
+	printf("----------------\n\n");
+
+	return(check_end());
+}
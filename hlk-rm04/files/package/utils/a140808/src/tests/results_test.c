@@ -0,0 +1,205 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+//
+// results: a request is done once its frames are sent and acked, a failure
+// is done at once, the results of one pass go out in one rs_on_done() call
+// and stay when it can't take them, and the oldest of too many running
+// gives up for a new one
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../global.h"
+#include "../results.h"
+#include "check.h"
+
+
+// what rs_on_done() got
+static rs_done s_got[RS_MAX_DONE];
+static uint8_t s_gotCount = 0;
+static int s_calls = 0;
+static bool s_refuse = false;
+
+
+////////////////////////////////////////
+bool rs_on_done(const rs_done* p_done, const uint8_t p_count)
+{
+	if(s_refuse)
+	{
+		return(false);
+	}
+	memcpy(s_got, p_done, (sizeof(rs_done) * p_count));
+	s_gotCount = p_count;
+	++s_calls;
+	return(true);
+}
+
+
+////////////////////////////////////////
+// a request with a tag of its own, as trace.h hands them out
+static uint32_t begin(const char* p_id)
+{
+	static uint32_t s_lastTag = 0;
+	rs_begin(p_id, ++s_lastTag);
+	return(s_lastTag);
+}
+
+////////////////////////////////////////
+// the results out of one rs_poll()
+static uint8_t poll_results(void)
+{
+	s_gotCount = 0;
+	s_calls = 0;
+	rs_poll();
+	return(s_gotCount);
+}
+
+////////////////////////////////////////
+static bool got(const uint8_t p_index, const char* p_id, const uint8_t p_status, const uint8_t p_reason)
+{
+	return((p_index < s_gotCount) && (0 == strcmp(p_id, s_got[p_index].m_id)) && (s_got[p_index].m_replayed == (0 == s_got[p_index].m_tag)) &&
+	       (p_status == s_got[p_index].m_result.m_status) && (p_reason == s_got[p_index].m_result.m_reason));
+}
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+
+
+	/////////////////////////////////
+	// when a request is done
+	printf("----------------\n");
+	{
+		uint32_t tag = begin("cache");
+		rs_end(tag, DD_OK, RS_REASON_NONE, 0);
+		check("no frames: done at rs_end()", (1 == poll_results()) && got(0, "cache", DD_OK, RS_REASON_NONE) &&
+		      (-1 == s_got[0].m_result.m_txUs) && (-1 == s_got[0].m_result.m_ackUs) && !s_got[0].m_replayed);
+
+		tag = begin("two");
+		rs_end(tag, DD_OK, RS_REASON_NONE, 2);
+		rs_sent(tag, false);
+		check("one of two frames sent: running", (0 == poll_results()) && rs_running("two"));
+		usleep(2000);
+		rs_sent(tag, false);
+		check("both sent: done, tx after receipt", (1 == poll_results()) && got(0, "two", DD_OK, RS_REASON_NONE) &&
+		      (s_got[0].m_result.m_txUs >= 2000) && (-1 == s_got[0].m_result.m_ackUs) && !rs_running("two"));
+
+		tag = begin("direct");
+		rs_sent(tag, false);  // on the wire while it runs
+		rs_end(tag, DD_OK, RS_REASON_NONE, 1);
+		check("sent before rs_end(): done", (1 == poll_results()) && got(0, "direct", DD_OK, RS_REASON_NONE));
+
+		tag = begin("acked");
+		rs_end(tag, DD_OK, RS_REASON_NONE, 1);
+		rs_sent(tag, true);
+		check("sent, the ack to come: running", (0 == poll_results()) && rs_running("acked"));
+		rs_acked(tag, RS_REASON_NONE);
+		check("acked: done, ack after tx", (1 == poll_results()) && got(0, "acked", DD_OK, RS_REASON_NONE) &&
+		      (s_got[0].m_result.m_ackUs >= s_got[0].m_result.m_txUs) && (s_got[0].m_result.m_txUs >= 0));
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// failures
+	printf("----------------\n");
+	{
+		uint32_t tag = begin("bad");
+		rs_end(tag, DD_INVALID, RS_REASON_ARGUMENTS, 0);
+		check("invalid: done, the reason kept", (1 == poll_results()) && got(0, "bad", DD_INVALID, RS_REASON_ARGUMENTS) &&
+		      (0 == strcmp("bad arguments", rs_reason(s_got[0].m_result.m_reason))));
+
+		tag = begin("lost");
+		rs_end(tag, DD_OK, RS_REASON_NONE, 2);
+		rs_sent(tag, true);
+		rs_acked(tag, RS_REASON_NOT_DELIVERED);
+		check("not delivered: done before the second frame", (1 == poll_results()) && got(0, "lost", DD_FAILED, RS_REASON_NOT_DELIVERED));
+		rs_sent(tag, true);
+		rs_acked(tag, RS_REASON_NONE);
+		check("the frames after it: nothing more", (0 == poll_results()));
+
+		tag = begin("refused");
+		rs_sent(tag, false);
+		rs_end(tag, DD_FAILED, RS_REASON_SERIAL, 1);
+		check("the serial layer refused some: failed", (1 == poll_results()) && got(0, "refused", DD_FAILED, RS_REASON_SERIAL) &&
+		      (s_got[0].m_result.m_txUs >= 0));
+
+		const dd_result* presult = dd_find("lost");
+		check("dd_find() has the result", (NULL != presult) && (DD_FAILED == presult->m_status) && (RS_REASON_NOT_DELIVERED == presult->m_reason));
+		rs_replay("lost", presult);
+		check("replayed", (1 == poll_results()) && got(0, "lost", DD_FAILED, RS_REASON_NOT_DELIVERED) && s_got[0].m_replayed);
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// batching
+	printf("----------------\n");
+	{
+		const char* ids[] = { "b0", "b1", "b2" };
+		for(int i=0; i<3; ++i)
+		{
+			rs_end(begin(ids[i]), DD_OK, RS_REASON_NONE, 0);
+		}
+		check("three done in one pass: one message", (3 == poll_results()) && (1 == s_calls) &&
+		      got(0, "b0", DD_OK, RS_REASON_NONE) && got(2, "b2", DD_OK, RS_REASON_NONE));
+
+		s_refuse = true;
+		rs_end(begin("held"), DD_OK, RS_REASON_NONE, 0);
+		check("refused by rs_on_done(): kept", (0 == poll_results()));
+		s_refuse = false;
+		check("and sent on the next pass", (1 == poll_results()) && got(0, "held", DD_OK, RS_REASON_NONE));
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// too many running
+	printf("----------------\n");
+	{
+		char id[16];
+		uint32_t tags[RS_MAX_RUNNING];
+		for(int i=0; i<RS_MAX_RUNNING; ++i)
+		{
+			snprintf(id, sizeof(id), "r%d", i);
+			tags[i] = begin(id);
+			rs_end(tags[i], DD_OK, RS_REASON_NONE, 1);
+			usleep(100);
+		}
+		check("RS_MAX_RUNNING running", (0 == poll_results()) && rs_running("r0") && rs_running("r15"));
+		const uint32_t tag = begin("one more");
+		check("one more: the oldest gives up", (1 == poll_results()) && got(0, "r0", DD_FAILED, RS_REASON_TIMEOUT) &&
+		      !rs_running("r0") && rs_running("one more"));
+		rs_sent(tags[0], false);
+		check("a late frame of it: nothing more", (0 == poll_results()));
+		for(int i=1; i<RS_MAX_RUNNING; ++i)
+		{
+			rs_sent(tags[i], false);
+		}
+		rs_end(tag, DD_OK, RS_REASON_NONE, 0);
+		check("the rest done", (RS_MAX_RUNNING == poll_results()) && got(0, "r1", DD_OK, RS_REASON_NONE));
+	}
+	printf("----------------\n\n");
+
+	return(check_end());
+}
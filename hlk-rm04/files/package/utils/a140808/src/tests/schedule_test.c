@@ -0,0 +1,209 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+//
+// schedule: jobs run in time order however they were added, cancelled ones
+// not at all, the timerfd readable when one is due, pending jobs back after
+// a reopen (the overdue ones due at once), and how late a job runs
+//
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../global.h"
+#include "../schedule.h"
+#include "check.h"
+
+#define SCHEDULE_PATH  "/tmp/schedule_test.schedule"
+#define RANDOM_JOBS    SC_MAX_JOBS
+#define LATE_ROUNDS    50
+
+
+// what sc_on_due() was given
+static uint32_t s_ran[SC_MAX_JOBS * 2];
+static int64_t s_lateUs[SC_MAX_JOBS * 2];
+static int s_ranCount = 0;
+
+
+////////////////////////////////////////
+void sc_on_due(const sc_job* p_job, const int64_t p_lateUs)
+{
+	if(s_ranCount < (int)(sizeof(s_ran) / sizeof(s_ran[0])))
+	{
+		s_ran[s_ranCount] = p_job->m_args[0];
+		s_lateUs[s_ranCount] = p_lateUs;
+		++s_ranCount;
+	}
+}
+
+////////////////////////////////////////
+// p_arg identifies it in s_ran
+static uint32_t add(const uint64_t p_dueMs, const int p_arg)
+{
+	sc_job job;
+	memset(&job, 0, sizeof(job));
+	job.m_dueMs = p_dueMs;
+	strcpy(job.m_name, "pulseRelay");
+	job.m_args[0] = p_arg;
+	job.m_given = 1;
+	return(sc_add(&job));
+}
+
+////////////////////////////////////////
+// the worker loop for p_ms, woken by the timerfd
+static void run_for(const uint32_t p_ms)
+{
+	const uint64_t end = (mono_us_now() + (p_ms * 1000));
+	uint64_t now;
+	while((now = mono_us_now()) < end)
+	{
+		struct pollfd pfd = { sc_fd(), POLLIN, 0 };
+		poll(&pfd, 1, (((end - now) + 999) / 1000));
+		sc_poll();
+	}
+}
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+	unlink(SCHEDULE_PATH);
+
+
+	/////////////////////////////////
+	// order
+	printf("----------------\n");
+	check("open", sc_open(SCHEDULE_PATH));
+	{
+		// due 10ms apart in a random order, the ones with an odd arg cancelled
+		int order[RANDOM_JOBS];
+		uint32_t ids[RANDOM_JOBS];
+		for(int i=0; i<RANDOM_JOBS; ++i)
+		{
+			order[i] = i;
+		}
+		srand(1);
+		for(int i=(RANDOM_JOBS - 1); i>0; --i)
+		{
+			const int j = (rand() % (i + 1));
+			const int t = order[i];
+			order[i] = order[j];
+			order[j] = t;
+		}
+		const uint64_t now = date_ms_now();
+		for(int i=0; i<RANDOM_JOBS; ++i)
+		{
+			ids[order[i]] = add((now + 100 + (order[i] * 10)), order[i]);
+		}
+		check("full", (SC_MAX_JOBS == sc_count()) && (0 == add(now, 0)));
+		bool cancelled = true;
+		for(int i=1; i<RANDOM_JOBS; i+=2)
+		{
+			cancelled = (cancelled && sc_cancel(ids[i]));
+		}
+		check("cancelled", cancelled && !sc_cancel(ids[1]) && ((RANDOM_JOBS / 2) == sc_count()));
+
+		run_for(50);
+		check("none early", (0 == s_ranCount));
+		run_for((RANDOM_JOBS * 10) + 60);
+		bool inOrder = (s_ranCount == (RANDOM_JOBS / 2));
+		for(int i=0; inOrder && (i < s_ranCount); ++i)
+		{
+			inOrder = (s_ran[i] == (uint32_t)(i * 2));
+		}
+		check("due order, cancelled ones left out", inOrder && (0 == sc_count()));
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// kept over a reopen
+	printf("----------------\n");
+	{
+		s_ranCount = 0;
+		const uint64_t now = date_ms_now();
+		const uint32_t id = add((now + 60000), 1);
+		add((now + 30), 2);
+		sc_close();
+
+		// the file as a daemon that went away with one overdue would leave it
+		FILE* pf = fopen(SCHEDULE_PATH, "r+");
+		sc_job job;
+		uint32_t header[3];
+		bool found = ((NULL != pf) && (1 == fread(header, sizeof(header), 1, pf)) && (2 == header[2]));
+		for(uint32_t i=0; found && (i < header[2]); ++i)
+		{
+			const long at = ftell(pf);
+			found = (1 == fread(&job, sizeof(job), 1, pf));
+			if(found && (2 == job.m_args[0]))
+			{
+				job.m_dueMs = (now - 120000);
+				fseek(pf, at, SEEK_SET);
+				fwrite(&job, sizeof(job), 1, pf);
+				break;
+			}
+		}
+		if(NULL != pf)
+		{
+			fclose(pf);
+		}
+		check("written out", found);
+
+		check("reopen", sc_open(SCHEDULE_PATH) && (2 == sc_count()));
+		sc_poll();
+		check("the overdue one at once, 2 minutes late", (1 == s_ranCount) && (2 == s_ran[0]) && (s_lateUs[0] >= 119000000));
+		check("the other one still pending", sc_cancel(id) && (0 == sc_count()));
+		check("ids go on", (id < add((now + 60000), 3)));
+	}
+	sc_close();
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// how late a job runs
+	printf("----------------\n");
+	{
+		unlink(SCHEDULE_PATH);
+		sc_open(SCHEDULE_PATH);
+		s_ranCount = 0;
+		int64_t worst = 0;
+		int64_t sum = 0;
+		for(int i=0; i<LATE_ROUNDS; ++i)
+		{
+			add((date_ms_now() + 5), i);
+			run_for(7);
+		}
+		for(int i=0; i<s_ranCount; ++i)
+		{
+			worst = max(worst, s_lateUs[i]);
+			sum += s_lateUs[i];
+		}
+		printf("[%d] jobs, late by [%lldus] on average, [%lldus] at worst\n",
+		       s_ranCount, (long long)(sum / max(s_ranCount, 1)), (long long)worst);
+		// on a loaded machine the worst one is up to the scheduler
+		check("within a ms on average", (LATE_ROUNDS == s_ranCount) && ((sum / LATE_ROUNDS) < 1000));
+	}
+	sc_close();
+	unlink(SCHEDULE_PATH);
+	printf("----------------\n\n");
+
+	return(check_end());
+}
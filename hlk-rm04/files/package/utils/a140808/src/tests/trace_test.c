@@ -0,0 +1,154 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+//
+// trace: the rows a message gets in the dump, the oldest one let go when
+// the ring wraps, and the cost of the stamps of a message
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../global.h"
+#include "../trace.h"
+#include "check.h"
+
+#define DUMP_FILE     "/tmp/trace_test.json"
+#define BENCH_ROUNDS  2000000
+
+static char s_dump[64 * 1024];
+
+
+////////////////////////////////////////
+// the dump in s_dump, the traces in it
+static int dump(void)
+{
+	const int count = tr_dump(DUMP_FILE);
+	s_dump[0] = '\0';
+	FILE* pf = fopen(DUMP_FILE, "r");
+	if(NULL != pf)
+	{
+		s_dump[fread(s_dump, 1, (sizeof(s_dump) - 1), pf)] = '\0';
+		fclose(pf);
+	}
+	unlink(DUMP_FILE);
+	return(count);
+}
+
+////////////////////////////////////////
+static int occurrences(const char* p_what)
+{
+	int count = 0;
+	for(const char* at=strstr(s_dump, p_what); NULL != at; at=strstr((at + 1), p_what))
+	{
+		++count;
+	}
+	return(count);
+}
+
+
+int main(const int p_argc, const char** p_argv)
+{
+	check_begin();
+
+
+	/////////////////////////////////
+	// the rows of a message
+	printf("----------------\n");
+	{
+		const uint32_t relay = tr_begin();
+		tr_name(relay, "pulseRelay");
+		tr_name(relay, "req");  // the first one sticks
+		usleep(1000);
+		tr_stamp(relay, TR_DISPATCHED);
+		usleep(1000);
+		tr_stamp(relay, TR_SENT);
+		usleep(1000);
+		tr_stamp(relay, TR_ACKED);
+		tr_stamp(relay, TR_REPLIED);
+
+		const uint32_t hello = tr_begin();
+		tr_name(hello, "hel\"lo");
+		tr_stamp(hello, TR_DISPATCHED);
+
+		check("two traces", (2 == dump()));
+		check("starts {\"traceEvents\":[", (0 == strncmp("{\"traceEvents\":[", s_dump, 16)));
+		check("ends ]}", (NULL != strstr(s_dump, "\n]}\n")));
+		check("dispatch, serial queue, board and reply",
+		      (2 == occurrences("\"name\":\"dispatch\"")) && (1 == occurrences("\"name\":\"serial queue\"")) &&
+		      (1 == occurrences("\"name\":\"board\"")) && (1 == occurrences("\"name\":\"reply\",\"ph\":\"i\"")));
+		check("the first name sticks", (4 == occurrences("{\"command\":\"pulseRelay\"}")) && (0 == occurrences("\"req\"")));
+		check("a name escaped", (1 == occurrences("{\"command\":\"hel\\\"lo\"}")));
+
+		const char* board = strstr(s_dump, "\"name\":\"board\",\"ph\":\"X\",\"ts\":");
+		const char* dur = ((NULL != board) ? strstr(board, "\"dur\":") : NULL);
+		check("board takes 1ms and some", (NULL != dur) && (atoi(dur + 6) >= 1000) && (atoi(dur + 6) < 100000));
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// the ring wraps
+	printf("----------------\n");
+	{
+		const uint32_t first = tr_begin();
+		tr_name(first, "first");
+		for(int i=0; i<TR_MAX_TRACES; ++i)
+		{
+			tr_stamp(tr_begin(), TR_DISPATCHED);
+		}
+		tr_stamp(first, TR_DISPATCHED);  // left the ring, let go
+		tr_name(first, "late");
+		check("TR_MAX_TRACES kept", (TR_MAX_TRACES == dump()));
+		check("the oldest let go", (0 == occurrences("\"first\"")) && (0 == occurrences("\"late\"")));
+		check("no tag 0", (0 == occurrences("\"tid\":0,")));
+		tr_stamp(0, TR_SENT);
+		tr_name(0, "none");
+		check("tag 0 is no trace", (TR_MAX_TRACES == dump()) && (0 == occurrences("\"none\"")));
+	}
+	printf("----------------\n\n");
+
+
+	/////////////////////////////////
+	// cost of the stamps of a message
+	printf("----------------\n");
+	{
+		uint32_t sum = 0;
+		const double start = now_sec();
+		for(int i=0; i<BENCH_ROUNDS; ++i)
+		{
+			const uint32_t tag = tr_begin();
+			tr_name(tag, "pulseRelay");
+			tr_stamp(tag, TR_DISPATCHED);
+			tr_stamp(tag, TR_SENT);
+			tr_stamp(tag, TR_ACKED);
+			sum += tag;
+		}
+		const double elapsed = (now_sec() - start);
+		printf("[%.0fns] per message (%u)\n", ((elapsed * 1e9) / BENCH_ROUNDS), sum);
+		const double dumpStart = now_sec();
+		dump();
+		printf("dump of [%d] traces: [%.0fus]\n", TR_MAX_TRACES, ((now_sec() - dumpStart) * 1e6));
+	}
+	printf("----------------\n\n");
+
+	return(check_end());
+}
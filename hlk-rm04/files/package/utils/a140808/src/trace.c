@@ -0,0 +1,169 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#include <errno.h>
+#include <stdio.h>   // rename
+#include <string.h>  // memset, strerror, strncpy
+#include <unistd.h>  // unlink
+
+#include "global.h"
+#include "json_writer.h"
+#include "trace.h"
+
+
+typedef struct
+{
+    uint32_t m_tag;                 // 0: empty
+    char m_name[TR_NAME_LEN];
+    uint64_t m_stamps[TR_STAGES];   // mono_us_now(), 0 until the stage is passed
+} tr_trace;
+
+static tr_trace s_traces[TR_MAX_TRACES];
+static uint32_t s_lastTag = 0;
+
+
+////////////////////////////////////////
+static tr_trace* find(const uint32_t p_tag)
+{
+    tr_trace* ptrace = &s_traces[p_tag % TR_MAX_TRACES];
+    return(((0 != p_tag) && (p_tag == ptrace->m_tag)) ? ptrace : NULL);
+}
+
+////////////////////////////////////////
+// {"name":"board","ph":"X","ts":<us>,"dur":<us>,"pid":1,"tid":<tag>,"args":{"command":"pulseRelay"}},
+// no dur for an instant
+static bool write_event(FILE* p_pf, const tr_trace* p_trace, const char* p_name, const uint64_t p_from, const uint64_t p_to)
+{
+    char buf[160];
+    struct json_writer jw;
+    jw_init(&jw, buf, sizeof(buf));
+    jw_object_begin(&jw);
+    jw_key(&jw, "name");  jw_string(&jw, p_name);
+    jw_key(&jw, "ph");    jw_string(&jw, ((0 == p_to) ? "i" : "X"));
+    jw_key(&jw, "ts");    jw_int(&jw, p_from);
+    if(0 != p_to)
+    {
+        jw_key(&jw, "dur");  jw_int(&jw, (p_to - p_from));
+    }
+    else
+    {
+        jw_key(&jw, "s");  jw_string(&jw, "t");
+    }
+    jw_key(&jw, "pid");   jw_int(&jw, 1);
+    jw_key(&jw, "tid");   jw_int(&jw, p_trace->m_tag);
+    jw_key(&jw, "args");
+    jw_object_begin(&jw);
+    jw_key(&jw, "command");  jw_string(&jw, p_trace->m_name);
+    jw_object_end(&jw);
+    jw_object_end(&jw);
+    const size_t len = jw_finish(&jw);
+    return((0 != len) && (fprintf(p_pf, ",\n%s", buf) > 0));
+}
+
+////////////////////////////////////////
+static bool write_trace(FILE* p_pf, const tr_trace* p_trace)
+{
+    const uint64_t* stamps = p_trace->m_stamps;
+    bool ok = true;
+    if(0 != stamps[TR_DISPATCHED])
+    {
+        ok = write_event(p_pf, p_trace, "dispatch", stamps[TR_RECEIVED], stamps[TR_DISPATCHED]);
+    }
+    if(ok && (0 != stamps[TR_SENT]) && (stamps[TR_SENT] > stamps[TR_DISPATCHED]) && (0 != stamps[TR_DISPATCHED]))
+    {
+        ok = write_event(p_pf, p_trace, "serial queue", stamps[TR_DISPATCHED], stamps[TR_SENT]);
+    }
+    if(ok && (0 != stamps[TR_SENT]) && (stamps[TR_ACKED] > stamps[TR_SENT]))
+    {
+        ok = write_event(p_pf, p_trace, "board", stamps[TR_SENT], stamps[TR_ACKED]);
+    }
+    if(ok && (0 != stamps[TR_REPLIED]))
+    {
+        ok = write_event(p_pf, p_trace, "reply", stamps[TR_REPLIED], 0);
+    }
+    return(ok);
+}
+
+
+////////////////////////////////////////
+uint32_t tr_begin(void)
+{
+    s_lastTag = ((UINT32_MAX == s_lastTag) ? 1 : (s_lastTag + 1));
+    tr_trace* ptrace = &s_traces[s_lastTag % TR_MAX_TRACES];
+    memset(ptrace, 0, sizeof(*ptrace));
+    ptrace->m_tag = s_lastTag;
+    ptrace->m_stamps[TR_RECEIVED] = mono_us_now();
+    return(s_lastTag);
+}
+
+////////////////////////////////////////
+void tr_name(const uint32_t p_tag, const char* p_name)
+{
+    tr_trace* ptrace = find(p_tag);
+    if((NULL != ptrace) && ('\0' == ptrace->m_name[0]))
+    {
+        strncpy(ptrace->m_name, p_name, (TR_NAME_LEN - 1));
+    }
+}
+
+////////////////////////////////////////
+void tr_stamp(const uint32_t p_tag, const uint8_t p_stage)
+{
+    tr_trace* ptrace = find(p_tag);
+    if((NULL != ptrace) && ((0 == ptrace->m_stamps[p_stage]) || (TR_ACKED == p_stage)))
+    {
+        ptrace->m_stamps[p_stage] = mono_us_now();
+    }
+}
+
+////////////////////////////////////////
+// {"traceEvents":[...]} oldest first, written aside and renamed over so a
+// reader never gets half of it
+int tr_dump(const char* p_path)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s.new", p_path);
+    FILE* pf = fopen(path, "w");
+    if(NULL == pf)
+    {
+        log_err("tr_dump: [%s], err: [%s]", path, strerror(errno));
+        return(-1);
+    }
+    // the process name row heads it, the comma before each event
+    bool ok = (fprintf(pf, "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"" PROGNAME "\"}}") > 0);
+    int count = 0;
+    for(uint32_t i=1; ok && (i<=TR_MAX_TRACES); ++i)
+    {
+        const tr_trace* ptrace = &s_traces[(s_lastTag + i) % TR_MAX_TRACES];
+        if(0 != ptrace->m_tag)
+        {
+            ok = write_trace(pf, ptrace);
+            ++count;
+        }
+    }
+    ok = (ok && (fprintf(pf, "\n]}\n") > 0));
+    if((0 != fclose(pf)) || !ok || (0 != rename(path, p_path)))
+    {
+        log_err("tr_dump: [%s], err: [%s]", p_path, strerror(errno));
+        unlink(path);
+        return(-1);
+    }
+    log_notice("tr_dump: [%d] traces to [%s]", count, p_path);
+    return(count);
+}
@@ -0,0 +1,62 @@
+//
+// Copyright 2015 The REST Switch Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, Licensor provides the Work (and each Contributor provides its
+// Contributions) on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied, including,
+// without limitation, any warranties or conditions of TITLE, NON-INFRINGEMENT, MERCHANTABILITY, or FITNESS FOR A PARTICULAR
+// PURPOSE. You are solely responsible for determining the appropriateness of using or redistributing the Work and assume any
+// risks associated with Your exercise of permissions under this License.
+//
+// Author: John Clark (johnc@restswitch.com)
+//
+
+
+#ifndef __trace_h__
+#define __trace_h__
+
+#include <stdint.h>
+
+//
+// where the time of a command from the cloud went: each message is stamped
+// on the monotonic clock as it passes a stage, the last TR_MAX_TRACES kept
+// in a ring. the tag of a message is the tag of its frames (mp_set_tag())
+// and its slot in the ring, so a stamp costs an index and a compare. the
+// worker loop writes and dumps the ring, nothing else touches it (a signal
+// only asks for the dump), so it takes no lock
+//
+// tr_dump() writes the chrome trace event format, one row per message:
+//   dispatch      ws_onmessage() to the handlers done
+//   serial queue  to its first frame on the wire, when it had to wait
+//   board         the first frame on the wire to the board's last ack, the
+//                 firmware time is in there (the board has no clock in
+//                 common with the daemon, build it with PROFILING=1 for its
+//                 own times)
+//   reply         the result sent, an instant
+//
+
+#define TR_MAX_TRACES  64
+#define TR_NAME_LEN    24
+
+#define TR_RECEIVED    0  // ws_onmessage()
+#define TR_DISPATCHED  1  // the handlers ran, the frames are queued
+#define TR_SENT        2  // the first frame went on the wire
+#define TR_ACKED       3  // the board acked a frame, the last one kept
+#define TR_REPLIED     4  // the result went out, for a request
+#define TR_STAGES      5
+
+// a message came in, its tag with TR_RECEIVED stamped
+uint32_t tr_begin(void);
+// the command of p_tag, the first one sticks (the inner one of a request)
+void tr_name(const uint32_t p_tag, const char* p_name);
+// p_tag passed p_stage, a tag that left the ring is let go
+void tr_stamp(const uint32_t p_tag, const uint8_t p_stage);
+// the ring to p_path, the traces written or -1
+int tr_dump(const char* p_path);
+
+#endif // __trace_h__
@@ -23,6 +23,7 @@
 #include <stdlib.h>    // strtoull
 #include <unistd.h>    // usleep
 #include <sys/time.h>
+#include <time.h>      // clock_gettime
 
 #include "global.h"
 #include "log.h"
@@ -32,6 +33,8 @@
 
 #define date_ms_now()  ({struct timeval tv; gettimeofday(&tv, NULL); ((uint64_t)(tv.tv_sec) * 1000 + (uint64_t)(tv.tv_usec) / 1000);})
 #define date_sec_now() ({struct timeval tv; gettimeofday(&tv, NULL); tv.tv_sec;})
+#define mono_us_now()  ({struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); ((uint64_t)(ts.tv_sec) * 1000000 + (uint64_t)(ts.tv_nsec) / 1000);})
+#define mono_ms_now()  ({struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); ((uint64_t)(ts.tv_sec) * 1000 + (uint64_t)(ts.tv_nsec) / 1000000);})
 #define sleep_ms(ms)   usleep((ms)*1000);
 
 #define str2num(str,base)   ({strtoull((str), NULL, (base));})
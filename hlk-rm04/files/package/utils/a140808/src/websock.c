@@ -37,7 +37,18 @@ static uint32_t s_heartbeat_timer = 0;
 
 #define WRITE_BUF_MAX  64
 static struct ring_buf_data s_ping_buf = { 0 };
-static struct ring_buf_data s_text_buf = { 0 };
+
+// outbound text messages, formatted in place (ws_text_reserve()) and sent
+// one per writeable callback
+struct ws_text
+{
+    unsigned char m_buf[LWS_SEND_BUFFER_PRE_PADDING + WS_TEXT_MAX + LWS_SEND_BUFFER_POST_PADDING];
+    uint16_t m_len;
+    bool m_kept;  // ws_text_commit_kept()
+};
+static struct ws_text s_text[WS_TEXT_QUEUE];
+static uint8_t s_text_head = 0;
+static uint8_t s_text_count = 0;
 
 enum ws_ready_state
 {
@@ -90,14 +101,6 @@ int ws_connect(const char* p_host, const char* p_url_path, const int p_port, con
                 return(-1);
             }
         }
-        if(rb_capacity(&s_text_buf) < WRITE_BUF_MAX)
-        {
-            if(!rb_init(&s_text_buf, WRITE_BUF_MAX))
-            {
-                log_crit("ws_connect: failed to allocate buffer - size: [%d]", WRITE_BUF_MAX);
-                return(-1);
-            }
-        }
 
         static struct lws_protocols s_protocols[] =
         {
@@ -158,7 +161,7 @@ void ws_send_ping(const char* p_msg)
 }
 
 ////////////////////////////////////////
-// p_msg must be < WRITE_BUF_MAX
+// p_msg must be < WS_TEXT_MAX
 void ws_send_text(const char* p_msg)
 {
     if(NULL == p_msg) return;  // nothing to do
@@ -166,15 +169,99 @@ void ws_send_text(const char* p_msg)
     const size_t msg_len = strlen(p_msg);
     if(msg_len < 1) return;  // nothing to do
 
-    // truncate if too long
-    uint8_t write_len = ((msg_len > 0xff) ? 0xff : msg_len);
-    write_len = ((write_len > WRITE_BUF_MAX) ? WRITE_BUF_MAX : write_len);
-    rb_set_data(&s_text_buf, p_msg, write_len);
+    size_t capacity;
+    char* buf = ws_text_reserve(&capacity);
+    if(NULL == buf)
+    {
+        return;
+    }
+    if(msg_len >= capacity)
+    {
+        log_err("ws_send_text: message too long, dropped - size: [%zu]", msg_len);
+        return;
+    }
+    memcpy(buf, p_msg, msg_len);
+    ws_text_commit(msg_len);
+}
+
+////////////////////////////////////////
+bool ws_is_open(void)
+{
+    return(WS_OPEN == s_ready_state);
+}
+
+////////////////////////////////////////
+char* ws_text_reserve(size_t* p_capacity)
+{
+    if(WS_TEXT_QUEUE == s_text_count)
+    {
+        log_err("ws_text_reserve: send queue full, [%d] messages waiting", s_text_count);
+        return(NULL);
+    }
+    struct ws_text* ptext = &s_text[(s_text_head + s_text_count) % WS_TEXT_QUEUE];
+    *p_capacity = WS_TEXT_MAX;
+    return((char*)&ptext->m_buf[LWS_SEND_BUFFER_PRE_PADDING]);
+}
+
+////////////////////////////////////////
+int ws_text_room(void)
+{
+    return(WS_TEXT_QUEUE - s_text_count);
+}
+
+////////////////////////////////////////
+static void text_commit(const size_t p_len, const bool p_kept)
+{
+    if((0 == p_len) || (p_len >= WS_TEXT_MAX) || (WS_TEXT_QUEUE == s_text_count))
+    {
+        return;  // nothing to do
+    }
+    struct ws_text* ptext = &s_text[(s_text_head + s_text_count) % WS_TEXT_QUEUE];
+    ptext->m_len = p_len;
+    ptext->m_kept = p_kept;
+    ++s_text_count;
 
     // signal that we want an LWS_CALLBACK_CLIENT_WRITEABLE next service
     lws_callback_on_writable(s_pWs);
 }
 
+////////////////////////////////////////
+void ws_text_commit(const size_t p_len)
+{
+    text_commit(p_len, false);
+}
+
+////////////////////////////////////////
+void ws_text_commit_kept(const size_t p_len)
+{
+    text_commit(p_len, true);
+}
+
+////////////////////////////////////////
+// the queue is of no use to the next connection, what was kept goes back
+// to the caller in order
+static void text_unsent(void)
+{
+    uint8_t dropped = 0;
+    for(; s_text_count > 0; --s_text_count)
+    {
+        struct ws_text* ptext = &s_text[s_text_head];
+        if(ptext->m_kept)
+        {
+            ws_onunsent((const char*)&ptext->m_buf[LWS_SEND_BUFFER_PRE_PADDING], ptext->m_len);
+        }
+        else
+        {
+            ++dropped;
+        }
+        s_text_head = ((s_text_head + 1) % WS_TEXT_QUEUE);
+    }
+    if(dropped > 0)
+    {
+        log_notice("ws: [%u] queued messages dropped with the connection", dropped);
+    }
+}
+
 
 ////////////////////////////////////////
 void ws_close(void)
@@ -226,16 +313,11 @@ void ws_poll(void)
         log_trace2(".");
     }
 
-    // poll
-    if(NULL == s_pWsContext)
-    {
-        // we are not connected, only loop once every 8 seconds
-        sleep_ms(8000);
-    }
-    else
+    // poll, the worker loop waits (mp_wait) on the serial link and the
+    // socket, see ws_onpollfd()
+    if(NULL != s_pWsContext)
     {
-        lws_service(s_pWsContext, 100); // 100ms timeout
-        sleep_ms(125); // loop 8 times per sec
+        lws_service(s_pWsContext, 0);
     }
 }
 
@@ -279,6 +361,42 @@ void ws_write_data(struct ring_buf_data* p_pd, enum lws_write_protocol p_proto,
     }
 }
 
+////////////////////////////////////////
+// the oldest queued text message, whole: lws keeps what the socket did
+// not take and sends it before the next writeable callback, a second
+// LWS_WRITE_TEXT for the rest would go out as a message of its own
+void ws_write_text(struct lws* p_pWs)
+{
+    if(0 == s_text_count)
+    {
+        return;  // nothing to send
+    }
+
+    struct ws_text* ptext = &s_text[s_text_head];
+#ifdef DEBUG
+    ptext->m_buf[LWS_SEND_BUFFER_PRE_PADDING + ptext->m_len] = '\0'; // LWS_SEND_BUFFER_POST_PADDING has room for it
+    log_debug(">>>>>>>>>sending %d bytes: %s", ptext->m_len, &ptext->m_buf[LWS_SEND_BUFFER_PRE_PADDING]);
+#endif // DEBUG
+    const int sent_bytes = lws_write(p_pWs, &ptext->m_buf[LWS_SEND_BUFFER_PRE_PADDING], ptext->m_len, LWS_WRITE_TEXT);
+    if(sent_bytes < 0)
+    {
+        log_err("lws_write returned a negative result code: %d", sent_bytes);
+        return;
+    }
+    s_text_head = ((s_text_head + 1) % WS_TEXT_QUEUE);
+    --s_text_count;
+
+    if(s_text_count > 0)
+    {
+        // the rest, one message per callback
+        lws_callback_on_writable(p_pWs);
+    }
+    else
+    {
+        ws_ondrain();
+    }
+}
+
 ////////////////////////////////////////
 int ws_onevent(struct lws* p_pWs, enum lws_callback_reasons p_event, void* p_pUser, void* p_pData, size_t p_dataLen)
 {
@@ -313,6 +431,7 @@ int ws_onevent(struct lws* p_pWs, enum lws_callback_reasons p_event, void* p_pUs
             // then it was initiated by a ws_close request
             const bool force = (WS_CLOSING == s_ready_state);
             s_ready_state = WS_CLOSED;
+            text_unsent();
 
             // if we were not forced closed, queue a reconnect
             if(!force)
@@ -345,7 +464,7 @@ int ws_onevent(struct lws* p_pWs, enum lws_callback_reasons p_event, void* p_pUs
         case LWS_CALLBACK_CLIENT_WRITEABLE:
         {
             ws_write_data(&s_ping_buf, LWS_WRITE_PING, p_pWs);
-            ws_write_data(&s_text_buf, LWS_WRITE_TEXT, p_pWs);
+            ws_write_text(p_pWs);
             break;
         }
 
@@ -358,7 +477,22 @@ int ws_onevent(struct lws* p_pWs, enum lws_callback_reasons p_event, void* p_pUs
             s_pWs = NULL;
             s_pWsContext = NULL;
             rb_free(&s_ping_buf);
-            rb_free(&s_text_buf);
+            s_text_count = 0;
+            break;
+        }
+
+        case LWS_CALLBACK_ADD_POLL_FD:
+        case LWS_CALLBACK_CHANGE_MODE_POLL_FD:
+        {
+            const struct lws_pollargs* pargs = (const struct lws_pollargs*)p_pData;
+            ws_onpollfd(pargs->fd, pargs->events);
+            break;
+        }
+
+        case LWS_CALLBACK_DEL_POLL_FD:
+        {
+            const struct lws_pollargs* pargs = (const struct lws_pollargs*)p_pData;
+            ws_onpollfd(pargs->fd, 0);
             break;
         }
 
@@ -369,6 +503,7 @@ int ws_onevent(struct lws* p_pWs, enum lws_callback_reasons p_event, void* p_pUs
             //       causing the reconnect logic to activate
             s_ready_state = WS_CLOSED;
             s_reconnect_timer = date_sec_now();
+            text_unsent();
             break;
         }
 
@@ -20,6 +20,7 @@
 #define __websock_h__
 
 #include <stdbool.h>
+#include <stddef.h>
 
 
 //
@@ -52,11 +53,30 @@ void ws_onmessage(const char* p_msg);
 void ws_onerror(void);
 void ws_onclose(const bool p_force);
 void ws_onpong(const char* p_msg);
+void ws_ondrain(void);  // the send queue is empty
+// a message committed with ws_text_commit_kept() the connection closed on
+void ws_onunsent(const char* p_msg, const size_t p_len);
+// lws wants p_fd polled for p_events (poll(2)) by the caller's wait, 0 once
+// it is done with it. lws_service() in ws_poll() then runs what is ready
+void ws_onpollfd(const int p_fd, const short p_events);
 
 int ws_connect(const char* p_host, const char* p_url_path, const int p_port, const int p_ssl_flags);
 void ws_close(void);
 void ws_send_ping(const char* p_msg);
 void ws_send_text(const char* p_msg);
+// outbound text formatted in place, no copy: the room for the next message
+// in the send queue (p_capacity, one byte of it for a nul), NULL if the
+// queue is full. ws_text_commit() sends p_len bytes of it, 0 drops it
+#define WS_TEXT_MAX    512
+#define WS_TEXT_QUEUE  8
+char* ws_text_reserve(size_t* p_capacity);
+int ws_text_room(void);  // messages the queue takes before it is full
+void ws_text_commit(const size_t p_len);
+// as ws_text_commit(), but if the connection closes before it went out it
+// comes back through ws_onunsent(). the rest queued then is dropped
+void ws_text_commit_kept(const size_t p_len);
 void ws_poll(void);
+// true once the connection is open, pushed state is pointless before
+bool ws_is_open(void);
 
 #endif // __websock_h__